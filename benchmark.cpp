@@ -0,0 +1,570 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "persistent_array.h"
+#include "persistent_doubly_linked_list.h"
+#include "persistent_associative_array.h"
+#include "persistent_btree.h"
+#include "persistent_compact_associative_array.h"
+#include "persistent_loader.h"
+#include "persistent_parallel.h"
+#include "persistent_queue.h"
+#include "persistent_sequence.h"
+#include "persistent_sharded.h"
+#include "persistent_trace.h"
+
+// Benchmarks for the persistent containers.
+// Usage: benchmark [name] [size]; without a name every benchmark is run.
+// Trace replay: benchmark trace [trace file] [max threads]; without a file a sample trace is recorded first.
+
+// Milliseconds spent in f
+template <typename F>
+double measure(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Parallel reduce/transform over one version with 1..64 threads
+void benchmarkParallelScaling(size_t size)
+{
+    std::cout << "PARALLEL SCALING, " << size << " elements\n";
+    std::cout << "threads\tarray reduce\tarray transform\tlist reduce\tmap reduce (ms)\n";
+
+    std::vector<long long> values(size);
+    std::vector<long long> keys(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        values[i] = static_cast<long long>(i % 1000);
+        keys[i] = static_cast<long long>((i * 2654435761u) % (size * 4)); // Scrambled keys keep the tree shallow
+    }
+
+    PersistentArray<long long> array(values, values.size());
+    PersistentDoublyLinkedList<long long> list(values, values.size());
+    PersistentAssociativeArray<long long, long long> map(keys, values, values.size());
+    auto plus = [](long long a, long long b) { return a + b; };
+
+    for (size_t threads = 1; threads <= 64; threads *= 2)
+    {
+        WorkStealingPool pool(threads);
+        long long checksum = 0;
+
+        double array_reduce = measure([&] { checksum += array.parallel_reduce(pool, 0, 0LL, plus); });
+        double array_transform = measure([&] { array.parallel_transform(pool, 0, [](const long long& value) { return value * 3; }); });
+        double list_reduce = measure([&] { checksum += list.parallel_reduce(pool, 0, 0LL, plus); });
+        double map_reduce = measure([&] { checksum += map.parallel_reduce(pool, 0, 0LL, plus); });
+
+        std::cout << threads << "\t" << array_reduce << "\t\t" << array_transform << "\t\t"
+            << list_reduce << "\t\t" << map_reduce << "\t(checksum " << checksum << ")\n";
+    }
+}
+
+// 64-byte plain struct
+struct Pod64
+{
+    double values[8];
+};
+
+// Wrapper with a user-provided copy constructor, which forces the boxed storage path for comparison
+template <typename T>
+struct Boxed
+{
+    T value{};
+
+    Boxed() = default;
+    Boxed(const T& value) : value(value) {}
+    Boxed(const Boxed& other) : value(other.value) {}
+    Boxed& operator=(const Boxed& other) = default;
+};
+
+// Build, edit and read back containers of one element type
+template <typename T>
+void benchmarkElementType(const char* name, size_t size)
+{
+    const int edits = 8;
+    std::vector<T> values(size);
+    double build = 0;
+    double edit = 0;
+    double read = 0;
+    double sequence_build = 0;
+    double sequence_read = 0;
+    size_t checksum = 0;
+
+    build = measure([&]
+    {
+        PersistentArray<T> array(values, values.size());
+        edit = measure([&]
+        {
+            for (int i = 0; i < edits; ++i)
+            {
+                array.addVersion(i, (i * 7919) % size, values[i]);
+            }
+        });
+        read = measure([&] { checksum += array.getVersion(edits).size(); });
+    });
+
+    PersistentSequence<T> sequence(std::vector<T>(), 0);
+    sequence_build = measure([&] { sequence = PersistentSequence<T>(values, values.size()); });
+    sequence_read = measure([&] { checksum += sequence.getVersion(0).size(); });
+
+    std::cout << name << "\t" << sizeof(T) << "\t" << build - edit - read << "\t\t" << edit / edits << "\t\t"
+        << read << "\t\t" << sequence_build << "\t\t" << sequence_read << "\t(checksum " << checksum << ")\n";
+}
+
+// Boxed vs unboxed storage for int, double and a 64-byte struct
+void benchmarkElementTypes(size_t size)
+{
+    std::cout << "ELEMENT TYPES, " << size << " elements\n";
+    std::cout << "type\tbytes\tarray build\taddVersion\tgetVersion\tsequence build\tsequence read (ms)\n";
+
+    benchmarkElementType<int>("int", size);
+    benchmarkElementType<Boxed<int>>("boxed int", size);
+    benchmarkElementType<double>("double", size);
+    benchmarkElementType<Boxed<double>>("boxed double", size);
+    benchmarkElementType<Pod64>("pod64", size);
+    benchmarkElementType<Boxed<Pod64>>("boxed pod64", size);
+}
+
+// Point lookups and range scans on the binary tree and the B+-tree associative arrays
+void benchmarkBTree(size_t size)
+{
+    std::cout << "B-TREE vs BINARY TREE, " << size << " keys\n";
+    std::cout << "tree\tbuild (ms)\taddVersion (us)\tlookup (ns)\t100-key scan (us)\tfull scan (ms)\n";
+
+    const size_t edits = 10000;
+    const size_t lookups = 1000000;
+    const size_t scans = 10000;
+    std::vector<long long> keys(size);
+    std::vector<long long> values(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        keys[i] = static_cast<long long>((i * 2654435761u) % (size * 4));
+        values[i] = static_cast<long long>(i);
+    }
+
+    auto run = [&](const char* name, auto& map, double build)
+    {
+        long long checksum = 0;
+        double edit = measure([&]
+        {
+            for (size_t i = 0; i < edits; ++i)
+            {
+                map.addVersion(static_cast<int>(i), keys[(i * 7919) % size], static_cast<long long>(i));
+            }
+        });
+        double lookup = measure([&]
+        {
+            for (size_t i = 0; i < lookups; ++i)
+            {
+                checksum += map.find(edits, keys[(i * 104729) % size]);
+            }
+        });
+        double range = measure([&]
+        {
+            for (size_t i = 0; i < scans; ++i)
+            {
+                long long low = keys[(i * 15485863) % size];
+                map.forEachInRange(edits, low, low + 400, [&checksum](long long, long long value) { checksum += value; });
+            }
+        });
+        double full = measure([&] { checksum += static_cast<long long>(map.getVersion(edits).size()); });
+
+        std::cout << name << "\t" << build << "\t" << edit * 1000 / edits << "\t\t" << lookup * 1000000 / lookups << "\t\t"
+            << range / scans * 1000 << "\t\t" << full << "\t(checksum " << checksum << ")\n";
+    };
+
+    PersistentAssociativeArray<long long, long long>* binary = nullptr;
+    double binary_build = measure([&] { binary = new PersistentAssociativeArray<long long, long long>(keys, values, size); });
+    run("binary", *binary, binary_build);
+    delete binary;
+
+    PersistentBTreeAssociativeArray<long long, long long>* btree = nullptr;
+    double btree_build = measure([&] { btree = new PersistentBTreeAssociativeArray<long long, long long>(keys, values, size); });
+    run("btree", *btree, btree_build);
+    delete btree;
+}
+
+// Scan through the history of an array: full getVersion of every version vs incremental updateVersion
+void benchmarkHistoryScan(size_t size)
+{
+    // Every array version owns a full spine, so the array is capped to keep the history in memory
+    size = std::min<size_t>(size, 100000);
+    const size_t edits = 200;
+    std::cout << "HISTORY SCAN, " << size << " elements, " << edits << " versions\n";
+
+    std::vector<long long> values(size);
+    PersistentArray<long long> array(values, static_cast<int>(values.size()));
+    for (size_t i = 0; i < edits; ++i)
+    {
+        array.addVersion(static_cast<int>(i), static_cast<int>((i * 7919) % size), static_cast<long long>(i));
+    }
+
+    long long checksum = 0;
+    double full = measure([&]
+    {
+        for (size_t k = 0; k <= edits; ++k)
+        {
+            checksum += array.getVersion(k)[k % size];
+        }
+    });
+    double incremental = measure([&]
+    {
+        std::vector<long long> buffer = array.getVersion(0);
+        for (size_t k = 1; k <= edits; ++k)
+        {
+            array.updateVersion(buffer, k - 1, k);
+            checksum += buffer[k % size];
+        }
+    });
+    std::cout << "getVersion\t" << full << " ms\nupdateVersion\t" << incremental << " ms\t(checksum " << checksum << ")\n";
+}
+
+// Base version of an associative array from a CSV file: streamed row by row vs parsed in parallel first
+void benchmarkCsvLoad(size_t size)
+{
+    std::cout << "CSV LOAD, " << size << " rows\n";
+    const std::string path = "benchmark_load.csv";
+
+    // Scrambled keys fall back to inserting (AA) or sorting (B+-tree), sorted keys are streamed
+    for (bool sorted : { false, true })
+    {
+        {
+            std::ofstream out(path);
+            for (size_t i = 0; i < size; ++i)
+            {
+                out << (sorted ? i : (i * 7919) % size) << ',' << i * 0.5 << '\n';
+            }
+        }
+
+        CsvRows<std::pair<long long, double>> rows(path);
+        double streamed = measure([&]
+        {
+            PersistentAssociativeArray<long long, double> map(rows.begin(), rows.end());
+        });
+        double streamed_btree = measure([&]
+        {
+            PersistentBTreeAssociativeArray<long long, double> tree(rows.begin(), rows.end());
+        });
+        std::cout << (sorted ? "sorted" : "scrambled") << " streamed\t" << streamed << " ms\t(B+-tree " << streamed_btree << " ms)\n";
+    }
+
+    CsvRows<std::pair<long long, double>> rows(path); // The sorted file
+
+    for (size_t threads = 1; threads <= std::max<size_t>(4, std::thread::hardware_concurrency()); threads *= 2)
+    {
+        WorkStealingPool pool(threads);
+        double parsed = 0;
+        double built = measure([&]
+        {
+            std::vector<std::pair<long long, double>> pairs;
+            parsed = measure([&] { pairs = rows.parseParallel(pool); });
+            PersistentAssociativeArray<long long, double> map(pairs.begin(), pairs.end());
+        });
+        std::cout << threads << " threads\t" << built << " ms\t(parse " << parsed << " ms)\n";
+    }
+    std::remove(path.c_str());
+}
+
+// Memory of a flag-toggling workload with and without hash-consing
+void benchmarkHashConsing(size_t size)
+{
+    size = std::min<size_t>(size, 200000);
+    const size_t edits = 20000;
+    const size_t flags = 64; // Hot keys toggled between 0 and 1
+    std::cout << "HASH-CONSING, " << size << " keys, " << edits << " toggles of " << flags << " flags\n";
+
+    std::vector<long long> keys(size);
+    std::vector<int> values(size, 0);
+    for (size_t i = 0; i < size; ++i)
+    {
+        keys[i] = static_cast<long long>((i * 2654435761u) % (size * 4));
+    }
+
+    for (bool consing : { false, true })
+    {
+        PersistentAssociativeArray<long long, int> map(keys, values, values.size());
+        if (consing)
+        {
+            map.enableHashConsing();
+        }
+        double elapsed = measure([&]
+        {
+            for (size_t i = 0; i < edits; ++i)
+            {
+                size_t flag = (i * 7919) % flags;
+                map.addVersion(static_cast<int>(i), keys[flag], map.find(i, keys[flag]) ^ 1);
+            }
+        });
+        MemoryStats stats = map.memoryStats(edits); // With hash-consing, total_bytes includes the intern table
+        std::cout << (consing ? "hash-consed" : "plain") << "\t" << stats.node_count << " nodes\t"
+            << stats.total_bytes / (1024.0 * 1024.0) << " MB\t(table " << stats.table_bytes / (1024.0 * 1024.0) << " MB)\t"
+            << elapsed << " ms\n";
+    }
+}
+
+// Shared_ptr nodes vs 32-bit indices into an arena: memory and speed of the same edits
+void benchmarkCompactNodes(size_t size)
+{
+    size = std::min<size_t>(size, 500000);
+    const size_t edits = 100000;
+    const size_t lookups = 1000000;
+    std::cout << "COMPACT NODES, " << size << " keys, " << edits << " versions\n";
+    std::cout << "tree\tnode (bytes)\tbuild (ms)\taddVersion (ms)\tlookup (ms)\tmemory (MB)\n";
+
+    std::vector<int> keys(size);
+    std::vector<int> values(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        keys[i] = static_cast<int>((i * 2654435761u) % (size * 4));
+        values[i] = static_cast<int>(i);
+    }
+
+    auto run = [&](const char* name, size_t node_bytes, auto make, auto bytes)
+    {
+        decltype(make()) map = nullptr;
+        double build = measure([&] { map = make(); });
+        double edit = measure([&]
+        {
+            for (size_t i = 0; i < edits; ++i)
+            {
+                map->addVersion(static_cast<int>(i), keys[(i * 7919) % size], static_cast<int>(i));
+            }
+        });
+        long long checksum = 0;
+        double lookup = measure([&]
+        {
+            for (size_t i = 0; i < lookups; ++i)
+            {
+                checksum += map->find(edits, keys[(i * 104729) % size]);
+            }
+        });
+        std::cout << name << "\t" << node_bytes << "\t" << build << "\t" << edit << "\t" << lookup << "\t"
+            << bytes(*map) / (1024.0 * 1024.0) << "\t(checksum " << checksum << ")\n";
+        delete map;
+    };
+
+    run("shared_ptr", sharedAllocationBytes<AA_node<int, int>>(),
+        [&] { return new PersistentAssociativeArray<int, int>(keys, values, values.size()); },
+        [&](const PersistentAssociativeArray<int, int>& map) { return map.memoryStats(edits).total_bytes; });
+    run("arena", sizeof(AA_compact_node<int, int>),
+        [&] { return new PersistentCompactAssociativeArray<int, int>(keys, values, values.size()); },
+        [&](const PersistentCompactAssociativeArray<int, int>& map) { return map.arenaBytes(); });
+}
+
+// FIFO workload: PersistentQueue vs the list emulation with push_back (O(n) tail walk)
+void benchmarkQueue(size_t size)
+{
+    // The list walks to its tail on every push, so its part is capped
+    const size_t pushes = std::min<size_t>(size, 20000);
+    std::cout << "QUEUE, " << pushes << " pushes then as many pops\n";
+
+    PersistentQueue<long long> queue;
+    double elapsed = measure([&]
+    {
+        for (size_t i = 0; i < pushes; ++i)
+        {
+            queue.push(static_cast<long long>(i));
+        }
+        for (size_t i = 0; i < pushes; ++i)
+        {
+            queue.pop();
+        }
+    });
+    std::cout << "queue\t" << elapsed << " ms\n";
+
+    long long values[] = { 0 };
+    PersistentDoublyLinkedList<long long> list(values, 1);
+    double emulated = measure([&]
+    {
+        for (size_t i = 1; i < pushes; ++i)
+        {
+            list.push_back(static_cast<long long>(i));
+        }
+    });
+    std::cout << "list push_back\t" << emulated << " ms (pushes only)\n";
+}
+
+// Write throughput of concurrent writers: one associative array behind a lock vs a sharded one
+void benchmarkShardedWrites(size_t size)
+{
+    // Every write keeps a new path of nodes alive, so the number of writes is capped
+    const size_t writes = std::min<size_t>(size, 50000);
+    const size_t shard_count = 16;
+    std::cout << "SHARDED WRITES, " << writes << " inserts, " << shard_count << " shards\n";
+
+    auto run = [&](size_t threads, auto write)
+    {
+        std::vector<std::thread> workers;
+        double elapsed = measure([&]
+        {
+            for (size_t t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&, t]
+                {
+                    for (size_t i = t; i < writes; i += threads)
+                    {
+                        write(static_cast<long long>((i * 2654435761u) % 4294967291u), static_cast<long long>(i));
+                    }
+                });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+        });
+        return writes / elapsed * 1000;
+    };
+
+    for (size_t threads = 1; threads <= std::max<size_t>(4, std::thread::hardware_concurrency()); threads *= 2)
+    {
+        PersistentAssociativeArray<long long, long long> single;
+        std::mutex single_mutex;
+        double locked = run(threads, [&](long long key, long long value)
+        {
+            std::lock_guard<std::mutex> lock(single_mutex);
+            single.addVersion(static_cast<int>(single.versionCount()) - 1, key, value);
+        });
+
+        PersistentShardedAssociativeArray<long long, long long> sharded(shard_count);
+        double parallel = run(threads, [&](long long key, long long value) { sharded.insert(key, value); });
+        sharded.commit();
+
+        std::cout << threads << " threads\tlocked " << locked << " writes/s\tsharded " << parallel << " writes/s\n";
+    }
+}
+
+// Peak resident memory of the process in MB, 0 where it is not available
+double peakMemoryMB()
+{
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // Kilobytes on Linux
+#else
+    return 0;
+#endif
+}
+
+// Record a mixed array workload as a sample trace
+void recordSampleTrace(const std::string& path, size_t size)
+{
+    std::vector<int> values(size);
+    PersistentArray<int> array(values, static_cast<int>(values.size()));
+    TraceRecorder<PersistentArray<int>> recorder(array);
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        int latest = static_cast<int>(array.versionCount()) - 1;
+        recorder.addVersion(latest - static_cast<int>(i % 3), (i * 7919) % size, static_cast<int>(i));
+        if (i % 50 == 0)
+        {
+            recorder.getVersion(latest);
+        }
+        if (i % 100 == 0)
+        {
+            recorder.undo();
+            recorder.redo();
+        }
+        if (i % 500 == 0)
+        {
+            recorder.convert(latest, [](const PersistentArray<int>& source, size_t idx) { return PersistentSequence<int>(source.getVersion(idx), static_cast<int>(source.getVersion(idx).size())); });
+        }
+    }
+    recorder.save(path);
+}
+
+// Replay a trace with 1..max_threads threads, each on its own synthetic container
+void benchmarkTraceReplay(const std::string& path, size_t max_threads)
+{
+    WorkloadTrace trace = WorkloadTrace::load(path);
+    std::cout << "TRACE REPLAY, " << path << ": " << trace.records.size() << " operations, base size " << trace.base_size << "\n";
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        LatencyRecorder latencies;
+        std::vector<std::thread> workers;
+        double elapsed = measure([&]
+        {
+            for (size_t i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&] { TraceReplayer::replay(trace, latencies); });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+        });
+
+        std::cout << threads << " threads: " << trace.records.size() * threads / elapsed * 1000 << " ops/s, "
+            << elapsed << " ms, peak memory " << peakMemoryMB() << " MB\n";
+        latencies.dump(std::cout);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string name = argc > 1 ? argv[1] : "all";
+    if (name == "trace")
+    {
+        std::string path = argc > 2 ? argv[2] : "sample.trace";
+        if (argc <= 2)
+        {
+            recordSampleTrace(path, 10000);
+        }
+        benchmarkTraceReplay(path, argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4);
+        return 0;
+    }
+
+    size_t size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+    if (name == "all" || name == "parallel")
+    {
+        benchmarkParallelScaling(size);
+    }
+    if (name == "all" || name == "types")
+    {
+        benchmarkElementTypes(size);
+    }
+    if (name == "all" || name == "btree")
+    {
+        benchmarkBTree(size);
+    }
+    if (name == "all" || name == "history")
+    {
+        benchmarkHistoryScan(size);
+    }
+    if (name == "all" || name == "load")
+    {
+        benchmarkCsvLoad(size);
+    }
+    if (name == "all" || name == "queue")
+    {
+        benchmarkQueue(size);
+    }
+    if (name == "all" || name == "compact")
+    {
+        benchmarkCompactNodes(size);
+    }
+    if (name == "all" || name == "hashcons")
+    {
+        benchmarkHashConsing(size);
+    }
+    if (name == "all" || name == "sharded")
+    {
+        benchmarkShardedWrites(size);
+    }
+
+    return 0;
+}
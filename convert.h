@@ -4,6 +4,11 @@
 #include "persistent_array.h"
 #include "persistent_doubly_linked_list.h"
 #include "persistent_associative_array.h"
+#include "persistent_btree.h"
+#include "persistent_hash_map.h"
+#include "persistent_queue.h"
+#include "persistent_sequence.h"
+#include "persistent_stack.h"
 
 template <typename T>
 class Convert
@@ -12,24 +17,28 @@ public:
     // Convert from PersistentArray to PersistentDoublyLinkedList
     static PersistentDoublyLinkedList<T> convertArrayToList(const PersistentArray<T>& array, size_t idx = 0)
     {
+        PERSISTENT_TIME_OPERATION(array.latencies(), LatencyOp::Convert);
         // Get the base version of the array
         auto base_version = array.getVersion(idx);
-        return PersistentDoublyLinkedList<T>(base_version, base_version.size());
+        return PersistentDoublyLinkedList<T>(std::move(base_version), base_version.size());
     }
 
     // Convert from PersistentDoublyLinkedList to PersistentArray
     static PersistentArray<T> convertListToArray(const PersistentDoublyLinkedList<T>& list, size_t idx = 0)
     {
+        PERSISTENT_TIME_OPERATION(list.latencies(), LatencyOp::Convert);
         // Get the base version of the list
         auto head = list.getVersion(idx);
 
-        return PersistentArray<T>(head, head.size());
+        size_t size = head.size();
+        return PersistentArray<T>(std::move(head), size);
     }
 
     // Convert from PersistentArray to PersistentAssociativeArray
     template<typename KeyType>
     static PersistentAssociativeArray<KeyType, T> convertArrayToAssociativeArray(const PersistentArray<T>& array, const std::vector<KeyType>& keys, size_t idx = 0)
     {
+        PERSISTENT_TIME_OPERATION(array.latencies(), LatencyOp::Convert);
         // Get the base version of the array
         auto base_version = array.getVersion(idx);
 
@@ -38,13 +47,14 @@ public:
             throw std::invalid_argument("Number of keys must match the number of elements in the array.");
         }
 
-        return PersistentAssociativeArray<KeyType, T>(keys, base_version, base_version.size());
+        return PersistentAssociativeArray<KeyType, T>(keys, std::move(base_version), base_version.size());
     }
 
     // Convert from PersistentDoublyLinkedList to PersistentAssociativeArray
     template<typename KeyType>
     static PersistentAssociativeArray<KeyType, T> convertListToAssociativeArray(const PersistentDoublyLinkedList<T>& list, const std::vector<KeyType>& keys, size_t idx = 0)
     {
+        PERSISTENT_TIME_OPERATION(list.latencies(), LatencyOp::Convert);
         // Get the base version of the list
         auto values = list.getVersion(idx);
 
@@ -53,24 +63,244 @@ public:
             throw std::invalid_argument("Number of keys must match the number of elements in the list.");
         }
 
-        return PersistentAssociativeArray<KeyType, T>(keys, values, values.size());
+        return PersistentAssociativeArray<KeyType, T>(keys, std::move(values), values.size());
     }
 
     // Convert from PersistentAssociativeArray to PersistentDoublyLinkedList
     template<typename KeyType>
     static PersistentDoublyLinkedList<T> convertAssociativeArrayToList(const PersistentAssociativeArray<KeyType, T>& associative_array, size_t idx = 0)
     {
+        PERSISTENT_TIME_OPERATION(associative_array.latencies(), LatencyOp::Convert);
         std::vector<T> values = associative_array.getVersion(idx);
 
-        return PersistentDoublyLinkedList<T>(values, values.size());
+        return PersistentDoublyLinkedList<T>(std::move(values), values.size());
     }
 
     // Convert from PersistentAssociativeArray to PersistentArray
     template<typename KeyType>
     static PersistentArray<T> convertAssociativeArrayToArray(const PersistentAssociativeArray<KeyType, T>& associative_array, size_t idx = 0) {
+        PERSISTENT_TIME_OPERATION(associative_array.latencies(), LatencyOp::Convert);
         std::vector<T> values = associative_array.getVersion(idx);
 
-        return PersistentArray<T>(values, values.size());
+        size_t size = values.size();
+        return PersistentArray<T>(std::move(values), size);
+    }
+
+    // Convert from PersistentArray to PersistentHashMap
+    template<typename KeyType, typename Hash = std::hash<KeyType>>
+    static PersistentHashMap<KeyType, T, Hash> convertArrayToHashMap(const PersistentArray<T>& array, const std::vector<KeyType>& keys, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(array.latencies(), LatencyOp::Convert);
+        auto base_version = array.getVersion(idx);
+
+        if (keys.size() != base_version.size())
+        {
+            throw std::invalid_argument("Number of keys must match the number of elements in the array.");
+        }
+
+        return PersistentHashMap<KeyType, T, Hash>(keys, base_version, base_version.size());
+    }
+
+    // Convert from PersistentDoublyLinkedList to PersistentHashMap
+    template<typename KeyType, typename Hash = std::hash<KeyType>>
+    static PersistentHashMap<KeyType, T, Hash> convertListToHashMap(const PersistentDoublyLinkedList<T>& list, const std::vector<KeyType>& keys, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(list.latencies(), LatencyOp::Convert);
+        auto values = list.getVersion(idx);
+
+        if (keys.size() != values.size())
+        {
+            throw std::invalid_argument("Number of keys must match the number of elements in the list.");
+        }
+
+        return PersistentHashMap<KeyType, T, Hash>(keys, values, values.size());
+    }
+
+    // Convert from PersistentHashMap to PersistentDoublyLinkedList (values in trie order)
+    template<typename KeyType, typename Hash>
+    static PersistentDoublyLinkedList<T> convertHashMapToList(const PersistentHashMap<KeyType, T, Hash>& hash_map, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(hash_map.latencies(), LatencyOp::Convert);
+        std::vector<T> values = hash_map.getVersion(idx);
+
+        return PersistentDoublyLinkedList<T>(std::move(values), values.size());
+    }
+
+    // Convert from PersistentHashMap to PersistentArray (values in trie order)
+    template<typename KeyType, typename Hash>
+    static PersistentArray<T> convertHashMapToArray(const PersistentHashMap<KeyType, T, Hash>& hash_map, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(hash_map.latencies(), LatencyOp::Convert);
+        std::vector<T> values = hash_map.getVersion(idx);
+
+        size_t size = values.size();
+        return PersistentArray<T>(std::move(values), size);
+    }
+
+    // Convert from PersistentAssociativeArray to PersistentHashMap, keeping the keys
+    template<typename KeyType, typename Hash = std::hash<KeyType>>
+    static PersistentHashMap<KeyType, T, Hash> convertAssociativeArrayToHashMap(const PersistentAssociativeArray<KeyType, T>& associative_array, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(associative_array.latencies(), LatencyOp::Convert);
+        std::vector<T> values = associative_array.getVersion(idx);
+
+        return PersistentHashMap<KeyType, T, Hash>(associative_array.getKeys(idx), values, values.size());
+    }
+
+    // Convert from PersistentHashMap to PersistentAssociativeArray, keeping the keys
+    template<typename KeyType, typename Hash>
+    static PersistentAssociativeArray<KeyType, T> convertHashMapToAssociativeArray(const PersistentHashMap<KeyType, T, Hash>& hash_map, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(hash_map.latencies(), LatencyOp::Convert);
+        std::vector<T> values = hash_map.getVersion(idx);
+
+        return PersistentAssociativeArray<KeyType, T>(hash_map.getKeys(idx), std::move(values), values.size());
+    }
+
+    // Convert from PersistentAssociativeArray to PersistentBTreeAssociativeArray, keeping the keys
+    template<typename KeyType>
+    static PersistentBTreeAssociativeArray<KeyType, T> convertAssociativeArrayToBTree(const PersistentAssociativeArray<KeyType, T>& associative_array, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(associative_array.latencies(), LatencyOp::Convert);
+        std::vector<T> values = associative_array.getVersion(idx);
+
+        size_t size = values.size();
+        return PersistentBTreeAssociativeArray<KeyType, T>(associative_array.getKeys(idx), std::move(values), size);
+    }
+
+    // Convert from PersistentBTreeAssociativeArray to PersistentAssociativeArray, keeping the keys
+    template<typename KeyType>
+    static PersistentAssociativeArray<KeyType, T> convertBTreeToAssociativeArray(const PersistentBTreeAssociativeArray<KeyType, T>& btree, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(btree.latencies(), LatencyOp::Convert);
+        std::vector<T> values = btree.getVersion(idx);
+
+        size_t size = values.size();
+        return PersistentAssociativeArray<KeyType, T>(btree.getKeys(idx), std::move(values), size);
+    }
+
+    // Convert from PersistentArray to PersistentSequence
+    static PersistentSequence<T> convertArrayToSequence(const PersistentArray<T>& array, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(array.latencies(), LatencyOp::Convert);
+        auto base_version = array.getVersion(idx);
+        return PersistentSequence<T>(base_version, base_version.size());
+    }
+
+    // Convert from PersistentDoublyLinkedList to PersistentSequence
+    static PersistentSequence<T> convertListToSequence(const PersistentDoublyLinkedList<T>& list, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(list.latencies(), LatencyOp::Convert);
+        auto values = list.getVersion(idx);
+        return PersistentSequence<T>(values, values.size());
+    }
+
+    // Convert from PersistentSequence to PersistentArray
+    static PersistentArray<T> convertSequenceToArray(const PersistentSequence<T>& sequence, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(sequence.latencies(), LatencyOp::Convert);
+        auto values = sequence.getVersion(idx);
+        size_t size = values.size();
+        return PersistentArray<T>(std::move(values), size);
+    }
+
+    // Convert from PersistentSequence to PersistentDoublyLinkedList
+    static PersistentDoublyLinkedList<T> convertSequenceToList(const PersistentSequence<T>& sequence, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(sequence.latencies(), LatencyOp::Convert);
+        auto values = sequence.getVersion(idx);
+        return PersistentDoublyLinkedList<T>(std::move(values), values.size());
+    }
+
+    // Start a new PersistentSequence from a version of another one.
+    // A sequence serves as both array and list, so this is the O(1) array <-> list path:
+    // the new base version shares the whole tree with the source.
+    static PersistentSequence<T> convertSequence(const PersistentSequence<T>& sequence, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(sequence.latencies(), LatencyOp::Convert);
+        return PersistentSequence<T>(sequence.getSequence(idx));
+    }
+
+    // Convert from PersistentArray to PersistentStack (the first element becomes the top)
+    static PersistentStack<T> convertArrayToStack(const PersistentArray<T>& array, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(array.latencies(), LatencyOp::Convert);
+        auto base_version = array.getVersion(idx);
+        return PersistentStack<T>(base_version, base_version.size());
+    }
+
+    // Convert from PersistentStack to PersistentArray (top first)
+    static PersistentArray<T> convertStackToArray(const PersistentStack<T>& stack, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(stack.latencies(), LatencyOp::Convert);
+        auto values = stack.getVersion(idx);
+        size_t size = values.size();
+        return PersistentArray<T>(std::move(values), size);
+    }
+
+    // Convert from PersistentDoublyLinkedList to PersistentStack (the head becomes the top)
+    static PersistentStack<T> convertListToStack(const PersistentDoublyLinkedList<T>& list, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(list.latencies(), LatencyOp::Convert);
+        auto values = list.getVersion(idx);
+        return PersistentStack<T>(values, values.size());
+    }
+
+    // Convert from PersistentStack to PersistentDoublyLinkedList (top first)
+    static PersistentDoublyLinkedList<T> convertStackToList(const PersistentStack<T>& stack, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(stack.latencies(), LatencyOp::Convert);
+        auto values = stack.getVersion(idx);
+        return PersistentDoublyLinkedList<T>(std::move(values), values.size());
+    }
+
+    // Convert from PersistentArray to PersistentQueue (the first element becomes the front)
+    static PersistentQueue<T> convertArrayToQueue(const PersistentArray<T>& array, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(array.latencies(), LatencyOp::Convert);
+        auto base_version = array.getVersion(idx);
+        return PersistentQueue<T>(base_version, base_version.size());
+    }
+
+    // Convert from PersistentQueue to PersistentArray (front first)
+    static PersistentArray<T> convertQueueToArray(const PersistentQueue<T>& queue, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(queue.latencies(), LatencyOp::Convert);
+        auto values = queue.getVersion(idx);
+        size_t size = values.size();
+        return PersistentArray<T>(std::move(values), size);
+    }
+
+    // Convert from PersistentDoublyLinkedList to PersistentQueue (the head becomes the front)
+    static PersistentQueue<T> convertListToQueue(const PersistentDoublyLinkedList<T>& list, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(list.latencies(), LatencyOp::Convert);
+        auto values = list.getVersion(idx);
+        return PersistentQueue<T>(values, values.size());
+    }
+
+    // Convert from PersistentQueue to PersistentDoublyLinkedList (front first)
+    static PersistentDoublyLinkedList<T> convertQueueToList(const PersistentQueue<T>& queue, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(queue.latencies(), LatencyOp::Convert);
+        auto values = queue.getVersion(idx);
+        return PersistentDoublyLinkedList<T>(std::move(values), values.size());
+    }
+
+    // Convert from PersistentSequence to PersistentQueue (the first element becomes the front)
+    static PersistentQueue<T> convertSequenceToQueue(const PersistentSequence<T>& sequence, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(sequence.latencies(), LatencyOp::Convert);
+        auto values = sequence.getVersion(idx);
+        return PersistentQueue<T>(values, values.size());
+    }
+
+    // Convert from PersistentQueue to PersistentSequence (front first)
+    static PersistentSequence<T> convertQueueToSequence(const PersistentQueue<T>& queue, size_t idx = 0)
+    {
+        PERSISTENT_TIME_OPERATION(queue.latencies(), LatencyOp::Convert);
+        auto values = queue.getVersion(idx);
+        return PersistentSequence<T>(values, values.size());
     }
 };
 
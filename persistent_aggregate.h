@@ -0,0 +1,204 @@
+#ifndef PERSISTENT_AGGREGATE_H
+#define PERSISTENT_AGGREGATE_H
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Monoids for augmented containers.
+// A monoid is a type with value_type, identity() and an associative combine(a, b).
+// Any user type with the same members can be passed as the Aggregate parameter
+// of PersistentArray and PersistentAssociativeArray.
+
+// Default parameter: no aggregates are kept and nothing is stored
+struct NoAggregate {};
+
+template <typename T>
+struct SumAggregate
+{
+    using value_type = T;
+
+    static T identity()
+    {
+        return T();
+    }
+
+    static T combine(const T& a, const T& b)
+    {
+        return a + b;
+    }
+};
+
+template <typename T>
+struct MinAggregate
+{
+    using value_type = T;
+
+    static T identity()
+    {
+        return std::numeric_limits<T>::max();
+    }
+
+    static T combine(const T& a, const T& b)
+    {
+        return b < a ? b : a;
+    }
+};
+
+template <typename T>
+struct MaxAggregate
+{
+    using value_type = T;
+
+    static T identity()
+    {
+        return std::numeric_limits<T>::lowest();
+    }
+
+    static T combine(const T& a, const T& b)
+    {
+        return a < b ? b : a;
+    }
+};
+
+// Aggregate stored in every tree node; empty (and free thanks to the empty base optimization) for NoAggregate
+template <typename Aggregate>
+struct AggregateSlot
+{
+    typename Aggregate::value_type aggregate = Aggregate::identity();
+};
+
+template <>
+struct AggregateSlot<NoAggregate> {};
+
+// Persistent segment tree kept next to the versions of an array.
+// Every version gets a root; a single-element change path-copies O(log n) nodes,
+// and the aggregate of any index range of any version is answered in O(log n).
+template <typename T, typename Aggregate>
+class ArrayAggregateIndex
+{
+private:
+    using Value = typename Aggregate::value_type;
+
+    struct Node
+    {
+        Value value;
+        std::shared_ptr<const Node> left;
+        std::shared_ptr<const Node> right;
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    std::vector<NodePtr> roots{};
+    std::vector<size_t> sizes{};
+
+    static NodePtr makeNode(NodePtr left, NodePtr right)
+    {
+        auto node = std::make_shared<Node>();
+        node->value = Aggregate::combine(left->value, right->value);
+        node->left = std::move(left);
+        node->right = std::move(right);
+        return node;
+    }
+
+    template <typename Getter>
+    static NodePtr build(size_t first, size_t last, Getter& get)
+    {
+        if (last - first == 1)
+        {
+            auto leaf = std::make_shared<Node>();
+            leaf->value = get(first);
+            return leaf;
+        }
+        size_t middle = first + (last - first) / 2;
+        return makeNode(build(first, middle, get), build(middle, last, get));
+    }
+
+    static NodePtr update(const NodePtr& node, size_t first, size_t last, size_t index, const T& value)
+    {
+        if (last - first == 1)
+        {
+            auto leaf = std::make_shared<Node>();
+            leaf->value = value;
+            return leaf;
+        }
+        size_t middle = first + (last - first) / 2;
+        if (index < middle)
+        {
+            return makeNode(update(node->left, first, middle, index, value), node->right);
+        }
+        return makeNode(node->left, update(node->right, middle, last, index, value));
+    }
+
+    static Value query(const Node* node, size_t first, size_t last, size_t query_first, size_t query_last)
+    {
+        if (query_first <= first && last <= query_last)
+        {
+            return node->value;
+        }
+        size_t middle = first + (last - first) / 2;
+        Value result = Aggregate::identity();
+        if (query_first < middle)
+        {
+            result = query(node->left.get(), first, middle, query_first, query_last);
+        }
+        if (middle < query_last)
+        {
+            result = Aggregate::combine(result, query(node->right.get(), middle, last, query_first, query_last));
+        }
+        return result;
+    }
+
+public:
+    // Method to add the tree of a version built from scratch; get(i) returns element i
+    template <typename Getter>
+    void pushBuilt(size_t size, Getter get)
+    {
+        roots.push_back(size == 0 ? nullptr : build(0, size, get));
+        sizes.push_back(size);
+    }
+
+    // Method to add the tree of a version that differs from parent in one element
+    void pushUpdated(size_t parent, size_t index, const T& value)
+    {
+        roots.push_back(update(roots[parent], 0, sizes[parent], index, value));
+        sizes.push_back(sizes[parent]);
+    }
+
+    // Method to add a version that shares the tree of another one (undo/redo)
+    void pushCopy(size_t source)
+    {
+        roots.push_back(roots[source]);
+        sizes.push_back(sizes[source]);
+    }
+
+    // Aggregate of elements [first, last) of a version
+    Value query(size_t version, size_t first, size_t last) const
+    {
+        if (first > last || last > sizes[version])
+        {
+            throw std::out_of_range("Invalid range");
+        }
+        if (first == last)
+        {
+            return Aggregate::identity();
+        }
+        return query(roots[version].get(), 0, sizes[version], first, last);
+    }
+};
+
+// Nothing is maintained without an aggregate; all hooks compile to nothing
+template <typename T>
+class ArrayAggregateIndex<T, NoAggregate>
+{
+public:
+    template <typename Getter>
+    void pushBuilt(size_t, Getter) {}
+
+    void pushUpdated(size_t, size_t, const T&) {}
+
+    void pushCopy(size_t) {}
+};
+
+#endif // PERSISTENT_AGGREGATE_H
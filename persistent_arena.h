@@ -0,0 +1,76 @@
+#ifndef PERSISTENT_ARENA_H
+#define PERSISTENT_ARENA_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// 32-bit link to a node in a NodeArena; 0 is the null link
+using NodeIndex = std::uint32_t;
+constexpr NodeIndex null_node = 0;
+
+// Chunked arena of nodes addressed by 32-bit indices.
+// A link costs 4 bytes instead of the 16 of a shared_ptr, and nodes need no control block
+// or separate heap allocation: they are placed in chunks of 2^ChunkBits nodes that never move.
+// Nodes are never freed one by one; the whole arena is released at once when it is destroyed
+// (see PersistentCompactAssociativeArray::compact for moving the live nodes to a new arena).
+template <typename Node, unsigned ChunkBits = 12>
+class NodeArena
+{
+public:
+    static constexpr size_t chunk_size = size_t(1) << ChunkBits;
+
+    NodeArena() = default;
+    NodeArena(NodeArena&&) = default;
+    NodeArena& operator=(NodeArena&&) = default;
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    // Method to place a new node in the arena; returns its index
+    template <typename... Args>
+    NodeIndex allocate(Args&&... args)
+    {
+        if (count == max_nodes)
+        {
+            throw std::length_error("Node arena is full");
+        }
+        if (count == chunks.size() * chunk_size)
+        {
+            chunks.emplace_back();
+            chunks.back().reserve(chunk_size); // Filled up to capacity, so nodes never move
+        }
+        chunks.back().push_back(Node{ std::forward<Args>(args)... });
+        return static_cast<NodeIndex>(++count);
+    }
+
+    Node& operator[](NodeIndex index)
+    {
+        return chunks[(index - 1) >> ChunkBits][(index - 1) & (chunk_size - 1)];
+    }
+
+    const Node& operator[](NodeIndex index) const
+    {
+        return chunks[(index - 1) >> ChunkBits][(index - 1) & (chunk_size - 1)];
+    }
+
+    // Number of allocated nodes; their indices are 1..size()
+    size_t size() const
+    {
+        return count;
+    }
+
+    // Bytes reserved by the chunks
+    size_t bytes() const
+    {
+        return chunks.size() * chunk_size * sizeof(Node);
+    }
+
+private:
+    static constexpr size_t max_nodes = UINT32_MAX;
+
+    std::vector<std::vector<Node>> chunks{};
+    size_t count{};
+};
+
+#endif // PERSISTENT_ARENA_H
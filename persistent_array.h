@@ -1,49 +1,178 @@
 #ifndef PERSISTENT_ARRAY_H
 #define PERSISTENT_ARRAY_H
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
 
-template <typename T>
+#include "persistent_aggregate.h"
+#include "persistent_journal.h"
+#include "persistent_latency.h"
+#include "persistent_lineage.h"
+#include "persistent_parallel.h"
+#include "persistent_simd.h"
+#include "persistent_stats.h"
+#include "persistent_storage.h"
+#include "persistent_version_index.h"
+
+// Aggregate: optional monoid (see persistent_aggregate.h); when given, every version
+// also keeps a persistent segment tree and rangeAggregate answers in O(log n)
+template <typename T, typename Aggregate = NoAggregate>
 class PersistentArray
 {
 private:
-    // Using a vector of pointers to elements
-    using Ptr = std::shared_ptr<T>;
-    std::vector<std::vector<Ptr>> versions; // All versions will be stored here
+    // Trivially copyable elements are stored by value, others through shared pointers
+    using Storage = ElementStorage<T>;
+    using Slot = typename Storage::Slot;
+    std::vector<std::vector<Slot>> versions; // All versions will be stored here
 
     int current_version;
 
+    OperationJournal* journal{}; // Optional write-ahead journal, not owned
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    ArrayAggregateIndex<T, Aggregate> aggregates{}; // One segment tree root per version
+
+    VersionLineage lineage{}; // Parent and changed element of every version
+
+    MemoryCounters memory{ sharedAllocationBytes<T>() }; // Every version also owns a spine of size() slots
+    VersionIndex version_index{}; // Creation time of every version and version tags
+
+    // Method to record the last stored version in the memory counters and the version index;
+    // unboxed elements live in the spine, so there are no element nodes to count
+    void countVersion(size_t new_nodes)
+    {
+        size_t size = versions.back().size();
+        memory.addNodes(Storage::unboxed ? 0 : new_nodes);
+        version_index.stamp();
+        memory.pushVersion(Storage::unboxed ? 0 : size, 1, size * sizeof(Slot));
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Time, VersionIndex::toNanoseconds(version_index.latest()));
+        }
+    }
+
+    // Number of elements gathered into a contiguous buffer per kernel call
+    static constexpr size_t kernel_chunk = 256;
+
+    // Method to pass a version to f as contiguous chunks.
+    // Unboxed versions are already contiguous; boxed values are gathered into a buffer first.
+    template <typename F>
+    void forEachChunk(size_t idx, F f) const
+    {
+        const std::vector<Slot>& version = versions[idx];
+        if constexpr (Storage::unboxed)
+        {
+            f(version.data(), version.size());
+            return;
+        }
+
+        T buffer[kernel_chunk];
+        for (size_t start = 0; start < version.size(); start += kernel_chunk)
+        {
+            size_t count = std::min(kernel_chunk, version.size() - start);
+            for (size_t i = 0; i < count; ++i)
+            {
+                buffer[i] = Storage::get(version[start + i]);
+            }
+            f(buffer, count);
+        }
+    }
+
+    void checkNonEmptyVersion(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        if (versions[idx].empty())
+        {
+            throw std::invalid_argument("Version is empty");
+        }
+    }
+
 public:
     // Constructor, accepts an array and its size
     PersistentArray(T* arr, int size)
         : current_version(0)
     {
-        std::vector<Ptr> base;
-        for (int i = 0; i < size; ++i)
+        std::vector<Slot> base;
+        Storage::assign(base, arr, size > 0 ? size : 0); // One memcpy for trivially copyable elements
+        versions.push_back(std::move(base)); // Store the base version
+        const std::vector<Slot>& stored = versions.back();
+        aggregates.pushBuilt(stored.size(), [&stored](size_t i) -> const T& { return Storage::get(stored[i]); });
+        lineage.pushRoot();
+        countVersion(stored.size());
+    }
+
+    // The vector is taken by value: pass it with std::move to move the elements instead of copying them
+    PersistentArray(std::vector<T> vec, int size)
+        : current_version(0)
+    {
+        std::vector<Slot> base;
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            base.reserve(vec.size());
+            for (bool value : vec) // std::vector<bool> has no data()
+            {
+                base.push_back(Storage::make(value));
+            }
+        }
+        else
         {
-            base.push_back(std::make_shared<T>(arr[i])); // Copy elements into shared_ptr
+            Storage::assignMoving(base, vec.data(), vec.size()); // One memcpy for trivially copyable elements
         }
-        versions.push_back(base); // Store the base version
+        versions.push_back(std::move(base)); // Store the base version
+        const std::vector<Slot>& stored = versions.back();
+        aggregates.pushBuilt(stored.size(), [&stored](size_t i) -> const T& { return Storage::get(stored[i]); });
+        lineage.pushRoot();
+        countVersion(stored.size());
     }
 
-    PersistentArray(std::vector<T> vec, int size)
+    // Constructor that builds the base version from an iterator range in one pass, without an
+    // intermediate vector; a range of T pointers (e.g. records of a mapped file) is copied with one memcpy
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentArray(InputIt first, InputIt last)
         : current_version(0)
     {
-        std::vector<Ptr> base;
-        for (const auto& val : vec)
+        std::vector<Slot> base;
+        if constexpr (std::is_pointer<InputIt>::value && std::is_same<typename std::decay<decltype(*first)>::type, T>::value)
         {
-            base.push_back(std::make_shared<T>(val)); // Copy elements into shared_ptr
+            Storage::assign(base, first, last - first);
         }
-        versions.push_back(base); // Store the base version
+        else
+        {
+            if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>::value)
+            {
+                base.reserve(std::distance(first, last));
+            }
+            for (; first != last; ++first)
+            {
+                base.push_back(Storage::emplace(*first));
+            }
+        }
+        versions.push_back(std::move(base)); // Store the base version
+        const std::vector<Slot>& stored = versions.back();
+        aggregates.pushBuilt(stored.size(), [&stored](size_t i) -> const T& { return Storage::get(stored[i]); });
+        lineage.pushRoot();
+        countVersion(stored.size());
     }
 
     // Method to add a new version of the array
     void addVersion(int root_position, int change_index, T new_value)
     {
+        emplaceVersion(root_position, change_index, std::move(new_value));
+    }
+
+    // Method to add a new version of the array with the changed element constructed in place from args
+    template <typename... Args>
+    void emplaceVersion(int root_position, int change_index, Args&&... args)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
         // Check the validity of indices
         if (current_version < 0 || current_version >= versions.size() ||
             root_position < 0 || root_position >= versions.size() ||
@@ -52,37 +181,63 @@ public:
             throw std::out_of_range("Invalid root position");
         }
 
-        std::vector<Ptr> new_version = versions[root_position]; // Copy pointers from the previous version
-        new_version[change_index] = std::make_shared<T>(new_value); // Replace the value with the new one
+        std::vector<Slot> new_version = versions[root_position]; // Copy slots from the previous version
+        new_version[change_index] = Storage::emplace(std::forward<Args>(args)...); // Replace the value with the new one
+
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::AddVersion, root_position, change_index, Storage::get(new_version[change_index]));
+        }
 
-        versions.push_back(new_version); // Store the new version
+        versions.push_back(std::move(new_version)); // Store the new version
+        aggregates.pushUpdated(root_position, change_index, Storage::get(versions.back()[change_index]));
+        lineage.pushEdit(root_position, change_index);
+        countVersion(1);
         current_version++;
     }
 
     // Method to undo the last action
     void undo()
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
         if (current_version <= 0)
         {
             std::cout << "No actions to undo!" << std::endl;
             return;
         }
 
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Undo);
+        }
+
         current_version--;
         versions.push_back(versions[current_version]);
+        aggregates.pushCopy(current_version);
+        lineage.pushCopy(current_version);
+        countVersion(0);
     }
 
     // Method to redo an action
     void redo()
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
         if (current_version >= versions.size() - 1)
         {
             std::cout << "No actions to redo!" << std::endl;
             return;
         }
 
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Redo);
+        }
+
         current_version++;
         versions.push_back(versions[current_version]);
+        aggregates.pushCopy(current_version);
+        lineage.pushCopy(current_version);
+        countVersion(0);
     }
 
     // Method to print all versions
@@ -93,7 +248,7 @@ public:
             std::cout << "Version [" << i << "]: \t{";
             for (size_t j = 0; j < versions[i].size(); j++)
             {
-                std::cout << *(versions[i][j]) << " (" << versions[i][j].get() << ")";
+                std::cout << Storage::get(versions[i][j]) << " (" << Storage::address(versions[i][j]) << ")";
                 if (j < versions[i].size() - 1)
                 {
                     std::cout << ", ";
@@ -103,18 +258,475 @@ public:
         }
     }
 
+    // Method to read one element without copying it
+    const T& at(size_t idx, size_t index) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        if (index >= versions[idx].size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        return Storage::get(versions[idx][index]);
+    }
+
     std::vector<T> getVersion(size_t idx) const
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
         if (idx < versions.size())
         {
-            std::vector<T> result;
-            for (const auto& ptr : versions[idx])
+            return Storage::values(versions[idx]); // Return the vector of values
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+
+    // Method to turn buffer, holding the contents of version from, into the contents of version to.
+    // Only the elements edited between the two versions are rewritten, so stepping through
+    // history (k, k + 1, ...) costs O(edits) instead of O(n); when a version in between
+    // rewrote every element, buffer is refilled. Returns the number of elements written.
+    size_t updateVersion(std::vector<T>& buffer, size_t from, size_t to) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        if (from >= versions.size() || to >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        if (buffer.size() != versions[from].size())
+        {
+            throw std::invalid_argument("Buffer does not hold the source version");
+        }
+
+        const std::vector<Slot>& target = versions[to];
+        std::vector<size_t> positions;
+        if (!lineage.changedPositions(from, to, positions, target.size()))
+        {
+            buffer = Storage::values(target);
+            return target.size();
+        }
+        for (size_t position : positions)
+        {
+            buffer[position] = Storage::get(target[position]);
+        }
+        return positions.size();
+    }
+
+    // Contents of version idx built from a copy of the already materialized version nearby_idx
+    std::vector<T> getVersion(size_t idx, const std::vector<T>& nearby, size_t nearby_idx) const
+    {
+        std::vector<T> result = nearby;
+        updateVersion(result, nearby_idx, idx);
+        return result;
+    }
+
+    // Sum of all elements of a version; vectorized for int and double
+    typename SimdKernels<T>::SumType sumVersion(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        typename SimdKernels<T>::SumType result{};
+        forEachChunk(idx, [&result](const T* data, size_t count)
+        {
+            result += SimdKernels<T>::sum(data, count);
+        });
+        return result;
+    }
+
+    T minVersion(size_t idx) const
+    {
+        checkNonEmptyVersion(idx);
+
+        T result = Storage::get(versions[idx][0]);
+        forEachChunk(idx, [&result](const T* data, size_t count)
+        {
+            result = std::min(result, SimdKernels<T>::min(data, count));
+        });
+        return result;
+    }
+
+    T maxVersion(size_t idx) const
+    {
+        checkNonEmptyVersion(idx);
+
+        T result = Storage::get(versions[idx][0]);
+        forEachChunk(idx, [&result](const T* data, size_t count)
+        {
+            result = std::max(result, SimdKernels<T>::max(data, count));
+        });
+        return result;
+    }
+
+    // Method to add a new version with every element of root_position multiplied by factor
+    void scaleVersion(int root_position, T factor)
+    {
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::ScaleVersion, root_position, factor);
+        }
+
+        std::vector<Slot> new_version;
+        if constexpr (Storage::unboxed)
+        {
+            // Scaled straight from the source storage into the new one
+            const std::vector<Slot>& source = versions[root_position];
+            new_version.resize(source.size());
+            SimdKernels<T>::scale(source.data(), new_version.data(), source.size(), factor);
+        }
+        else
+        {
+            new_version.reserve(versions[root_position].size());
+            T scaled[kernel_chunk];
+            forEachChunk(root_position, [&](const T* data, size_t count)
+            {
+                SimdKernels<T>::scale(data, scaled, count, factor);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    new_version.push_back(Storage::make(scaled[i]));
+                }
+            });
+        }
+
+        versions.push_back(std::move(new_version)); // Store the new version
+        const std::vector<Slot>& stored = versions.back();
+        aggregates.pushBuilt(stored.size(), [&stored](size_t i) -> const T& { return Storage::get(stored[i]); });
+        lineage.pushRewrite(root_position);
+        countVersion(stored.size());
+        current_version++;
+    }
+
+    // Number of positions where two versions hold equal values
+    size_t countEqualElements(size_t first_idx, size_t second_idx) const
+    {
+        if (first_idx >= versions.size() || second_idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        const std::vector<Slot>& first = versions[first_idx];
+        const std::vector<Slot>& second = versions[second_idx];
+        size_t size = std::min(first.size(), second.size());
+        if constexpr (Storage::unboxed)
+        {
+            return SimdKernels<T>::countEqual(first.data(), second.data(), size);
+        }
+
+        size_t result = 0;
+        T first_buffer[kernel_chunk];
+        T second_buffer[kernel_chunk];
+        for (size_t start = 0; start < size; start += kernel_chunk)
+        {
+            size_t count = std::min(kernel_chunk, size - start);
+            for (size_t i = 0; i < count; ++i)
             {
-                result.push_back(*ptr); // Copy value from shared_ptr
+                first_buffer[i] = Storage::get(first[start + i]);
+                second_buffer[i] = Storage::get(second[start + i]);
             }
-            return result; // Return the vector of values
+            result += SimdKernels<T>::countEqual(first_buffer, second_buffer, count);
         }
-        throw std::out_of_range("Invalid version index");
+        return result;
+    }
+
+    // Parallel reduction of a version with an associative combine function
+    template <typename Combine>
+    T parallel_reduce(WorkStealingPool& pool, size_t idx, T identity, Combine combine) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        // One partial result per chunk of the version, combined in order afterwards
+        const std::vector<Slot>& version = versions[idx];
+        size_t chunks = (version.size() + parallel_grain - 1) / parallel_grain;
+        std::vector<ChunkResult<T>> partial(chunks, ChunkResult<T>{ identity });
+        pool.parallelFor(chunks, 1, [&](size_t first, size_t last)
+        {
+            for (size_t chunk = first; chunk < last; ++chunk)
+            {
+                T result = identity;
+                size_t end = std::min(version.size(), (chunk + 1) * parallel_grain);
+                for (size_t i = chunk * parallel_grain; i < end; ++i)
+                {
+                    result = combine(result, Storage::get(version[i]));
+                }
+                partial[chunk].value = result;
+            }
+        });
+
+        T result = identity;
+        for (const auto& chunk : partial)
+        {
+            result = combine(result, chunk.value);
+        }
+        return result;
+    }
+
+    // Method to call f on every element of a version in parallel
+    template <typename F>
+    void parallel_for_each(WorkStealingPool& pool, size_t idx, F f) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        const std::vector<Slot>& version = versions[idx];
+        pool.parallelFor(version.size(), parallel_grain, [&](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                f(Storage::get(version[i]));
+            }
+        });
+    }
+
+    // Method to add a new version where every element is f(old element), computed in parallel
+    template <typename F>
+    void parallel_transform(WorkStealingPool& pool, int root_position, F f)
+    {
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+        if (journal)
+        {
+            throw std::logic_error("parallel_transform cannot be journaled");
+        }
+
+        const std::vector<Slot>& source = versions[root_position];
+        std::vector<Slot> new_version(source.size());
+        pool.parallelFor(source.size(), parallel_grain, [&](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                new_version[i] = Storage::make(f(Storage::get(source[i])));
+            }
+        });
+
+        versions.push_back(std::move(new_version)); // Store the new version
+        const std::vector<Slot>& stored = versions.back();
+        aggregates.pushBuilt(stored.size(), [&stored](size_t i) -> const T& { return Storage::get(stored[i]); });
+        lineage.pushRewrite(root_position);
+        countVersion(stored.size());
+        current_version++;
+    }
+
+    // Aggregate of elements [first, last) of a version, O(log n)
+    template <typename A = Aggregate>
+    typename A::value_type rangeAggregate(size_t idx, size_t first, size_t last) const
+    {
+
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return aggregates.query(idx, first, last);
+    }
+
+    // Memory and sharing statistics, O(1); the version part describes what idx allocated itself
+    MemoryStats memoryStats(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return memory.stats(idx);
+    }
+
+    // Read-only view of one version, safe to read on another thread while new versions are added:
+    // the slots of a version never change, and growing the version list moves the slot
+    // buffers without reallocating them. The array itself must outlive the snapshot.
+    class Snapshot
+    {
+    public:
+        size_t size() const
+        {
+            return count;
+        }
+
+        template <typename F>
+        void forEach(F f) const
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                f(Storage::get(slots[i]));
+            }
+        }
+
+    private:
+        friend class PersistentArray;
+
+        const Slot* slots{};
+        size_t count{};
+    };
+
+    // Snapshot of a version, O(1)
+    Snapshot snapshot(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        Snapshot result;
+        result.slots = versions[idx].data();
+        result.count = versions[idx].size();
+        return result;
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Method to name a version; every tag names exactly one version
+    void tagVersion(const std::string& tag, int idx)
+    {
+        if (idx < 0 || static_cast<size_t>(idx) >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        version_index.tag(tag, idx);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Tag, tag, idx);
+        }
+    }
+
+    // Version with the given tag, O(1)
+    size_t versionByTag(const std::string& tag) const
+    {
+        return version_index.byTag(tag);
+    }
+
+    // Version that was the latest one at the given time, O(log V)
+    size_t versionAsOf(VersionIndex::Clock::time_point time) const
+    {
+        return version_index.asOf(time);
+    }
+
+    // Time a version was created
+    VersionIndex::Clock::time_point versionTime(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return version_index.time(idx);
+    }
+
+    // Tags naming a version in lexicographic order
+    std::vector<std::string> versionTags(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return version_index.tagsOf(idx);
+    }
+
+    // Method to start journaling; writes the base version as the checkpoint record.
+    // Must be called before any edits so that replay reproduces the same version numbers.
+    void attachJournal(OperationJournal& new_journal)
+    {
+        if (versions.size() != 1)
+        {
+            throw std::logic_error("Journal must be attached before the first edit");
+        }
+
+        new_journal.append(OperationJournal::Op::Checkpoint, getVersion(0));
+        new_journal.append(OperationJournal::Op::Time, VersionIndex::toNanoseconds(version_index.time(0)));
+        journal = &new_journal;
+    }
+
+    // Method to continue journaling to a journal opened in Append mode, without a new checkpoint.
+    // The container must be the result of replayJournal on the same file, so that version numbers match.
+    void resumeJournal(OperationJournal& new_journal)
+    {
+        if (new_journal.recordCount() == 0)
+        {
+            throw std::logic_error("Journal has no checkpoint to resume from");
+        }
+        journal = &new_journal;
+    }
+
+    void detachJournal()
+    {
+        journal = nullptr;
+    }
+
+    // Rebuild an array from a journal: the checkpoint becomes version 0, then all logged operations are re-applied
+    static PersistentArray replayJournal(const std::string& path)
+    {
+        OperationJournal::Reader reader(path);
+        OperationJournal::Op op;
+        const char* payload;
+        const char* end;
+
+        if (!reader.next(op, payload, end) || op != OperationJournal::Op::Checkpoint)
+        {
+            throw std::runtime_error("Journal does not start with a checkpoint");
+        }
+        std::vector<T> base = JournalCodec<std::vector<T>>::read(payload, end);
+        PersistentArray result(base, base.size());
+
+        while (reader.next(op, payload, end))
+        {
+            switch (op)
+            {
+            case OperationJournal::Op::AddVersion:
+            {
+                int root_position = JournalCodec<int>::read(payload, end);
+                int change_index = JournalCodec<int>::read(payload, end);
+                result.addVersion(root_position, change_index, JournalCodec<T>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::ScaleVersion:
+            {
+                int root_position = JournalCodec<int>::read(payload, end);
+                result.scaleVersion(root_position, JournalCodec<T>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::Tag:
+            {
+                std::string tag = JournalCodec<std::string>::read(payload, end);
+                result.tagVersion(tag, JournalCodec<int>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::Time:
+                result.version_index.restamp(VersionIndex::fromNanoseconds(JournalCodec<std::int64_t>::read(payload, end)));
+                break;
+            case OperationJournal::Op::Undo:
+                result.undo();
+                break;
+            case OperationJournal::Op::Redo:
+                result.redo();
+                break;
+            default:
+                throw std::runtime_error("Unexpected journal record for PersistentArray");
+            }
+        }
+        return result;
     }
 
 };
@@ -124,4 +736,4 @@ int double_num(int number)
     return number * 2;
 }
 
-#endif // PERSISTENT_ARRAY_H
\ No newline at end of file
+#endif // PERSISTENT_ARRAY_H
\ No newline at end of file
@@ -1,65 +1,282 @@
 #ifndef PERSISTENT_ASSOCIATIVE_ARRAY_H
 #define PERSISTENT_ASSOCIATIVE_ARRAY_H
 
+#include <functional>
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <unordered_set>
 #include <utility>
 
-template <typename KeyType, typename ValueType>
-struct AA_node
+#include "persistent_aggregate.h"
+#include "persistent_hash_cons.h"
+#include "persistent_journal.h"
+#include "persistent_latency.h"
+#include "persistent_parallel.h"
+#include "persistent_stats.h"
+#include "persistent_storage.h"
+#include "persistent_version_index.h"
+
+// Value stored in a node. Path copying copies the nodes on the path to a key, so values that
+// are expensive to copy (e.g. strings) or cannot be copied at all (e.g. unique_ptr) are boxed in
+// a shared_ptr<const ValueType> that the copies share, as PersistentArray does; trivially
+// copyable values are stored in the node itself.
+template <typename ValueType, bool Unboxed = std::is_trivially_copyable<ValueType>::value>
+struct AA_value
+{
+    using Slot = ValueType;
+
+    static constexpr bool boxed = false;
+
+    static Slot make(ValueType&& value)
+    {
+        return std::move(value);
+    }
+
+    static const ValueType& get(const Slot& slot)
+    {
+        return slot;
+    }
+};
+
+template <typename ValueType>
+struct AA_value<ValueType, false>
+{
+    using Slot = std::shared_ptr<const ValueType>;
+
+    static constexpr bool boxed = true;
+
+    static Slot make(ValueType&& value)
+    {
+        return std::make_shared<const ValueType>(std::move(value));
+    }
+
+    static const ValueType& get(const Slot& slot)
+    {
+        return *slot;
+    }
+};
+
+template <typename KeyType, typename ValueType, typename Aggregate = NoAggregate>
+struct AA_node : AggregateSlot<Aggregate> // Aggregate of the subtree, nothing for NoAggregate
 {
     KeyType key{};
-    ValueType value{};
-    std::shared_ptr<AA_node<KeyType, ValueType>> left{};
-    std::shared_ptr<AA_node<KeyType, ValueType>> right{};
+    typename AA_value<ValueType>::Slot value{}; // Read it with AA_value<ValueType>::get
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> left{};
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> right{};
 
-    AA_node(KeyType k, ValueType v) : key(k), value(v), left(nullptr), right(nullptr) {}
+    AA_node(KeyType k, typename AA_value<ValueType>::Slot v) : key(std::move(k)), value(std::move(v)), left(nullptr), right(nullptr) {}
 };
 
-template <typename KeyType, typename ValueType>
+// Aggregate: optional monoid over the values (see persistent_aggregate.h); when given,
+// every node keeps the aggregate of its subtree and rangeAggregate answers in O(depth)
+template <typename KeyType, typename ValueType, typename Aggregate = NoAggregate>
 class PersistentAssociativeArray
 {
 private:
-    std::vector<std::shared_ptr<AA_node<KeyType, ValueType>>> versions{};
+    using ValueStorage = AA_value<ValueType>;
+    using ValueSlot = typename ValueStorage::Slot;
+
+    std::vector<std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>>> versions{};
+    std::vector<size_t> sizes{}; // Number of keys in every version
 
-    std::shared_ptr<AA_node<KeyType, ValueType>> insert(std::shared_ptr<AA_node<KeyType, ValueType>> root, KeyType key, ValueType value) {
+    MemoryCounters memory{ sharedAllocationBytes<AA_node<KeyType, ValueType, Aggregate>>() };
+    VersionIndex version_index{}; // Creation time of every version and version tags
+    size_t new_nodes{}; // Nodes allocated by the operation in progress
+    size_t separate_blocks{}; // How many of them have a separate control block
+
+    // Allocate a node and count it for the memory statistics. While hash-consing, the intern table
+    // holds weak references to the node, so it gets a separate control block: an expired entry
+    // then keeps only the small block alive, not the node.
+    template <typename... Args>
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> newNode(Args&&... args)
+    {
+        ++new_nodes;
+        if (hash_cons)
+        {
+            ++separate_blocks;
+            return std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>>(new AA_node<KeyType, ValueType, Aggregate>(std::forward<Args>(args)...));
+        }
+        return std::make_shared<AA_node<KeyType, ValueType, Aggregate>>(std::forward<Args>(args)...);
+    }
+
+    // Slot for a new value; a boxed value is one more allocation of the version being built
+    ValueSlot makeValue(ValueType&& value)
+    {
+        if (ValueStorage::boxed)
+        {
+            memory.addAllocations(1, sharedAllocationBytes<ValueType>());
+        }
+        return ValueStorage::make(std::move(value));
+    }
+
+    // Method to record the last stored version in the memory counters and the version index
+    void countVersion(size_t allocated)
+    {
+        memory.addNodes(allocated, separate_blocks);
+        separate_blocks = 0;
+        version_index.stamp();
+        memory.pushVersion(sizes.back());
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Time, VersionIndex::toNanoseconds(version_index.latest()));
+        }
+    }
+
+    // Node with the given fields and children; with hash-consing enabled an equal interned node is reused
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> makeNode(KeyType key, ValueSlot value,
+        std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> left, std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> right)
+    {
+        size_t hash = 0;
+        if (hash_cons)
+        {
+            hash = hash_cons->nodeHash(key, ValueStorage::get(value), left.get(), right.get());
+            auto interned = hash_cons->table.find(hash, [&](const AA_node<KeyType, ValueType, Aggregate>& node)
+            {
+                return node.left == left && node.right == right && !(node.key < key) && !(key < node.key) && hash_cons->equal(ValueStorage::get(node.value), ValueStorage::get(value));
+            });
+            if (interned)
+            {
+                return interned;
+            }
+        }
+
+        auto node = newNode(std::move(key), std::move(value));
+        node->left = std::move(left);
+        node->right = std::move(right);
+        refresh(*node);
+        if (hash_cons)
+        {
+            hash_cons->table.insert(hash, node);
+        }
+        return node;
+    }
+
+    // Recompute the aggregate of a node from its value and children
+    static void refresh(AA_node<KeyType, ValueType, Aggregate>& node)
+    {
+        if constexpr (!std::is_same<Aggregate, NoAggregate>::value)
+        {
+            auto result = node.left ? Aggregate::combine(node.left->aggregate, ValueStorage::get(node.value)) : ValueStorage::get(node.value);
+            node.aggregate = node.right ? Aggregate::combine(result, node.right->aggregate) : result;
+        }
+    }
+
+    // In-place insert, used while building the base version
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> insert(std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root, KeyType key, ValueType value, bool& added) {
         if (!root)
         {
-            return std::make_shared<AA_node<KeyType, ValueType>>(key, value);
+            added = true;
+            auto node = newNode(std::move(key), makeValue(std::move(value)));
+            refresh(*node);
+            return node;
         }
 
         if (key < root->key)
         {
-            root->left = insert(root->left, key, value);
+            root->left = insert(root->left, std::move(key), std::move(value), added);
         }
         else if (key > root->key)
         {
-            root->right = insert(root->right, key, value);
+            root->right = insert(root->right, std::move(key), std::move(value), added);
         }
         else
         {
-            root->value = value; // Update value when the key matches
+            root->value = makeValue(std::move(value)); // Update value when the key matches
         }
+        refresh(*root);
         return root; // Return the root for usage
     }
 
-    // Recursive function to copy the tree
-    std::shared_ptr<AA_node<KeyType, ValueType>> copyTree(std::shared_ptr<AA_node<KeyType, ValueType>> root) {
+    // Path-copying insert: only the nodes on the path to the key are copied,
+    // everything else is shared with the source version. The value is moved into its node.
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> insertPath(const std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>>& root, const KeyType& key, ValueType&& value, bool& added)
+    {
         if (!root)
         {
-            return nullptr;
+            added = true;
+            return makeNode(key, makeValue(std::move(value)), nullptr, nullptr);
         }
-        auto newNode = std::make_shared<AA_node<KeyType, ValueType>>(root->key, root->value);
-        newNode->left = copyTree(root->left);
-        newNode->right = copyTree(root->right);
-        return newNode;
+
+        if (!(key < root->key) && !(key > root->key))
+        {
+            // Update value when the key matches; the old value is not copied
+            return makeNode(root->key, makeValue(std::move(value)), root->left, root->right);
+        }
+
+        if (key < root->key)
+        {
+            return makeNode(root->key, root->value, insertPath(root->left, key, std::move(value), added), root->right);
+        }
+        return makeNode(root->key, root->value, root->left, insertPath(root->right, key, std::move(value), added));
+    }
+
+    // Path-copying delete; throws if the key is not in the tree
+    std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> erasePath(const std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>>& root, const KeyType& key)
+    {
+        if (!root)
+        {
+            throw std::runtime_error("Key not found");
+        }
+
+        if (key < root->key)
+        {
+            return makeNode(root->key, root->value, erasePath(root->left, key), root->right);
+        }
+        if (key > root->key)
+        {
+            return makeNode(root->key, root->value, root->left, erasePath(root->right, key));
+        }
+
+        // Node with at most one child is replaced by that child
+        if (!root->left)
+        {
+            return root->right;
+        }
+        if (!root->right)
+        {
+            return root->left;
+        }
+
+        // Otherwise the in-order successor takes the place of the node
+        const AA_node<KeyType, ValueType, Aggregate>* successor = root->right.get();
+        while (successor->left)
+        {
+            successor = successor->left.get();
+        }
+        return makeNode(successor->key, successor->value, root->left, erasePath(root->right, successor->key));
     }
 
     int current_version{};
-    std::vector<KeyType> keys;
+
+    OperationJournal* journal{}; // Optional write-ahead journal, not owned
+
+    // Hash-consing state; the hash and value comparison are only instantiated by enableHashConsing
+    struct HashConsing
+    {
+        std::function<size_t(const KeyType&, const ValueType&)> hash;
+        std::function<bool(const ValueType&, const ValueType&)> equal;
+        HashConsTable<AA_node<KeyType, ValueType, Aggregate>> table{};
+
+        size_t nodeHash(const KeyType& key, const ValueType& value, const void* left, const void* right) const
+        {
+            return hashCombine(hashCombine(hash(key, value), std::hash<const void*>{}(left)), std::hash<const void*>{}(right));
+        }
+    };
+    std::unique_ptr<HashConsing> hash_cons{}; // Optional, nullptr unless enabled
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
 
 public:
+    // Constructor of an associative array whose version 0 has no keys
+    PersistentAssociativeArray()
+    {
+        versions.push_back(nullptr);
+        sizes.push_back(0);
+        countVersion(0);
+        current_version = 0;
+    }
+
     PersistentAssociativeArray(const std::vector<KeyType>& keys, ValueType* values_array, size_t values_array_size)
     {
         if (keys.size() != values_array_size || keys.empty())
@@ -67,91 +284,316 @@ public:
             throw std::invalid_argument("Keys and values must have the same non-zero length.");
         }
 
-        std::shared_ptr<AA_node<KeyType, ValueType>> root = nullptr; // Issue occurred here
+        std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root = nullptr; // Issue occurred here
+        size_t size = 0;
 
         for (size_t i = 0; i < keys.size(); ++i)
         {
-            root = insert(root, keys[i], values_array[i]);
+            bool added = false;
+            root = insert(root, keys[i], values_array[i], added);
+            size += added ? 1 : 0;
         }
 
         versions.push_back(root);
+        sizes.push_back(size);
+        countVersion(new_nodes);
         current_version = 0;
-        this->keys = keys;
     }
 
     PersistentAssociativeArray(const std::vector<KeyType>& keys, const std::vector<ValueType>& values, size_t values_array_size)
     {
-        if (keys.size() != values.size() || keys.empty())
+        if (keys.size() != values_array_size || values.size() != values_array_size || keys.empty())
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root = nullptr;
+        size_t size = 0;
+
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            bool added = false;
+            root = insert(root, keys[i], values[i], added);
+            size += added ? 1 : 0;
+        }
+
+        versions.push_back(root);
+        sizes.push_back(size);
+        countVersion(new_nodes);
+        current_version = 0;
+    }
+
+    // Constructor that moves the values out of the vector
+    PersistentAssociativeArray(const std::vector<KeyType>& keys, std::vector<ValueType>&& values, size_t values_array_size)
+    {
+        if (keys.size() != values_array_size || values.size() != values_array_size || keys.empty())
         {
             throw std::invalid_argument("Keys and values must have the same non-zero length.");
         }
 
-        std::shared_ptr<AA_node<KeyType, ValueType>> root = nullptr;
+        std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root = nullptr;
+        size_t size = 0;
 
         for (size_t i = 0; i < keys.size(); ++i)
         {
-            root = insert(root, keys[i], values[i]);
+            bool added = false;
+            root = insert(root, keys[i], std::move(values[i]), added);
+            size += added ? 1 : 0;
+        }
+
+        versions.push_back(root);
+        sizes.push_back(size);
+        countVersion(new_nodes);
+        current_version = 0;
+    }
+
+    // Constructor from an iterator range of key/value pairs (anything with first and second),
+    // read in one pass without intermediate key and value vectors.
+    // Pairs in ascending key order are built into a balanced tree in O(n). From the first key out
+    // of order on, pairs are inserted one by one into the unbalanced tree as the other constructors
+    // do, so mostly descending input is O(n^2) with O(n) recursion depth: sort such input first.
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentAssociativeArray(InputIt first, InputIt last)
+    {
+        if (first == last)
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        // Nodes whose right subtree is still open, with the height of their complete left subtree;
+        // the heights decrease towards the back, so at most O(log n) nodes are pending
+        struct Pending
+        {
+            KeyType key;
+            ValueSlot value;
+            std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> left;
+            size_t height;
+        };
+        std::vector<Pending> pending;
+        auto close = [this](Pending& node, std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> right)
+        {
+            auto closed = newNode(std::move(node.key), std::move(node.value));
+            closed->left = std::move(node.left);
+            closed->right = std::move(right);
+            refresh(*closed);
+            return closed;
+        };
+
+        size_t size = 0;
+        for (; first != last; ++first)
+        {
+            if (!pending.empty() && !(pending.back().key < first->first))
+            {
+                if (first->first < pending.back().key)
+                {
+                    break;
+                }
+                pending.back().value = makeValue(ValueType(first->second)); // Update value when the key matches
+                continue;
+            }
+
+            // Complete subtrees of equal height are joined under the nodes between them
+            std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> subtree = nullptr;
+            size_t height = 0;
+            for (; !pending.empty() && pending.back().height == height; ++height)
+            {
+                subtree = close(pending.back(), std::move(subtree));
+                pending.pop_back();
+            }
+            pending.push_back(Pending{ first->first, makeValue(ValueType(first->second)), std::move(subtree), height });
+            size++;
+        }
+
+        std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root = nullptr;
+        for (; !pending.empty(); pending.pop_back())
+        {
+            root = close(pending.back(), std::move(root));
+        }
+
+        for (; first != last; ++first)
+        {
+            bool added = false;
+            root = insert(root, first->first, first->second, added);
+            size += added ? 1 : 0;
         }
 
         versions.push_back(root);
+        sizes.push_back(size);
+        countVersion(new_nodes);
         current_version = 0;
-        this->keys = keys;
     }
 
     // Function to add a new version with a value change
     void addVersion(int root_position, KeyType change_key, ValueType new_value)
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
         if (current_version < 0 || current_version >= versions.size() ||
             root_position < 0 || root_position >= versions.size())
         {
             throw std::out_of_range("Invalid root position");
         }
 
-        // Copy the tree from the specified version
-        auto new_root = copyTree(versions[root_position]);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::AddVersion, root_position, change_key, new_value);
+        }
 
-        // Insert the new value into the copied tree
-        insert(new_root, change_key, new_value);
+        // Copy the path to the key from the specified version and insert the new value
+        bool added = false;
+        new_nodes = 0;
+        auto new_root = insertPath(versions[root_position], change_key, std::move(new_value), added);
 
         // Add the new version to the vector
         versions.push_back(new_root);
+        sizes.push_back(sizes[root_position] + (added ? 1 : 0));
+        countVersion(new_nodes);
         current_version++;
     }
 
+    // Function to add a new version with the value constructed from args; it is then moved into its node.
+    // Path copies of the other nodes copy their values, or share them when they cannot be copied.
+    template <typename... Args>
+    void emplaceVersion(int root_position, KeyType change_key, Args&&... args)
+    {
+        addVersion(root_position, std::move(change_key), ValueType(std::forward<Args>(args)...));
+    }
+
+    // Function to add a new version with a key removed
+    void eraseVersion(int root_position, KeyType erase_key)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::EraseVersion);
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        // Copy the path to the key and unlink it; fails before anything is journaled
+        new_nodes = 0;
+        auto new_root = erasePath(versions[root_position], erase_key);
+
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Erase, root_position, erase_key);
+        }
+
+        versions.push_back(new_root);
+        sizes.push_back(sizes[root_position] - 1);
+        countVersion(new_nodes);
+        current_version++;
+    }
+
+    // Number of keys in a version, O(1)
+    size_t size(size_t idx) const
+    {
+        if (idx < versions.size())
+        {
+            return sizes[idx];
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+
+    // Function to find the value of a key in the given version
+    ValueType find(size_t idx, const KeyType& key) const
+    {
+        return at(idx, key);
+    }
+
+    // Method to read the value of a key without copying it
+    const ValueType& at(size_t idx, const KeyType& key) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        const AA_node<KeyType, ValueType, Aggregate>* node = versions[idx].get();
+        while (node)
+        {
+            if (key < node->key)
+            {
+                node = node->left.get();
+            }
+            else if (node->key < key)
+            {
+                node = node->right.get();
+            }
+            else
+            {
+                return ValueStorage::get(node->value);
+            }
+        }
+        throw std::runtime_error("Key not found");
+    }
+
+    // Method to call f(key, value) for the keys of a version in [low, high), in order
+    template <typename F>
+    void forEachInRange(size_t idx, const KeyType& low, const KeyType& high, F f) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        forEachInRangeNode(versions[idx].get(), low, high, f);
+    }
+
     // Test function for output
     void print()
     {
         for (const auto& version : versions)
         {
+            if (!version)
+            {
+                std::cout << "Version root: empty" << std::endl;
+                continue;
+            }
+
             // Print information for each node
-            std::cout << "Version root key: " << version->key << ", value: " << version->value << std::endl;
+            std::cout << "Version root key: " << version->key << ", value: " << ValueStorage::get(version->value) << std::endl;
         }
     }
 
     // Method to make UNDO action
     void undo()
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
         if (current_version <= 0)
         {
             std::cout << "No actions to undo!" << std::endl;
             return;
         }
 
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Undo);
+        }
+
         current_version--;
         versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+        countVersion(0);
     }
 
     // Method to make REDO action
     void redo()
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
         if (current_version >= versions.size() - 1)
         {
             std::cout << "No actions to redo!" << std::endl;
             return;
         }
 
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Redo);
+        }
+
         current_version++;  // Move to the next version
         versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+        countVersion(0);
     }
 
     // Function to print all versions
@@ -161,41 +603,37 @@ public:
         {
             std::cout << "Version [" << i << "]\t";
             std::cout << "{";
-            for (size_t j = 0; j < keys.size(); ++j)
-            {
-                std::cout << "'" << keys[j] << "': " << findValueInNode(versions[i], keys[j]);
-                if (j < keys.size() - 1)
-                {
-                    std::cout << ", ";
-                }
-            }
+            size_t printed = 0;
+            printNode(versions[i], printed, sizes[i]); // Keys present in this version, in order
             std::cout << "}" << std::endl;
         }
     }
 
-    ValueType findValueInNode(std::shared_ptr<AA_node<KeyType, ValueType>> root, const KeyType& key)
+    ValueType findValueInNode(std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root, const KeyType& key)
     {
-        if (!root)
-        {
-            throw std::runtime_error("Key not found"); // or return a default value
-        }
-
-        if (key < root->key)
-        {
-            return findValueInNode(root->left, key);
-        }
-        else if (key > root->key)
-        {
-            return findValueInNode(root->right, key);
-        }
-        else
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        const AA_node<KeyType, ValueType, Aggregate>* node = root.get();
+        while (node)
         {
-            return root->value; // Found the node with the corresponding key
+            if (key < node->key)
+            {
+                node = node->left.get();
+            }
+            else if (key > node->key)
+            {
+                node = node->right.get();
+            }
+            else
+            {
+                return ValueStorage::get(node->value); // Found the node with the corresponding key
+            }
         }
+        throw std::runtime_error("Key not found"); // or return a default value
     }
 
     std::vector<ValueType> getVersion(size_t idx) const
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
         if (idx < versions.size())
         {
             std::vector<ValueType> result;
@@ -205,8 +643,33 @@ public:
         throw std::out_of_range("Invalid version index");
     }
 
+    // Keys of a version in the same order as the values returned by getVersion
+    std::vector<KeyType> getKeys(size_t idx) const
+    {
+        if (idx < versions.size())
+        {
+            std::vector<KeyType> result;
+            collectKeys(versions[idx], result);
+            return result;
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+
+    // Recursive function to collect keys from the tree
+    void collectKeys(std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> node, std::vector<KeyType>& result) const
+    {
+        if (!node)
+        {
+            return;
+        }
+
+        collectKeys(node->left, result);
+        result.push_back(node->key);
+        collectKeys(node->right, result);
+    }
+
     // Recursive function to collect values from the tree
-    void collectValues(std::shared_ptr<AA_node<KeyType, ValueType>> node, std::vector<ValueType>& result) const
+    void collectValues(std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> node, std::vector<ValueType>& result) const
     {
         if (!node)
         {
@@ -217,11 +680,512 @@ public:
         collectValues(node->left, result);
 
         // Then add the current value
-        result.push_back(node->value);
+        result.push_back(ValueStorage::get(node->value));
 
         // And traverse the right subtree
         collectValues(node->right, result);
     }
+
+    // Parallel reduction of the values of a version (in key order) with an associative combine function
+    template <typename Combine>
+    ValueType parallel_reduce(WorkStealingPool& pool, size_t idx, ValueType identity, Combine combine) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return reduceNode(pool, versions[idx].get(), identity, combine, spawnDepth(pool));
+    }
+
+    // Method to call f on every value of a version in parallel
+    template <typename F>
+    void parallel_for_each(WorkStealingPool& pool, size_t idx, F f) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        forEachNode(pool, versions[idx].get(), f, spawnDepth(pool));
+    }
+
+    // Method to add a new version with the same keys and every value replaced by f(old value).
+    // The new tree has the shape of the source tree, subtrees are rebuilt in parallel.
+    template <typename F>
+    void parallel_transform(WorkStealingPool& pool, int root_position, F f)
+    {
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+        if (journal)
+        {
+            throw std::logic_error("parallel_transform cannot be journaled");
+        }
+
+        versions.push_back(transformNode(pool, versions[root_position].get(), f, spawnDepth(pool)));
+        sizes.push_back(sizes[root_position]);
+        if (ValueStorage::boxed)
+        {
+            memory.addAllocations(sizes[root_position], sizes[root_position] * sharedAllocationBytes<ValueType>());
+        }
+        countVersion(sizes[root_position]); // transformNode copies every node and value
+        current_version++;
+    }
+
+    // Aggregate of the values whose keys are in [low, high) in a version.
+    // Only one path is followed on each side of the range, so the cost is the depth of the tree
+    template <typename A = Aggregate>
+    typename A::value_type rangeAggregate(size_t idx, const KeyType& low, const KeyType& high) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return rangeAggregateNode(versions[idx].get(), &low, &high);
+    }
+
+    // Memory and sharing statistics, O(1); the version part describes what idx allocated itself.
+    // While hash-consing, the current size of the intern table is counted as table_bytes.
+    MemoryStats memoryStats(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        MemoryStats result = memory.stats(idx);
+        if (hash_cons)
+        {
+            result.table_bytes = hash_cons->table.bytes();
+            result.total_bytes += result.table_bytes;
+        }
+        return result;
+    }
+
+    // Read-only view of one version; it shares the immutable nodes of the version,
+    // so it can be read on another thread while new versions are added
+    class Snapshot
+    {
+    public:
+        size_t size() const
+        {
+            return count;
+        }
+
+        // Value of a key, O(depth)
+        ValueType find(const KeyType& key) const
+        {
+            const AA_node<KeyType, ValueType, Aggregate>* node = root.get();
+            while (node)
+            {
+                if (key < node->key)
+                {
+                    node = node->left.get();
+                }
+                else if (node->key < key)
+                {
+                    node = node->right.get();
+                }
+                else
+                {
+                    return ValueStorage::get(node->value);
+                }
+            }
+            throw std::runtime_error("Key not found");
+        }
+
+        // Method to call f(key, value) for every key in order
+        template <typename F>
+        void forEach(F f) const
+        {
+            std::vector<const AA_node<KeyType, ValueType, Aggregate>*> path;
+            const AA_node<KeyType, ValueType, Aggregate>* node = root.get();
+            while (node || !path.empty())
+            {
+                while (node)
+                {
+                    path.push_back(node);
+                    node = node->left.get();
+                }
+                node = path.back();
+                path.pop_back();
+                f(node->key, ValueStorage::get(node->value));
+                node = node->right.get();
+            }
+        }
+
+    private:
+        friend class PersistentAssociativeArray;
+
+        std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> root{};
+        size_t count{};
+    };
+
+    // Snapshot of a version, O(1)
+    Snapshot snapshot(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        Snapshot result;
+        result.root = versions[idx];
+        result.count = sizes[idx];
+        return result;
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Method to name a version; every tag names exactly one version
+    void tagVersion(const std::string& tag, int idx)
+    {
+        if (idx < 0 || static_cast<size_t>(idx) >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        version_index.tag(tag, idx);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Tag, tag, idx);
+        }
+    }
+
+    // Version with the given tag, O(1)
+    size_t versionByTag(const std::string& tag) const
+    {
+        return version_index.byTag(tag);
+    }
+
+    // Version that was the latest one at the given time, O(log V)
+    size_t versionAsOf(VersionIndex::Clock::time_point time) const
+    {
+        return version_index.asOf(time);
+    }
+
+    // Time a version was created
+    VersionIndex::Clock::time_point versionTime(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return version_index.time(idx);
+    }
+
+    // Tags naming a version in lexicographic order
+    std::vector<std::string> versionTags(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return version_index.tagsOf(idx);
+    }
+
+    // Method to start hash-consing: from now on a path copy equal to an existing node (same key,
+    // value and children) reuses that node, so a version that reverts to earlier contents shares
+    // the earlier subtrees, up to the whole tree, instead of allocating a new path.
+    // The nodes of the existing versions are interned first. Needs hashers for the keys and
+    // values and operator== on values; parallel_transform does not intern its copies.
+    template <typename KeyHash = std::hash<KeyType>, typename ValueHash = std::hash<ValueType>>
+    void enableHashConsing()
+    {
+        hash_cons = std::make_unique<HashConsing>();
+        hash_cons->hash = [](const KeyType& key, const ValueType& value) { return hashCombine(KeyHash{}(key), ValueHash{}(value)); };
+        hash_cons->equal = [](const ValueType& a, const ValueType& b) { return a == b; };
+
+        // Children are interned as they are, so the order of the walk does not matter
+        std::unordered_set<const AA_node<KeyType, ValueType, Aggregate>*> visited;
+        std::vector<std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>>> pending(versions.begin(), versions.end());
+        while (!pending.empty())
+        {
+            std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> node = std::move(pending.back());
+            pending.pop_back();
+            if (!node || !visited.insert(node.get()).second)
+            {
+                continue;
+            }
+
+            size_t hash = hash_cons->nodeHash(node->key, ValueStorage::get(node->value), node->left.get(), node->right.get());
+            hash_cons->table.insert(hash, node);
+            pending.push_back(node->left);
+            pending.push_back(node->right);
+        }
+    }
+
+    void disableHashConsing()
+    {
+        hash_cons.reset();
+    }
+
+    // Number of path copies that reused an interned node since hash-consing was enabled
+    std::uint64_t hashConsHits() const
+    {
+        return hash_cons ? hash_cons->table.hits() : 0;
+    }
+
+    // Method to start journaling; writes the base version as the checkpoint record.
+    // Must be called before any edits so that replay reproduces the same version numbers.
+    void attachJournal(OperationJournal& new_journal)
+    {
+        if (versions.size() != 1)
+        {
+            throw std::logic_error("Journal must be attached before the first edit");
+        }
+
+        std::vector<KeyType> base_keys;
+        std::vector<ValueType> base_values;
+        collectPairs(versions[0], base_keys, base_values);
+
+        new_journal.append(OperationJournal::Op::Checkpoint, base_keys, base_values);
+        new_journal.append(OperationJournal::Op::Time, VersionIndex::toNanoseconds(version_index.time(0)));
+        journal = &new_journal;
+    }
+
+    // Method to continue journaling to a journal opened in Append mode, without a new checkpoint.
+    // The container must be the result of replayJournal on the same file, so that version numbers match.
+    void resumeJournal(OperationJournal& new_journal)
+    {
+        if (new_journal.recordCount() == 0)
+        {
+            throw std::logic_error("Journal has no checkpoint to resume from");
+        }
+        journal = &new_journal;
+    }
+
+    void detachJournal()
+    {
+        journal = nullptr;
+    }
+
+    // Rebuild an associative array from a journal: the checkpoint becomes version 0, then all logged operations are re-applied
+    static PersistentAssociativeArray replayJournal(const std::string& path)
+    {
+        OperationJournal::Reader reader(path);
+        OperationJournal::Op op;
+        const char* payload;
+        const char* end;
+
+        if (!reader.next(op, payload, end) || op != OperationJournal::Op::Checkpoint)
+        {
+            throw std::runtime_error("Journal does not start with a checkpoint");
+        }
+        std::vector<KeyType> base_keys = JournalCodec<std::vector<KeyType>>::read(payload, end);
+        std::vector<ValueType> base_values = JournalCodec<std::vector<ValueType>>::read(payload, end);
+        PersistentAssociativeArray result(base_keys, base_values, base_values.size());
+
+        while (reader.next(op, payload, end))
+        {
+            switch (op)
+            {
+            case OperationJournal::Op::AddVersion:
+            {
+                int root_position = JournalCodec<int>::read(payload, end);
+                KeyType change_key = JournalCodec<KeyType>::read(payload, end);
+                result.addVersion(root_position, change_key, JournalCodec<ValueType>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::Erase:
+            {
+                int root_position = JournalCodec<int>::read(payload, end);
+                result.eraseVersion(root_position, JournalCodec<KeyType>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::Tag:
+            {
+                std::string tag = JournalCodec<std::string>::read(payload, end);
+                result.tagVersion(tag, JournalCodec<int>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::Time:
+                result.version_index.restamp(VersionIndex::fromNanoseconds(JournalCodec<std::int64_t>::read(payload, end)));
+                break;
+            case OperationJournal::Op::Undo:
+                result.undo();
+                break;
+            case OperationJournal::Op::Redo:
+                result.redo();
+                break;
+            default:
+                throw std::runtime_error("Unexpected journal record for PersistentAssociativeArray");
+            }
+        }
+        return result;
+    }
+
+private:
+    // Aggregate of keys in [*low, *high) of a subtree; nullptr bounds are open
+    template <typename A = Aggregate>
+    static typename A::value_type rangeAggregateNode(const AA_node<KeyType, ValueType, Aggregate>* node, const KeyType* low, const KeyType* high)
+    {
+        if (!node)
+        {
+            return Aggregate::identity();
+        }
+        if (!low && !high)
+        {
+            return node->aggregate; // Whole subtree is inside the range
+        }
+        if (low && node->key < *low)
+        {
+            return rangeAggregateNode(node->right.get(), low, high);
+        }
+        if (high && !(node->key < *high))
+        {
+            return rangeAggregateNode(node->left.get(), low, high);
+        }
+
+        // The node is inside the range: the left part is only bounded below, the right part only above
+        auto result = Aggregate::combine(rangeAggregateNode(node->left.get(), low, nullptr), ValueStorage::get(node->value));
+        return Aggregate::combine(result, rangeAggregateNode(node->right.get(), nullptr, high));
+    }
+
+    // Recursive function to visit the keys of a subtree in [low, high), skipping subtrees outside the range
+    template <typename F>
+    static void forEachInRangeNode(const AA_node<KeyType, ValueType, Aggregate>* node, const KeyType& low, const KeyType& high, F& f)
+    {
+        if (!node)
+        {
+            return;
+        }
+        if (low < node->key)
+        {
+            forEachInRangeNode(node->left.get(), low, high, f);
+        }
+        if (!(node->key < low) && node->key < high)
+        {
+            f(node->key, ValueStorage::get(node->value));
+        }
+        if (node->key < high)
+        {
+            forEachInRangeNode(node->right.get(), low, high, f);
+        }
+    }
+
+    // Subtrees are split into tasks down to this depth, below it the traversal is sequential
+    static int spawnDepth(const WorkStealingPool& pool)
+    {
+        int depth = 4;
+        for (size_t threads = pool.size(); threads > 1; threads /= 2)
+        {
+            ++depth;
+        }
+        return depth;
+    }
+
+    template <typename Combine>
+    static ValueType reduceNode(WorkStealingPool& pool, const AA_node<KeyType, ValueType, Aggregate>* node, const ValueType& identity, Combine& combine, int depth)
+    {
+        if (!node)
+        {
+            return identity;
+        }
+
+        ValueType left_result = identity;
+        if (depth > 0)
+        {
+            WorkStealingPool::TaskGroup group(pool);
+            group.spawn([&] { left_result = reduceNode(pool, node->left.get(), identity, combine, depth - 1); });
+            ValueType right_result = reduceNode(pool, node->right.get(), identity, combine, depth - 1);
+            group.wait();
+            return combine(combine(left_result, ValueStorage::get(node->value)), right_result);
+        }
+
+        left_result = reduceNode(pool, node->left.get(), identity, combine, 0);
+        return combine(combine(left_result, ValueStorage::get(node->value)), reduceNode(pool, node->right.get(), identity, combine, 0));
+    }
+
+    template <typename F>
+    static void forEachNode(WorkStealingPool& pool, const AA_node<KeyType, ValueType, Aggregate>* node, F& f, int depth)
+    {
+        if (!node)
+        {
+            return;
+        }
+
+        if (depth > 0)
+        {
+            WorkStealingPool::TaskGroup group(pool);
+            group.spawn([&] { forEachNode(pool, node->left.get(), f, depth - 1); });
+            f(ValueStorage::get(node->value));
+            forEachNode(pool, node->right.get(), f, depth - 1);
+            group.wait();
+            return;
+        }
+
+        forEachNode(pool, node->left.get(), f, 0);
+        f(ValueStorage::get(node->value));
+        forEachNode(pool, node->right.get(), f, 0);
+    }
+
+    template <typename F>
+    static std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> transformNode(WorkStealingPool& pool, const AA_node<KeyType, ValueType, Aggregate>* node, F& f, int depth)
+    {
+        if (!node)
+        {
+            return nullptr;
+        }
+
+        auto new_node = std::make_shared<AA_node<KeyType, ValueType, Aggregate>>(node->key, ValueStorage::make(f(ValueStorage::get(node->value))));
+        if (depth > 0)
+        {
+            WorkStealingPool::TaskGroup group(pool);
+            group.spawn([&] { new_node->left = transformNode(pool, node->left.get(), f, depth - 1); });
+            new_node->right = transformNode(pool, node->right.get(), f, depth - 1);
+            group.wait();
+            refresh(*new_node);
+            return new_node;
+        }
+
+        new_node->left = transformNode(pool, node->left.get(), f, 0);
+        new_node->right = transformNode(pool, node->right.get(), f, 0);
+        refresh(*new_node);
+        return new_node;
+    }
+
+    // Recursive function to print the key-value pairs of a tree in key order
+    void printNode(const std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>>& node, size_t& printed, size_t total) const
+    {
+        if (!node)
+        {
+            return;
+        }
+
+        printNode(node->left, printed, total);
+        std::cout << "'" << node->key << "': " << ValueStorage::get(node->value);
+        if (++printed < total)
+        {
+            std::cout << ", ";
+        }
+        printNode(node->right, printed, total);
+    }
+
+    // Recursive function to collect keys and values in pre-order,
+    // so that inserting them in this order rebuilds a tree of the same shape
+    void collectPairs(std::shared_ptr<AA_node<KeyType, ValueType, Aggregate>> node, std::vector<KeyType>& keys_out, std::vector<ValueType>& values_out) const
+    {
+        if (!node)
+        {
+            return;
+        }
+
+        keys_out.push_back(node->key);
+        values_out.push_back(ValueStorage::get(node->value));
+        collectPairs(node->left, keys_out, values_out);
+        collectPairs(node->right, keys_out, values_out);
+    }
 };
 
-#endif // PERSISTENT_ASSOCIATIVE_ARRAY_H
\ No newline at end of file
+#endif // PERSISTENT_ASSOCIATIVE_ARRAY_H
\ No newline at end of file
@@ -0,0 +1,874 @@
+#ifndef PERSISTENT_BTREE_H
+#define PERSISTENT_BTREE_H
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_latency.h"
+#include "persistent_storage.h"
+
+// Node sizes of the persistent B+-tree, chosen from the key and value sizes:
+// the keys searched in a node span a few cache lines (256 bytes of inner keys,
+// 512 bytes of leaf entries), between 4 and 64 entries per node.
+template <typename KeyType, typename ValueType>
+struct BTreeLayout
+{
+    static constexpr size_t inner_capacity = std::max<size_t>(4, std::min<size_t>(64, 256 / sizeof(KeyType)));
+    static constexpr size_t leaf_capacity = std::max<size_t>(4, std::min<size_t>(64, 512 / (sizeof(KeyType) + sizeof(ValueType))));
+};
+
+template <typename KeyType, typename ValueType>
+struct BTree_node
+{
+    unsigned count{}; // Number of used entries
+    bool leaf{};
+};
+
+// Keys and values are stored in sorted arrays inside the node, so a lookup touches
+// one node per level instead of one node per key comparison
+template <typename KeyType, typename ValueType>
+struct BTree_leaf : BTree_node<KeyType, ValueType>
+{
+    KeyType keys[BTreeLayout<KeyType, ValueType>::leaf_capacity];
+    ValueType values[BTreeLayout<KeyType, ValueType>::leaf_capacity];
+
+    BTree_leaf()
+    {
+        this->leaf = true;
+    }
+};
+
+template <typename KeyType, typename ValueType>
+struct BTree_inner : BTree_node<KeyType, ValueType>
+{
+    KeyType keys[BTreeLayout<KeyType, ValueType>::inner_capacity]; // keys[i] is the smallest key under children[i]
+    std::shared_ptr<const BTree_node<KeyType, ValueType>> children[BTreeLayout<KeyType, ValueType>::inner_capacity];
+};
+
+// Associative array on a persistent B+-tree.
+// Same interface as PersistentAssociativeArray, but the tree stays balanced and
+// every node holds many keys, so a lookup costs O(log n) with a few cache misses per level.
+// Updates copy the O(log n) nodes on the path to the key; everything else is shared.
+// Keys and values must be default constructible (node arrays are preallocated).
+template <typename KeyType, typename ValueType>
+class PersistentBTreeAssociativeArray
+{
+private:
+    using Node = BTree_node<KeyType, ValueType>;
+    using Leaf = BTree_leaf<KeyType, ValueType>;
+    using Inner = BTree_inner<KeyType, ValueType>;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    static constexpr size_t inner_capacity = BTreeLayout<KeyType, ValueType>::inner_capacity;
+    static constexpr size_t leaf_capacity = BTreeLayout<KeyType, ValueType>::leaf_capacity;
+
+    std::vector<NodePtr> versions{}; // Root of every version, nullptr for an empty version
+    std::vector<size_t> sizes{}; // Number of keys in every version
+
+    int current_version{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    // One node, or two halves when the entries did not fit into one
+    struct Split
+    {
+        NodePtr first;
+        NodePtr second;
+    };
+
+    static const Leaf& asLeaf(const Node* node)
+    {
+        return static_cast<const Leaf&>(*node);
+    }
+
+    static const Inner& asInner(const Node* node)
+    {
+        return static_cast<const Inner&>(*node);
+    }
+
+    static const KeyType& minKey(const Node* node)
+    {
+        return node->leaf ? asLeaf(node).keys[0] : asInner(node).keys[0];
+    }
+
+    // Position of the child whose subtree may hold key
+    static size_t childIndex(const Inner& node, const KeyType& key)
+    {
+        return std::upper_bound(node.keys + 1, node.keys + node.count, key) - node.keys - 1;
+    }
+
+    static size_t keyPosition(const Leaf& leaf, const KeyType& key)
+    {
+        return std::lower_bound(leaf.keys, leaf.keys + leaf.count, key) - leaf.keys;
+    }
+
+    static bool underfull(const Node* node)
+    {
+        return node->count < (node->leaf ? leaf_capacity : inner_capacity) / 2;
+    }
+
+    static NodePtr makeLeaf(KeyType* keys, ValueType* values, size_t count)
+    {
+        auto leaf = std::make_shared<Leaf>();
+        std::move(keys, keys + count, leaf->keys);
+        std::move(values, values + count, leaf->values);
+        leaf->count = static_cast<unsigned>(count);
+        return leaf;
+    }
+
+    static NodePtr makeInner(KeyType* keys, NodePtr* children, size_t count)
+    {
+        auto inner = std::make_shared<Inner>();
+        std::move(keys, keys + count, inner->keys);
+        std::move(children, children + count, inner->children);
+        inner->count = static_cast<unsigned>(count);
+        return inner;
+    }
+
+    static Split leafEntries(KeyType* keys, ValueType* values, size_t count)
+    {
+        if (count <= leaf_capacity)
+        {
+            return { makeLeaf(keys, values, count), nullptr };
+        }
+        size_t half = count / 2;
+        return { makeLeaf(keys, values, half), makeLeaf(keys + half, values + half, count - half) };
+    }
+
+    static Split innerEntries(KeyType* keys, NodePtr* children, size_t count)
+    {
+        if (count <= inner_capacity)
+        {
+            return { makeInner(keys, children, count), nullptr };
+        }
+        size_t half = count / 2;
+        return { makeInner(keys, children, half), makeInner(keys + half, children + half, count - half) };
+    }
+
+    // Path-copying insert; the copied node splits in two when it overflows
+    static Split insertNode(const Node* node, const KeyType& key, ValueType&& value, bool& added)
+    {
+        if (node->leaf)
+        {
+            const Leaf& leaf = asLeaf(node);
+            size_t position = keyPosition(leaf, key);
+            if (position < leaf.count && !(key < leaf.keys[position]))
+            {
+                auto copy = std::make_shared<Leaf>(leaf);
+                copy->values[position] = std::move(value); // Update value when the key matches
+                return { copy, nullptr };
+            }
+
+            added = true;
+            KeyType keys[leaf_capacity + 1];
+            ValueType values[leaf_capacity + 1];
+            std::copy(leaf.keys, leaf.keys + position, keys);
+            std::copy(leaf.values, leaf.values + position, values);
+            keys[position] = key;
+            values[position] = std::move(value);
+            std::copy(leaf.keys + position, leaf.keys + leaf.count, keys + position + 1);
+            std::copy(leaf.values + position, leaf.values + leaf.count, values + position + 1);
+            return leafEntries(keys, values, leaf.count + 1);
+        }
+
+        const Inner& inner = asInner(node);
+        size_t index = childIndex(inner, key);
+        Split child = insertNode(inner.children[index].get(), key, std::move(value), added);
+
+        KeyType keys[inner_capacity + 1];
+        NodePtr children[inner_capacity + 1];
+        std::copy(inner.keys, inner.keys + inner.count, keys);
+        std::copy(inner.children, inner.children + inner.count, children);
+        keys[index] = minKey(child.first.get());
+        children[index] = child.first;
+        size_t count = inner.count;
+        if (child.second)
+        {
+            std::move_backward(keys + index + 1, keys + count, keys + count + 1);
+            std::move_backward(children + index + 1, children + count, children + count + 1);
+            keys[index + 1] = minKey(child.second.get());
+            children[index + 1] = child.second;
+            ++count;
+        }
+        return innerEntries(keys, children, count);
+    }
+
+    // Redistribute the entries of two neighbouring nodes into one node, or two balanced ones
+    static Split rebalance(const Node* left, const Node* right)
+    {
+        if (left->leaf)
+        {
+            const Leaf& first = asLeaf(left);
+            const Leaf& second = asLeaf(right);
+            KeyType keys[2 * leaf_capacity];
+            ValueType values[2 * leaf_capacity];
+            std::copy(first.keys, first.keys + first.count, keys);
+            std::copy(first.values, first.values + first.count, values);
+            std::copy(second.keys, second.keys + second.count, keys + first.count);
+            std::copy(second.values, second.values + second.count, values + first.count);
+            return leafEntries(keys, values, first.count + second.count);
+        }
+
+        const Inner& first = asInner(left);
+        const Inner& second = asInner(right);
+        KeyType keys[2 * inner_capacity];
+        NodePtr children[2 * inner_capacity];
+        std::copy(first.keys, first.keys + first.count, keys);
+        std::copy(first.children, first.children + first.count, children);
+        std::copy(second.keys, second.keys + second.count, keys + first.count);
+        std::copy(second.children, second.children + second.count, children + first.count);
+        return innerEntries(keys, children, first.count + second.count);
+    }
+
+    // Path-copying delete; returns nullptr when the node became empty, throws if the key is not in the tree.
+    // An underfull child is merged with (or borrows from) a neighbour, which is copied as well.
+    static NodePtr eraseNode(const Node* node, const KeyType& key)
+    {
+        if (node->leaf)
+        {
+            const Leaf& leaf = asLeaf(node);
+            size_t position = keyPosition(leaf, key);
+            if (position == leaf.count || key < leaf.keys[position])
+            {
+                throw std::runtime_error("Key not found");
+            }
+            if (leaf.count == 1)
+            {
+                return nullptr;
+            }
+
+            KeyType keys[leaf_capacity];
+            ValueType values[leaf_capacity];
+            std::copy(leaf.keys, leaf.keys + position, keys);
+            std::copy(leaf.values, leaf.values + position, values);
+            std::copy(leaf.keys + position + 1, leaf.keys + leaf.count, keys + position);
+            std::copy(leaf.values + position + 1, leaf.values + leaf.count, values + position);
+            return makeLeaf(keys, values, leaf.count - 1);
+        }
+
+        const Inner& inner = asInner(node);
+        size_t index = childIndex(inner, key);
+        NodePtr child = eraseNode(inner.children[index].get(), key);
+
+        KeyType keys[inner_capacity + 1];
+        NodePtr children[inner_capacity + 1];
+        std::copy(inner.keys, inner.keys + inner.count, keys);
+        std::copy(inner.children, inner.children + inner.count, children);
+        size_t count = inner.count;
+
+        if (!child)
+        {
+            std::move(keys + index + 1, keys + count, keys + index);
+            std::move(children + index + 1, children + count, children + index);
+            --count;
+        }
+        else if (underfull(child.get()) && count > 1)
+        {
+            size_t left = index > 0 ? index - 1 : index;
+            const Node* first = left == index ? child.get() : children[left].get();
+            const Node* second = left == index ? children[index + 1].get() : child.get();
+            Split merged = rebalance(first, second);
+
+            keys[left] = minKey(merged.first.get());
+            children[left] = merged.first;
+            if (merged.second)
+            {
+                keys[left + 1] = minKey(merged.second.get());
+                children[left + 1] = merged.second;
+            }
+            else
+            {
+                std::move(keys + left + 2, keys + count, keys + left + 1);
+                std::move(children + left + 2, children + count, children + left + 1);
+                --count;
+            }
+        }
+        else
+        {
+            keys[index] = minKey(child.get());
+            children[index] = child;
+        }
+
+        if (count == 0)
+        {
+            return nullptr;
+        }
+        return makeInner(keys, children, count);
+    }
+
+    // Single-child inner roots are removed after an erase
+    static NodePtr collapse(NodePtr root)
+    {
+        while (root && !root->leaf && root->count == 1)
+        {
+            root = asInner(root.get()).children[0];
+        }
+        return root;
+    }
+
+    static const ValueType* findEntry(const Node* node, const KeyType& key)
+    {
+        if (!node)
+        {
+            return nullptr;
+        }
+        while (!node->leaf)
+        {
+            const Inner& inner = asInner(node);
+            node = inner.children[childIndex(inner, key)].get();
+        }
+
+        const Leaf& leaf = asLeaf(node);
+        size_t position = keyPosition(leaf, key);
+        if (position == leaf.count || key < leaf.keys[position])
+        {
+            return nullptr;
+        }
+        return &leaf.values[position];
+    }
+
+    // Bulk loader: entries arrive in ascending key order and are packed into full leaves, and the
+    // leaves into full inner levels, as they arrive; only one partial node per level is kept.
+    // A repeated key replaces the value of the previous entry, as a repeated insert would.
+    class Builder
+    {
+    public:
+        // Whether key can be added next
+        bool accepts(const KeyType& key) const
+        {
+            return count == 0 || !(key < keys[count - 1]);
+        }
+
+        // Method to add an entry; its key must be accepted
+        void add(KeyType key, ValueType value)
+        {
+            if (count > 0 && !(keys[count - 1] < key))
+            {
+                values[count - 1] = std::move(value);
+                return;
+            }
+            if (count == leaf_capacity)
+            {
+                push(0, makeLeaf(keys, values, count));
+                count = 0;
+            }
+            keys[count] = std::move(key);
+            values[count] = std::move(value);
+            count++;
+            entries++;
+        }
+
+        // Number of distinct keys added
+        size_t size() const
+        {
+            return entries;
+        }
+
+        // Method to close the partial nodes; returns the root, nullptr when nothing was added
+        NodePtr finish()
+        {
+            if (count > 0)
+            {
+                push(0, makeLeaf(keys, values, count));
+                count = 0;
+            }
+            for (size_t level = 0; level < levels.size(); ++level)
+            {
+                if (level + 1 == levels.size() && levels[level].size() == 1)
+                {
+                    return levels[level][0];
+                }
+                push(level + 1, makeParent(levels[level]));
+                levels[level].clear();
+            }
+            return nullptr;
+        }
+
+    private:
+        KeyType keys[leaf_capacity];
+        ValueType values[leaf_capacity];
+        size_t count{}; // Entries of the partial leaf
+        size_t entries{};
+        std::vector<std::vector<NodePtr>> levels{}; // Nodes of every level that wait for their parent
+
+        void push(size_t level, NodePtr node)
+        {
+            if (levels.size() == level)
+            {
+                levels.emplace_back();
+            }
+            if (levels[level].size() == inner_capacity)
+            {
+                NodePtr parent = makeParent(levels[level]);
+                levels[level].clear();
+                push(level + 1, std::move(parent));
+            }
+            levels[level].push_back(std::move(node));
+        }
+
+        static NodePtr makeParent(std::vector<NodePtr>& children)
+        {
+            KeyType inner_keys[inner_capacity];
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                inner_keys[i] = minKey(children[i].get());
+            }
+            return makeInner(inner_keys, children.data(), children.size());
+        }
+    };
+
+    void storeBase(Builder& builder)
+    {
+        sizes.push_back(builder.size());
+        versions.push_back(builder.finish());
+        current_version = 0;
+    }
+
+    // Sort the pairs by key and bulk load them; for repeated keys the last value wins, as with repeated inserts
+    void buildBase(std::vector<std::pair<KeyType, ValueType>> entries)
+    {
+        std::stable_sort(entries.begin(), entries.end(),
+            [](const std::pair<KeyType, ValueType>& a, const std::pair<KeyType, ValueType>& b) { return a.first < b.first; });
+
+        Builder builder;
+        for (auto& entry : entries)
+        {
+            builder.add(std::move(entry.first), std::move(entry.second));
+        }
+        storeBase(builder);
+    }
+
+    void checkRoot(int root_position) const
+    {
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+    }
+
+public:
+    // In-order cursor over one version.
+    // Nodes are shared between versions, so a leaf cannot link to its neighbour (relinking
+    // would copy every leaf before it); the cursor keeps its path from the root instead,
+    // and moving to the next leaf is amortized O(1).
+    class Cursor
+    {
+    public:
+        bool valid() const
+        {
+            return leaf != nullptr;
+        }
+
+        const KeyType& key() const
+        {
+            return leaf->keys[position];
+        }
+
+        const ValueType& value() const
+        {
+            return leaf->values[position];
+        }
+
+        void next()
+        {
+            if (++position < leaf->count)
+            {
+                return;
+            }
+
+            // Climb until an ancestor has a next child, then take its leftmost leaf
+            while (!path.empty())
+            {
+                auto& top = path.back();
+                if (++top.second < top.first->count)
+                {
+                    descendLeftmost(top.first->children[top.second].get());
+                    return;
+                }
+                path.pop_back();
+            }
+            leaf = nullptr;
+        }
+
+    private:
+        friend class PersistentBTreeAssociativeArray;
+
+        NodePtr root{}; // Keeps the version alive while the cursor exists
+        std::vector<std::pair<const Inner*, size_t>> path{};
+        const Leaf* leaf{};
+        size_t position{};
+
+        void descendLeftmost(const Node* node)
+        {
+            while (!node->leaf)
+            {
+                path.push_back({ &asInner(node), 0 });
+                node = asInner(node).children[0].get();
+            }
+            leaf = &asLeaf(node);
+            position = 0;
+        }
+    };
+
+    PersistentBTreeAssociativeArray(const std::vector<KeyType>& keys, ValueType* values_array, size_t values_array_size)
+    {
+        if (keys.size() != values_array_size || keys.empty())
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        std::vector<std::pair<KeyType, ValueType>> entries;
+        entries.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            entries.emplace_back(keys[i], values_array[i]);
+        }
+        buildBase(std::move(entries));
+    }
+
+    PersistentBTreeAssociativeArray(const std::vector<KeyType>& keys, const std::vector<ValueType>& values, size_t values_array_size)
+    {
+        if (keys.size() != values_array_size || values.size() != values_array_size || keys.empty())
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        std::vector<std::pair<KeyType, ValueType>> entries;
+        entries.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            entries.emplace_back(keys[i], values[i]);
+        }
+        buildBase(std::move(entries));
+    }
+
+    // Constructor from an iterator range of key/value pairs (anything with first and second).
+    // Pairs in ascending key order are streamed straight into the leaves, without a copy of the range.
+    // From the first key out of order on, the pairs are collected, with the ones already loaded, and sorted.
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentBTreeAssociativeArray(InputIt first, InputIt last)
+    {
+        if (first == last)
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        Builder builder;
+        for (; first != last && builder.accepts(first->first); ++first)
+        {
+            builder.add(first->first, first->second);
+        }
+        if (first == last)
+        {
+            storeBase(builder);
+            return;
+        }
+
+        std::vector<std::pair<KeyType, ValueType>> entries;
+        entries.reserve(builder.size());
+        Cursor loaded;
+        loaded.root = builder.finish(); // Not empty: the first pair is always accepted
+        for (loaded.descendLeftmost(loaded.root.get()); loaded.valid(); loaded.next())
+        {
+            entries.emplace_back(loaded.key(), loaded.value());
+        }
+        for (; first != last; ++first)
+        {
+            entries.emplace_back(first->first, first->second);
+        }
+        buildBase(std::move(entries));
+    }
+
+    // Function to add a new version with a value change
+    void addVersion(int root_position, KeyType change_key, ValueType new_value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        checkRoot(root_position);
+
+        bool added = false;
+        NodePtr new_root;
+        const Node* root = versions[root_position].get();
+        if (!root)
+        {
+            added = true;
+            new_root = makeLeaf(&change_key, &new_value, 1);
+        }
+        else
+        {
+            Split result = insertNode(root, change_key, std::move(new_value), added);
+            if (result.second)
+            {
+                // The root split: the tree grows by one level
+                KeyType keys[2] = { minKey(result.first.get()), minKey(result.second.get()) };
+                NodePtr children[2] = { result.first, result.second };
+                new_root = makeInner(keys, children, 2);
+            }
+            else
+            {
+                new_root = result.first;
+            }
+        }
+
+        versions.push_back(new_root);
+        sizes.push_back(sizes[root_position] + (added ? 1 : 0));
+        current_version++;
+    }
+
+    // Function to add a new version with a key removed
+    void eraseVersion(int root_position, KeyType erase_key)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::EraseVersion);
+        checkRoot(root_position);
+        if (!versions[root_position])
+        {
+            throw std::runtime_error("Key not found");
+        }
+
+        versions.push_back(collapse(eraseNode(versions[root_position].get(), erase_key)));
+        sizes.push_back(sizes[root_position] - 1);
+        current_version++;
+    }
+
+    // Method to make UNDO action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+    }
+
+    // Method to make REDO action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;  // Move to the next version
+        versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+    }
+
+    // Read-only view of one version; it shares the immutable nodes of the version,
+    // so it can be read on another thread while new versions are added
+    class Snapshot
+    {
+    public:
+        size_t size() const
+        {
+            return count;
+        }
+
+        // Method to call f(key, value) for every key in order
+        template <typename F>
+        void forEach(F f) const
+        {
+            for (Cursor cursor = first; cursor.valid(); cursor.next())
+            {
+                f(cursor.key(), cursor.value());
+            }
+        }
+
+    private:
+        friend class PersistentBTreeAssociativeArray;
+
+        Cursor first{};
+        size_t count{};
+    };
+
+    // Snapshot of a version, O(height)
+    Snapshot snapshot(size_t idx) const
+    {
+        Snapshot result;
+        result.first = begin(idx);
+        result.count = sizes[idx];
+        return result;
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Function to find the value of a key in the given version
+    ValueType find(size_t idx, const KeyType& key) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        const ValueType* value = findEntry(versions[idx].get(), key);
+        if (!value)
+        {
+            throw std::runtime_error("Key not found");
+        }
+        return *value;
+    }
+
+    bool contains(size_t idx, const KeyType& key) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return findEntry(versions[idx].get(), key) != nullptr;
+    }
+
+    size_t size(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return sizes[idx];
+    }
+
+    // Number of node levels of a version, 0 when it is empty
+    size_t height(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        size_t result = 0;
+        for (const Node* node = versions[idx].get(); node; node = node->leaf ? nullptr : asInner(node).children[0].get())
+        {
+            ++result;
+        }
+        return result;
+    }
+
+    // Cursor at the smallest key of a version
+    Cursor begin(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        Cursor cursor;
+        cursor.root = versions[idx];
+        if (cursor.root)
+        {
+            cursor.descendLeftmost(cursor.root.get());
+        }
+        return cursor;
+    }
+
+    // Cursor at the smallest key that is not less than key
+    Cursor lowerBound(size_t idx, const KeyType& key) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        Cursor cursor;
+        cursor.root = versions[idx];
+        const Node* node = cursor.root.get();
+        if (!node)
+        {
+            return cursor;
+        }
+        while (!node->leaf)
+        {
+            const Inner& inner = asInner(node);
+            size_t index = childIndex(inner, key);
+            cursor.path.push_back({ &inner, index });
+            node = inner.children[index].get();
+        }
+
+        cursor.leaf = &asLeaf(node);
+        cursor.position = keyPosition(*cursor.leaf, key);
+        if (cursor.position == cursor.leaf->count)
+        {
+            // Every key of this leaf is smaller: the answer is the first key of the next leaf
+            cursor.position--;
+            cursor.next();
+        }
+        return cursor;
+    }
+
+    // Method to call f(key, value) for the keys of a version in [low, high), in order
+    template <typename F>
+    void forEachInRange(size_t idx, const KeyType& low, const KeyType& high, F f) const
+    {
+        for (Cursor cursor = lowerBound(idx, low); cursor.valid() && cursor.key() < high; cursor.next())
+        {
+            f(cursor.key(), cursor.value());
+        }
+    }
+
+    std::vector<ValueType> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        std::vector<ValueType> result;
+        result.reserve(size(idx));
+        for (Cursor cursor = begin(idx); cursor.valid(); cursor.next())
+        {
+            result.push_back(cursor.value());
+        }
+        return result;
+    }
+
+    // Keys of a version in the same order as the values returned by getVersion
+    std::vector<KeyType> getKeys(size_t idx) const
+    {
+        std::vector<KeyType> result;
+        result.reserve(size(idx));
+        for (Cursor cursor = begin(idx); cursor.valid(); cursor.next())
+        {
+            result.push_back(cursor.key());
+        }
+        return result;
+    }
+
+    // Function to print all versions
+    void printAllVersions()
+    {
+        for (size_t i = 0; i < versions.size(); ++i)
+        {
+            std::cout << "Version [" << i << "]\t";
+            std::cout << "{";
+            for (Cursor cursor = begin(i); cursor.valid(); cursor.next())
+            {
+                std::cout << "'" << cursor.key() << "': " << cursor.value();
+                Cursor following = cursor;
+                following.next();
+                if (following.valid())
+                {
+                    std::cout << ", ";
+                }
+            }
+            std::cout << "}" << std::endl;
+        }
+    }
+};
+
+#endif // PERSISTENT_BTREE_H
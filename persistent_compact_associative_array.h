@@ -0,0 +1,520 @@
+#ifndef PERSISTENT_COMPACT_ASSOCIATIVE_ARRAY_H
+#define PERSISTENT_COMPACT_ASSOCIATIVE_ARRAY_H
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_arena.h"
+#include "persistent_latency.h"
+#include "persistent_storage.h"
+
+template <typename KeyType, typename ValueType>
+struct AA_compact_node
+{
+    KeyType key{};
+    ValueType value{};
+    NodeIndex left{};
+    NodeIndex right{};
+};
+
+// Associative array with the interface of PersistentAssociativeArray whose nodes live in a
+// NodeArena and link to each other with 32-bit indices. For small keys and values a node is
+// 2-4 times smaller than an AA_node with its shared_ptr links and control block, and adding a
+// version allocates no heap blocks except when a chunk fills up.
+// Nodes are not reference counted: dropVersion only forgets a version, and compact() copies the
+// nodes still reachable from the remaining versions into a new arena and releases the old one
+// in one piece. Version indices never change; reading a dropped version throws.
+template <typename KeyType, typename ValueType>
+class PersistentCompactAssociativeArray
+{
+private:
+    using Node = AA_compact_node<KeyType, ValueType>;
+
+    NodeArena<Node> arena{};
+    std::vector<NodeIndex> versions{};
+    std::vector<size_t> sizes{}; // Number of keys in every version
+    std::vector<bool> dropped{};
+    int current_version{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    // Bulk loader for the base version: keys arrive in ascending order and every node is closed as
+    // soon as its left subtree is complete, so the tree is balanced and built in O(n).
+    // A repeated key replaces the value of the previous pair, as a repeated insert would.
+    class Builder
+    {
+    public:
+        explicit Builder(NodeArena<Node>& arena) : arena(arena) {}
+
+        // Whether key can be added next
+        bool accepts(const KeyType& key) const
+        {
+            return pending.empty() || !(key < pending.back().key);
+        }
+
+        // Method to add a pair; its key must be accepted
+        void add(const KeyType& key, const ValueType& value)
+        {
+            if (!pending.empty() && !(pending.back().key < key))
+            {
+                pending.back().value = value;
+                return;
+            }
+
+            // Complete subtrees of equal height are joined under the nodes between them
+            NodeIndex subtree = null_node;
+            size_t height = 0;
+            for (; !pending.empty() && pending.back().height == height; ++height)
+            {
+                subtree = close(pending.back(), subtree);
+                pending.pop_back();
+            }
+            pending.push_back(Pending{ key, value, subtree, height });
+            entries++;
+        }
+
+        // Number of distinct keys added
+        size_t size() const
+        {
+            return entries;
+        }
+
+        // Method to close the pending nodes; returns the root, null_node when nothing was added
+        NodeIndex finish()
+        {
+            NodeIndex root = null_node;
+            for (; !pending.empty(); pending.pop_back())
+            {
+                root = close(pending.back(), root);
+            }
+            return root;
+        }
+
+    private:
+        // Node whose right subtree is still open, with the height of its complete left subtree;
+        // the heights decrease towards the back, so at most O(log n) nodes are pending
+        struct Pending
+        {
+            KeyType key;
+            ValueType value;
+            NodeIndex left;
+            size_t height;
+        };
+
+        NodeArena<Node>& arena;
+        std::vector<Pending> pending{};
+        size_t entries{};
+
+        NodeIndex close(Pending& node, NodeIndex right)
+        {
+            return arena.allocate(std::move(node.key), std::move(node.value), node.left, right);
+        }
+    };
+
+    // In-place insert, used while building the base version from keys out of order.
+    // Iterative, so the unbalanced tree such input builds costs time but no stack depth.
+    NodeIndex insert(NodeIndex root, const KeyType& key, const ValueType& value, bool& added)
+    {
+        NodeIndex* link = &root;
+        while (*link != null_node)
+        {
+            Node& node = arena[*link];
+            if (key < node.key)
+            {
+                link = &node.left;
+            }
+            else if (node.key < key)
+            {
+                link = &node.right;
+            }
+            else
+            {
+                node.value = value; // Update value when the key matches
+                return root;
+            }
+        }
+        added = true;
+        NodeIndex new_node = arena.allocate(key, value);
+        *link = new_node; // Chunks never move, so the link is still valid
+        return root;
+    }
+
+    // Path-copying insert: only the nodes on the path to the key are copied
+    NodeIndex insertPath(NodeIndex root, const KeyType& key, ValueType&& value, bool& added)
+    {
+        if (root == null_node)
+        {
+            added = true;
+            return arena.allocate(key, std::move(value));
+        }
+
+        const Node& node = arena[root];
+        if (key < node.key)
+        {
+            NodeIndex left = insertPath(node.left, key, std::move(value), added);
+            return arena.allocate(node.key, node.value, left, node.right);
+        }
+        if (node.key < key)
+        {
+            NodeIndex right = insertPath(node.right, key, std::move(value), added);
+            return arena.allocate(node.key, node.value, node.left, right);
+        }
+        return arena.allocate(node.key, std::move(value), node.left, node.right);
+    }
+
+    // Path-copying delete; throws if the key is not in the tree
+    NodeIndex erasePath(NodeIndex root, const KeyType& key)
+    {
+        if (root == null_node)
+        {
+            throw std::runtime_error("Key not found");
+        }
+
+        const Node& node = arena[root];
+        if (key < node.key)
+        {
+            NodeIndex left = erasePath(node.left, key);
+            return arena.allocate(node.key, node.value, left, node.right);
+        }
+        if (node.key < key)
+        {
+            NodeIndex right = erasePath(node.right, key);
+            return arena.allocate(node.key, node.value, node.left, right);
+        }
+
+        // Node with at most one child is replaced by that child
+        if (node.left == null_node)
+        {
+            return node.right;
+        }
+        if (node.right == null_node)
+        {
+            return node.left;
+        }
+
+        // Otherwise the in-order successor takes the place of the node
+        NodeIndex successor = node.right;
+        while (arena[successor].left != null_node)
+        {
+            successor = arena[successor].left;
+        }
+        NodeIndex right = erasePath(node.right, arena[successor].key);
+        return arena.allocate(arena[successor].key, arena[successor].value, node.left, right);
+    }
+
+    // Root of a version that can be read
+    NodeIndex root(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        if (dropped[idx])
+        {
+            throw std::out_of_range("Version was dropped");
+        }
+        return versions[idx];
+    }
+
+    void pushVersion(NodeIndex new_root, size_t size)
+    {
+        versions.push_back(new_root);
+        sizes.push_back(size);
+        dropped.push_back(false);
+    }
+
+    // Method to call f(node) for the nodes of a subtree in key order
+    template <typename F>
+    void inOrder(NodeIndex index, F& f) const
+    {
+        std::vector<NodeIndex> path;
+        while (index != null_node || !path.empty())
+        {
+            while (index != null_node)
+            {
+                path.push_back(index);
+                index = arena[index].left;
+            }
+            index = path.back();
+            path.pop_back();
+            f(arena[index]);
+            index = arena[index].right;
+        }
+    }
+
+public:
+    // Keys in ascending order are built into a balanced tree in O(n). From the first key out of
+    // order on, the pairs are inserted one by one into the unbalanced tree, so mostly descending
+    // input is O(n^2): sort such input first.
+    PersistentCompactAssociativeArray(const std::vector<KeyType>& keys, const std::vector<ValueType>& values, size_t values_array_size)
+    {
+        if (keys.size() != values_array_size || values.size() != values_array_size || keys.empty())
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        Builder builder(arena);
+        size_t i = 0;
+        for (; i < keys.size() && builder.accepts(keys[i]); ++i)
+        {
+            builder.add(keys[i], values[i]);
+        }
+        size_t size = builder.size();
+        NodeIndex new_root = builder.finish();
+        for (; i < keys.size(); ++i)
+        {
+            bool added = false;
+            new_root = insert(new_root, keys[i], values[i], added);
+            size += added ? 1 : 0;
+        }
+        pushVersion(new_root, size);
+        current_version = 0;
+    }
+
+    // Constructor from an iterator range of key/value pairs, read in one pass;
+    // balanced for ascending keys as the vector constructor
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentCompactAssociativeArray(InputIt first, InputIt last)
+    {
+        if (first == last)
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        Builder builder(arena);
+        for (; first != last && builder.accepts(first->first); ++first)
+        {
+            builder.add(first->first, first->second);
+        }
+        size_t size = builder.size();
+        NodeIndex new_root = builder.finish();
+        for (; first != last; ++first)
+        {
+            bool added = false;
+            new_root = insert(new_root, first->first, first->second, added);
+            size += added ? 1 : 0;
+        }
+        pushVersion(new_root, size);
+        current_version = 0;
+    }
+
+    // Function to add a new version with a value change
+    void addVersion(int root_position, KeyType change_key, ValueType new_value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        if (root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        bool added = false;
+        NodeIndex new_root = insertPath(root(root_position), change_key, std::move(new_value), added);
+        pushVersion(new_root, sizes[root_position] + (added ? 1 : 0));
+        current_version++;
+    }
+
+    // Function to add a new version with a key removed
+    void eraseVersion(int root_position, KeyType erase_key)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::EraseVersion);
+        if (root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        NodeIndex new_root = erasePath(root(root_position), erase_key);
+        pushVersion(new_root, sizes[root_position] - 1);
+        current_version++;
+    }
+
+    // Function to find the value of a key in the given version
+    ValueType find(size_t idx, const KeyType& key) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        NodeIndex index = root(idx);
+        while (index != null_node)
+        {
+            const Node& node = arena[index];
+            if (key < node.key)
+            {
+                index = node.left;
+            }
+            else if (node.key < key)
+            {
+                index = node.right;
+            }
+            else
+            {
+                return node.value;
+            }
+        }
+        throw std::runtime_error("Key not found");
+    }
+
+    // Number of keys in a version, O(1)
+    size_t size(size_t idx) const
+    {
+        root(idx);
+        return sizes[idx];
+    }
+
+    std::vector<ValueType> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        std::vector<ValueType> result;
+        auto collect = [&](const Node& node) { result.push_back(node.value); };
+        inOrder(root(idx), collect);
+        return result;
+    }
+
+    // Keys of a version in the same order as the values returned by getVersion
+    std::vector<KeyType> getKeys(size_t idx) const
+    {
+        std::vector<KeyType> result;
+        auto collect = [&](const Node& node) { result.push_back(node.key); };
+        inOrder(root(idx), collect);
+        return result;
+    }
+
+    // Method to make UNDO action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        pushVersion(root(current_version - 1), sizes[current_version - 1]);
+        current_version--;
+    }
+
+    // Method to make REDO action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        pushVersion(root(current_version + 1), sizes[current_version + 1]);
+        current_version++;  // Move to the next version
+    }
+
+    // Function to print all versions
+    void printAllVersions() const
+    {
+        for (size_t i = 0; i < versions.size(); ++i)
+        {
+            std::cout << "Version [" << i << "]\t";
+            if (dropped[i])
+            {
+                std::cout << "dropped" << std::endl;
+                continue;
+            }
+
+            std::cout << "{";
+            size_t printed = 0;
+            auto print = [&](const Node& node) { std::cout << (printed++ ? ", " : "") << "'" << node.key << "': " << node.value; };
+            inOrder(versions[i], print);
+            std::cout << "}" << std::endl;
+        }
+    }
+
+    // Method to forget a version; its nodes are released by the next compact() unless other versions share them
+    void dropVersion(size_t idx)
+    {
+        root(idx);
+        dropped[idx] = true;
+        versions[idx] = null_node;
+    }
+
+    // Method to move the nodes reachable from the remaining versions to a new arena and release the old one at once.
+    // Shared nodes stay shared; returns the number of nodes released.
+    size_t compact()
+    {
+        // Mark the live nodes
+        std::vector<bool> live(arena.size() + 1, false);
+        std::vector<NodeIndex> pending;
+        for (NodeIndex version_root : versions)
+        {
+            pending.push_back(version_root);
+            while (!pending.empty())
+            {
+                NodeIndex index = pending.back();
+                pending.pop_back();
+                if (index == null_node || live[index])
+                {
+                    continue;
+                }
+                live[index] = true;
+                pending.push_back(arena[index].left);
+                pending.push_back(arena[index].right);
+            }
+        }
+
+        // Copy them in their old order, then redirect the links to the new indices
+        NodeArena<Node> compacted;
+        std::vector<NodeIndex> moved(arena.size() + 1, null_node);
+        for (NodeIndex index = 1; index <= arena.size(); ++index)
+        {
+            if (live[index])
+            {
+                moved[index] = compacted.allocate(std::move(arena[index]));
+            }
+        }
+        for (NodeIndex index = 1; index <= compacted.size(); ++index)
+        {
+            compacted[index].left = moved[compacted[index].left];
+            compacted[index].right = moved[compacted[index].right];
+        }
+        for (NodeIndex& version_root : versions)
+        {
+            version_root = moved[version_root];
+        }
+
+        size_t released = arena.size() - compacted.size();
+        arena = std::move(compacted);
+        return released;
+    }
+
+    bool isDropped(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return dropped[idx];
+    }
+
+    // Number of stored versions, dropped ones included; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Number of nodes in the arena
+    size_t nodeCount() const
+    {
+        return arena.size();
+    }
+
+    // Bytes reserved by the arena
+    size_t arenaBytes() const
+    {
+        return arena.bytes();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+};
+
+#endif // PERSISTENT_COMPACT_ASSOCIATIVE_ARRAY_H
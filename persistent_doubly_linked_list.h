@@ -1,11 +1,20 @@
 #ifndef PERSISTENT_DOUBLY_LINKED_LIST_H
 #define PERSISTENT_DOUBLY_LINKED_LIST_H
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
+#include "persistent_journal.h"
+#include "persistent_latency.h"
+#include "persistent_parallel.h"
+#include "persistent_stats.h"
+#include "persistent_storage.h"
+#include "persistent_version_index.h"
+
 template <typename T>
 struct DL_node
 {
@@ -13,7 +22,174 @@ struct DL_node
     std::shared_ptr<DL_node<T>> prev;
     std::shared_ptr<DL_node<T>> next;
 
-    DL_node(T data) : value(data), prev(nullptr), next(nullptr) {}
+    DL_node(T data) : value(std::move(data)), prev(nullptr), next(nullptr) {}
+
+    // Construct the value in place from args
+    template <typename... Args>
+    DL_node(std::in_place_t, Args&&... args) : value(std::forward<Args>(args)...), prev(nullptr), next(nullptr) {}
+};
+
+// Persistent cursor (zipper) over a list: the elements before the focus are kept as a
+// stack with the nearest element on top, the focus and the elements after it as another.
+// Moving, inserting, erasing and replacing at the focus are O(1) and return a new cursor
+// that shares both stacks with the old one; old cursors stay valid and unchanged.
+// The stacks point to the nodes of the source version, values are only copied by commit.
+// The part of the source version that was never reached is read lazily from its nodes,
+// and a committed version shares it with the source version.
+template <typename T>
+class ListCursor
+{
+public:
+    // Number of elements before the focus; equal to size() when the cursor is past the end
+    size_t position() const
+    {
+        return left_size;
+    }
+
+    size_t size() const
+    {
+        return left_size + right_size + tail_count;
+    }
+
+    bool atFront() const
+    {
+        return left_size == 0;
+    }
+
+    bool atEnd() const
+    {
+        return right_size + tail_count == 0;
+    }
+
+    const T& focus() const
+    {
+        checkFocus();
+        return right ? right->node->value : tail->value;
+    }
+
+    ListCursor moveLeft() const
+    {
+        if (atFront())
+        {
+            throw std::out_of_range("Cursor is at the front");
+        }
+
+        ListCursor result = *this;
+        result.right = std::make_shared<const Cell>(Cell{ left->node, right });
+        result.left = left->next;
+        result.left_size--;
+        result.right_size++;
+        return result;
+    }
+
+    ListCursor moveRight() const
+    {
+        if (atEnd())
+        {
+            throw std::out_of_range("Cursor is at the end");
+        }
+
+        ListCursor result = dropFocus();
+        result.left = std::make_shared<const Cell>(Cell{ right ? right->node : tail, left });
+        result.left_size++;
+        return result;
+    }
+
+    // Method to insert a value before the focus; the new value becomes the focus
+    ListCursor insert(T value) const
+    {
+        ListCursor result = *this;
+        result.right = std::make_shared<const Cell>(Cell{ std::make_shared<const DL_node<T>>(std::in_place, std::move(value)), right });
+        result.right_size++;
+        return result;
+    }
+
+    // Method to remove the focus; the next element becomes the focus
+    ListCursor erase() const
+    {
+        checkFocus();
+        return dropFocus();
+    }
+
+    ListCursor replace(T value) const
+    {
+        checkFocus();
+        return dropFocus().insert(std::move(value));
+    }
+
+    std::vector<T> toVector() const
+    {
+        std::vector<T> result(left_size);
+        size_t i = left_size;
+        for (const Cell* cell = left.get(); cell; cell = cell->next.get())
+        {
+            result[--i] = cell->node->value;
+        }
+        for (const Cell* cell = right.get(); cell; cell = cell->next.get())
+        {
+            result.push_back(cell->node->value);
+        }
+        const DL_node<T>* node = tail.get();
+        for (size_t j = 0; j < tail_count; ++j)
+        {
+            result.push_back(node->value);
+            if (j + 1 < tail_count)
+            {
+                node = node->next.get(); // The next pointer of the last node is never read, push_back may change it
+            }
+        }
+        return result;
+    }
+
+private:
+    template <typename> friend class PersistentDoublyLinkedList;
+
+    struct Cell
+    {
+        std::shared_ptr<const DL_node<T>> node; // Node of the source version, or a new one for inserted values
+        mutable std::shared_ptr<const Cell> next; // Mutable only so that the destructor can unlink it
+
+        // Cells are released iteratively: releasing a long stack recursively would overflow the call stack
+        ~Cell()
+        {
+            std::shared_ptr<const Cell> rest = std::move(next);
+            while (rest && rest.use_count() == 1)
+            {
+                rest = std::move(rest->next);
+            }
+        }
+    };
+
+    std::shared_ptr<const Cell> left{}; // Elements before the focus, nearest first
+    std::shared_ptr<const Cell> right{}; // Focus and the edited elements after it
+    std::shared_ptr<DL_node<T>> tail{}; // Unvisited rest of the source version, after right
+    size_t left_size{};
+    size_t right_size{};
+    size_t tail_count{};
+    size_t source{}; // Version the cursor was created on
+
+    void checkFocus() const
+    {
+        if (atEnd())
+        {
+            throw std::out_of_range("No element at the cursor");
+        }
+    }
+
+    ListCursor dropFocus() const
+    {
+        ListCursor result = *this;
+        if (right)
+        {
+            result.right = right->next;
+            result.right_size--;
+        }
+        else
+        {
+            result.tail = --result.tail_count > 0 ? tail->next : nullptr;
+        }
+        return result;
+    }
 };
 
 template <typename T>
@@ -25,6 +201,116 @@ private:
 
     int current_version;
 
+    OperationJournal* journal{}; // Optional write-ahead journal, not owned
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    // Number of elements of every version. Versions share their tail node with the versions
+    // that push_back extended, so a version is its head and length, never "until nullptr".
+    std::vector<size_t> lengths{};
+
+    MemoryCounters memory{ sharedAllocationBytes<DL_node<T>>() };
+    VersionIndex version_index{}; // Creation time of every version and version tags
+
+    // Method to record the last stored version: its length, the memory counters and the version index
+    void countVersion(size_t new_nodes, size_t length)
+    {
+        lengths.push_back(length);
+        memory.addNodes(new_nodes);
+        version_index.stamp();
+        memory.pushVersion(length);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Time, VersionIndex::toNanoseconds(version_index.latest()));
+        }
+    }
+
+    // Method to add a version made of new nodes for the front values followed by the first
+    // tail_count nodes of tail. The tail nodes are shared, so only the new nodes are linked back.
+    void spliceVersion(std::vector<T> front, std::shared_ptr<DL_node<T>> tail, size_t tail_count)
+    {
+        std::shared_ptr<DL_node<T>> head = tail_count > 0 ? std::move(tail) : nullptr;
+        for (size_t i = front.size(); i-- > 0;)
+        {
+            auto node = std::make_shared<DL_node<T>>(std::move(front[i]));
+            node->next = head;
+            if (i + 1 < front.size())
+            {
+                head->prev = node;
+            }
+            head = node;
+        }
+
+        versions.push_back(head);
+        countVersion(front.size(), front.size() + tail_count);
+        current_version++;
+    }
+
+    // Method to call f(node) on the first count nodes from node. The next pointer of the
+    // last one is never read: push_back may be linking a new node after it.
+    template <typename Node, typename F>
+    static void forNodes(Node* node, size_t count, F f)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            f(node);
+            if (i + 1 < count)
+            {
+                node = node->next.get();
+            }
+        }
+    }
+
+    // First node of every parallel_grain-sized chunk of a version.
+    // A list cannot be split without walking it, so this one pass stays sequential.
+    std::vector<DL_node<T>*> chunkStarts(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        std::vector<DL_node<T>*> starts;
+        size_t position = 0;
+        forNodes(versions[idx].get(), lengths[idx], [&](DL_node<T>* node)
+        {
+            if (position++ % parallel_grain == 0)
+            {
+                starts.push_back(node);
+            }
+        });
+        return starts;
+    }
+
+    // Copy of the first length nodes from head, followed by tail
+    static std::shared_ptr<DL_node<T>> copyWithTail(const std::shared_ptr<DL_node<T>>& head, size_t length, std::shared_ptr<DL_node<T>> tail)
+    {
+        if constexpr (std::is_copy_constructible<T>::value)
+        {
+            auto new_head = std::make_shared<DL_node<T>>(head->value);
+            auto copy = new_head;
+            forNodes(head->next.get(), length - 1, [&](const DL_node<T>* node)
+            {
+                copy->next = std::make_shared<DL_node<T>>(node->value);
+                copy->next->prev = copy;
+                copy = copy->next;
+            });
+            copy->next = tail;
+            tail->prev = copy;
+            return new_head;
+        }
+        else
+        {
+            throw std::logic_error("Cannot copy a version of a list of move-only elements");
+        }
+    }
+
+    // Number of elements in a chunk returned by chunkStarts
+    size_t chunkLength(size_t idx, size_t chunk) const
+    {
+        return std::min(parallel_grain, lengths[idx] - chunk * parallel_grain);
+    }
+
 public:
     // Constructor that accepts an array and its size
     PersistentDoublyLinkedList(T* arr, int size)
@@ -34,14 +320,14 @@ public:
         }
 
         // Create the head of the list
-        auto head = std::make_shared<DL_node<T>>(arr[0]);
+        auto head = std::make_shared<DL_node<T>>(std::in_place, arr[0]);
         std::shared_ptr<DL_node<T>> current = head; // Store pointer to the current node
 
 
         // Iterate through the array and create the doubly linked list
         for (int i = 1; i < size; ++i)
         {
-            auto new_node = std::make_shared<DL_node<T>>(arr[i]);
+            auto new_node = std::make_shared<DL_node<T>>(std::in_place, arr[i]);
             current->next = new_node; // Attach the new node to the current
             new_node->prev = current;  // Set the previous node reference
             current = new_node; // Move to the new node
@@ -50,6 +336,7 @@ public:
 
         // Store the head of the list in the versions vector
         versions.push_back(head);
+        countVersion(size, size);
         current_version = 0;
     }
 
@@ -62,13 +349,41 @@ public:
         }
 
         // Create the head of the list
-        auto head = std::make_shared<DL_node<T>>(vec[0]);
+        auto head = std::make_shared<DL_node<T>>(std::in_place, vec[0]);
+        std::shared_ptr<DL_node<T>> current = head; // Store pointer to the current node
+
+        // Iterate through the vector and create the doubly linked list
+        for (int i = 1; i < size; ++i)
+        {
+            auto new_node = std::make_shared<DL_node<T>>(std::in_place, vec[i]);
+            current->next = new_node; // Attach the new node to the current
+            new_node->prev = current;  // Set the previous node reference
+            current = new_node; // Move to the new node
+        }
+
+        // Store the head of the list in the versions vector
+        versions.push_back(head);
+        countVersion(size, size);
+        current_version = 0;
+    }
+
+    // Constructor that moves the elements out of the vector
+    PersistentDoublyLinkedList(std::vector<T>&& vec, int vec_size)
+    {
+        int size = vec_size;
+        if (size <= 0)
+        {
+            return; // If the vector is empty, just return
+        }
+
+        // Create the head of the list
+        auto head = std::make_shared<DL_node<T>>(std::in_place, std::move(vec[0]));
         std::shared_ptr<DL_node<T>> current = head; // Store pointer to the current node
 
         // Iterate through the vector and create the doubly linked list
         for (int i = 1; i < size; ++i)
         {
-            auto new_node = std::make_shared<DL_node<T>>(vec[i]);
+            auto new_node = std::make_shared<DL_node<T>>(std::in_place, std::move(vec[i]));
             current->next = new_node; // Attach the new node to the current
             new_node->prev = current;  // Set the previous node reference
             current = new_node; // Move to the new node
@@ -76,13 +391,55 @@ public:
 
         // Store the head of the list in the versions vector
         versions.push_back(head);
+        countVersion(size, size);
+        current_version = 0;
+    }
+
+    // Constructor that builds the base version from an iterator range in one pass, without an intermediate vector
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentDoublyLinkedList(InputIt first, InputIt last)
+    {
+        if (first == last)
+        {
+            return; // If the range is empty, just return
+        }
+
+        // Create the head of the list
+        auto head = std::make_shared<DL_node<T>>(std::in_place, *first);
+        std::shared_ptr<DL_node<T>> current = head; // Store pointer to the current node
+        size_t size = 1;
+
+        for (++first; first != last; ++first, ++size)
+        {
+            auto new_node = std::make_shared<DL_node<T>>(std::in_place, *first);
+            current->next = new_node; // Attach the new node to the current
+            new_node->prev = current;  // Set the previous node reference
+            current = new_node; // Move to the new node
+        }
+
+        // Store the head of the list in the versions vector
+        versions.push_back(head);
+        countVersion(size, size);
         current_version = 0;
     }
 
     // Method to add a new node to the front of the list
     void push_front(T value)
     {
-        auto new_head = std::make_shared<DL_node<T>>(value);
+        emplace_front(std::move(value));
+    }
+
+    // Method to add a new node to the front of the list, constructing its value in place from args
+    template <typename... Args>
+    void emplace_front(Args&&... args)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Push);
+        auto new_head = std::make_shared<DL_node<T>>(std::in_place, std::forward<Args>(args)...);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::PushFront, new_head->value);
+        }
+
         new_head->next = versions.back(); // The new node points to the current head
 
         // Update the previous head's pointer if it exists
@@ -93,6 +450,7 @@ public:
 
         // Store the new version (head) of the list
         versions.push_back(new_head);
+        countVersion(1, lengths.back() + 1);
         current_version++;
     }
 
@@ -102,14 +460,12 @@ public:
         for (int i = 0; i < versions.size(); ++i)
         {
             std::cout << "Version " << i << ": {";
-            auto current = versions[i];
 
             // Traverse through all nodes of the current version and print their values
-            while (current)
+            forNodes(versions[i].get(), lengths[i], [](const DL_node<T>* current)
             {
                 std::cout << current->value << " (" << &(current->value) << ") ";
-                current = current->next;
-            }
+            });
             std::cout << "} " << std::endl; // Move to a new line after printing one version
         }
     }
@@ -117,75 +473,487 @@ public:
     // Method to make UNDO action
     void undo()
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
         if (current_version <= 0)
         {
             std::cout << "No actions to undo!" << std::endl;
             return;
         }
 
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Undo);
+        }
+
         current_version--;
         versions.push_back(versions[current_version]);
+        countVersion(0, lengths[current_version]);
     }
 
     // Method to make REDO action
     void redo()
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
         if (current_version >= versions.size() - 1)
         {
             std::cout << "No actions to redo!" << std::endl;
             return;
         }
 
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Redo);
+        }
+
         current_version++;  // Move to the next version
         versions.push_back(versions[current_version]);
+        countVersion(0, lengths[current_version]);
     }
 
     // Method to add a new node to the end of the list
     void push_back(T value)
     {
-        auto new_node = std::make_shared<DL_node<T>>(value);
+        emplace_back(std::move(value));
+    }
+
+    // Method to add a new node to the end of the list, constructing its value in place from args
+    template <typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Push);
+        auto new_node = std::make_shared<DL_node<T>>(std::in_place, std::forward<Args>(args)...);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::PushBack, new_node->value);
+        }
 
         // If this is the first version of the list, the new node will be the head
         if (versions.empty())
         {
             versions.push_back(new_node);
+            countVersion(1, 1);
             current_version = 0;
             return;
         }
 
+        size_t length = lengths.back();
+        if (length == 0)
+        {
+            versions.push_back(new_node);
+            countVersion(1, 1);
+            current_version++;
+            return;
+        }
+
         auto last = versions.back(); // Get the current version (head)
 
         // Find the last node (tail) in the current version
-        while (last->next)
+        for (size_t i = 1; i < length; ++i)
         {
             last = last->next;
         }
 
+        if (last->next)
+        {
+            // The tail already continues in a longer version (e.g. after an undo): copy this version
+            versions.push_back(copyWithTail(versions.back(), length, std::move(new_node)));
+            countVersion(length + 1, length + 1);
+            current_version++;
+            return;
+        }
+
         last->next = new_node; // Attach the new node to the tail
         new_node->prev = last; // Set the previous node reference
 
         // Store the new version (head) of the list
         versions.push_back(versions.back());
+        countVersion(1, length + 1);
         current_version++;
     }
 
     std::vector<T> getVersion(size_t idx) const
     {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
         if (idx < versions.size())
         {
             std::vector<T> result;
-            auto current = versions[idx];
+            result.reserve(lengths[idx]);
 
             // Traverse through all nodes of the current version and add their values to the vector
-            while (current)
+            forNodes(versions[idx].get(), lengths[idx], [&](const DL_node<T>* current)
             {
                 result.push_back(current->value);
-                current = current->next;
-            }
+            });
             return result; // Return the vector of values
         }
         throw std::out_of_range("Invalid version index");
     }
+
+    // Parallel reduction of a version with an associative combine function
+    template <typename Combine>
+    T parallel_reduce(WorkStealingPool& pool, size_t idx, T identity, Combine combine) const
+    {
+        std::vector<DL_node<T>*> starts = chunkStarts(idx);
+        std::vector<ChunkResult<T>> partial(starts.size(), ChunkResult<T>{ identity });
+        pool.parallelFor(starts.size(), 1, [&](size_t first, size_t last)
+        {
+            for (size_t chunk = first; chunk < last; ++chunk)
+            {
+                T result = identity;
+                forNodes(starts[chunk], chunkLength(idx, chunk), [&](const DL_node<T>* current)
+                {
+                    result = combine(result, current->value);
+                });
+                partial[chunk].value = result;
+            }
+        });
+
+        T result = identity;
+        for (const auto& chunk : partial)
+        {
+            result = combine(result, chunk.value);
+        }
+        return result;
+    }
+
+    // Method to call f on every element of a version in parallel
+    template <typename F>
+    void parallel_for_each(WorkStealingPool& pool, size_t idx, F f) const
+    {
+        std::vector<DL_node<T>*> starts = chunkStarts(idx);
+        pool.parallelFor(starts.size(), 1, [&](size_t first, size_t last)
+        {
+            for (size_t chunk = first; chunk < last; ++chunk)
+            {
+                forNodes(starts[chunk], chunkLength(idx, chunk), [&](const DL_node<T>* current)
+                {
+                    f(current->value);
+                });
+            }
+        });
+    }
+
+    // Method to add a new version where every element is f(old element).
+    // Every chunk is transformed and linked in parallel, then the chunks are joined.
+    template <typename F>
+    void parallel_transform(WorkStealingPool& pool, size_t idx, F f)
+    {
+        if (journal)
+        {
+            throw std::logic_error("parallel_transform cannot be journaled");
+        }
+
+        std::vector<DL_node<T>*> starts = chunkStarts(idx);
+        std::vector<std::shared_ptr<DL_node<T>>> heads(starts.size());
+        std::vector<std::shared_ptr<DL_node<T>>> tails(starts.size());
+        pool.parallelFor(starts.size(), 1, [&](size_t first, size_t last)
+        {
+            for (size_t chunk = first; chunk < last; ++chunk)
+            {
+                forNodes(starts[chunk], chunkLength(idx, chunk), [&](const DL_node<T>* current)
+                {
+                    auto new_node = std::make_shared<DL_node<T>>(f(current->value));
+                    if (tails[chunk])
+                    {
+                        tails[chunk]->next = new_node;
+                        new_node->prev = tails[chunk];
+                    }
+                    else
+                    {
+                        heads[chunk] = new_node;
+                    }
+                    tails[chunk] = new_node;
+                });
+            }
+        });
+
+        for (size_t chunk = 1; chunk < heads.size(); ++chunk)
+        {
+            tails[chunk - 1]->next = heads[chunk];
+            heads[chunk]->prev = tails[chunk - 1];
+        }
+
+        // Store the new version (head) of the list
+        versions.push_back(heads.empty() ? nullptr : heads[0]);
+        countVersion(lengths[idx], lengths[idx]);
+        current_version++;
+    }
+
+    // Cursor at the given position of a version; position may be the length of the version.
+    // O(position): the nodes before the position are walked, but their values are not copied.
+    ListCursor<T> cursor(size_t idx, size_t position) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        size_t length = lengths[idx];
+        if (position > length)
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+
+        using Cell = typename ListCursor<T>::Cell;
+        ListCursor<T> result;
+        std::shared_ptr<DL_node<T>> current = versions[idx];
+        for (size_t i = 0; i < position; ++i)
+        {
+            result.left = std::make_shared<const Cell>(Cell{ current, result.left });
+            if (i + 1 < length)
+            {
+                current = current->next; // The next pointer of the last node is never read
+            }
+        }
+        result.left_size = position;
+        result.tail_count = length - position;
+        result.tail = result.tail_count > 0 ? current : nullptr;
+        result.source = idx;
+        return result;
+    }
+
+    // Method to store the contents of a cursor as a new version, O(position + edits).
+    // Only the elements the cursor moved over or inserted get new nodes; the unvisited tail
+    // is shared with the version the cursor was created on.
+    void commit(const ListCursor<T>& cursor)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        if (cursor.source >= versions.size() || cursor.tail_count > lengths[cursor.source])
+        {
+            throw std::invalid_argument("Cursor does not belong to this list");
+        }
+
+        std::vector<T> front(cursor.left_size);
+        size_t i = cursor.left_size;
+        for (auto cell = cursor.left.get(); cell; cell = cell->next.get())
+        {
+            front[--i] = cell->node->value;
+        }
+        for (auto cell = cursor.right.get(); cell; cell = cell->next.get())
+        {
+            front.push_back(cell->node->value);
+        }
+
+        if (journal)
+        {
+            std::uint64_t tail_start = lengths[cursor.source] - cursor.tail_count;
+            journal->append(OperationJournal::Op::Splice, static_cast<int>(cursor.source), tail_start, front);
+        }
+        spliceVersion(std::move(front), cursor.tail, cursor.tail_count);
+    }
+
+    // Memory and sharing statistics, O(1); the version part describes what idx allocated itself
+    MemoryStats memoryStats(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return memory.stats(idx);
+    }
+
+    // Read-only view of one version, safe to read on another thread while the list grows.
+    // It shares the nodes of the version and visits exactly the version's length: push_back
+    // links new nodes after the shared tail, so the tail's next pointer is never read.
+    class Snapshot
+    {
+    public:
+        size_t size() const
+        {
+            return length;
+        }
+
+        template <typename F>
+        void forEach(F f) const
+        {
+            const DL_node<T>* current = head.get();
+            for (size_t i = 0; i < length; ++i)
+            {
+                f(current->value);
+                if (i + 1 < length)
+                {
+                    current = current->next.get();
+                }
+            }
+        }
+
+    private:
+        friend class PersistentDoublyLinkedList;
+
+        std::shared_ptr<DL_node<T>> head{};
+        size_t length{};
+    };
+
+    // Snapshot of a version, O(1)
+    Snapshot snapshot(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        Snapshot result;
+        result.head = versions[idx];
+        result.length = lengths[idx];
+        return result;
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Method to name a version; every tag names exactly one version
+    void tagVersion(const std::string& tag, int idx)
+    {
+        if (idx < 0 || static_cast<size_t>(idx) >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        version_index.tag(tag, idx);
+        if (journal)
+        {
+            journal->append(OperationJournal::Op::Tag, tag, idx);
+        }
+    }
+
+    // Version with the given tag, O(1)
+    size_t versionByTag(const std::string& tag) const
+    {
+        return version_index.byTag(tag);
+    }
+
+    // Version that was the latest one at the given time, O(log V)
+    size_t versionAsOf(VersionIndex::Clock::time_point time) const
+    {
+        return version_index.asOf(time);
+    }
+
+    // Time a version was created
+    VersionIndex::Clock::time_point versionTime(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return version_index.time(idx);
+    }
+
+    // Tags naming a version in lexicographic order
+    std::vector<std::string> versionTags(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return version_index.tagsOf(idx);
+    }
+
+    // Method to start journaling; writes the base version as the checkpoint record.
+    // Must be called before any edits so that replay reproduces the same version numbers.
+    void attachJournal(OperationJournal& new_journal)
+    {
+        if (versions.size() > 1)
+        {
+            throw std::logic_error("Journal must be attached before the first edit");
+        }
+
+        new_journal.append(OperationJournal::Op::Checkpoint, versions.empty() ? std::vector<T>() : getVersion(0));
+        if (!versions.empty())
+        {
+            new_journal.append(OperationJournal::Op::Time, VersionIndex::toNanoseconds(version_index.time(0)));
+        }
+        journal = &new_journal;
+    }
+
+    // Method to continue journaling to a journal opened in Append mode, without a new checkpoint.
+    // The container must be the result of replayJournal on the same file, so that version numbers match.
+    void resumeJournal(OperationJournal& new_journal)
+    {
+        if (new_journal.recordCount() == 0)
+        {
+            throw std::logic_error("Journal has no checkpoint to resume from");
+        }
+        journal = &new_journal;
+    }
+
+    void detachJournal()
+    {
+        journal = nullptr;
+    }
+
+    // Rebuild a list from a journal: the checkpoint becomes version 0, then all logged operations are re-applied
+    static PersistentDoublyLinkedList<T> replayJournal(const std::string& path)
+    {
+        OperationJournal::Reader reader(path);
+        OperationJournal::Op op;
+        const char* payload;
+        const char* end;
+
+        if (!reader.next(op, payload, end) || op != OperationJournal::Op::Checkpoint)
+        {
+            throw std::runtime_error("Journal does not start with a checkpoint");
+        }
+        std::vector<T> base = JournalCodec<std::vector<T>>::read(payload, end);
+        PersistentDoublyLinkedList<T> result(base, base.size());
+
+        while (reader.next(op, payload, end))
+        {
+            switch (op)
+            {
+            case OperationJournal::Op::PushFront:
+                result.push_front(JournalCodec<T>::read(payload, end));
+                break;
+            case OperationJournal::Op::PushBack:
+                result.push_back(JournalCodec<T>::read(payload, end));
+                break;
+            case OperationJournal::Op::Tag:
+            {
+                std::string tag = JournalCodec<std::string>::read(payload, end);
+                result.tagVersion(tag, JournalCodec<int>::read(payload, end));
+                break;
+            }
+            case OperationJournal::Op::Time:
+                result.version_index.restamp(VersionIndex::fromNanoseconds(JournalCodec<std::int64_t>::read(payload, end)));
+                break;
+            case OperationJournal::Op::Splice:
+            {
+                size_t source = JournalCodec<int>::read(payload, end);
+                std::uint64_t tail_start = JournalCodec<std::uint64_t>::read(payload, end);
+                std::vector<T> front = JournalCodec<std::vector<T>>::read(payload, end);
+                if (source >= result.versions.size() || tail_start > result.lengths[source])
+                {
+                    throw std::runtime_error("Journal splices an invalid version");
+                }
+
+                size_t tail_count = result.lengths[source] - tail_start;
+                std::shared_ptr<DL_node<T>> tail = tail_count > 0 ? result.versions[source] : nullptr;
+                for (std::uint64_t i = 0; tail && i < tail_start; ++i)
+                {
+                    tail = tail->next;
+                }
+                result.spliceVersion(std::move(front), std::move(tail), tail_count);
+                break;
+            }
+            case OperationJournal::Op::Undo:
+                result.undo();
+                break;
+            case OperationJournal::Op::Redo:
+                result.redo();
+                break;
+            default:
+                throw std::runtime_error("Unexpected journal record for PersistentDoublyLinkedList");
+            }
+        }
+        return result;
+    }
 };
 
-#endif // PERSISTENT_DOUBLY_LINKED_LIST_H
\ No newline at end of file
+#endif // PERSISTENT_DOUBLY_LINKED_LIST_H
\ No newline at end of file
@@ -0,0 +1,261 @@
+#ifndef PERSISTENT_EXPORT_H
+#define PERSISTENT_EXPORT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "persistent_journal.h"
+#include "persistent_version_index.h"
+
+// Containers with a VersionIndex export the creation time and the tags of every version
+template <typename Container, typename = void>
+struct ExportsVersionIndex : std::false_type
+{
+};
+
+template <typename Container>
+struct ExportsVersionIndex<Container, std::void_t<decltype(std::declval<const Container&>().versionTags(0))>> : std::true_type
+{
+};
+
+// Background export of container versions.
+// Versions are immutable, so the calling thread only takes an O(1) snapshot of every
+// requested version (see the Snapshot class of each container); encoding and writing
+// happen on the exporter thread while the caller keeps adding versions.
+// Writers never wait for an export: the only lock guards the job queue, and it is
+// taken by export calls and the exporter thread, never by container operations.
+// Stream layout: magic, then per version [version:u32][time:i64][tags:vector<string>][element count:u64][elements],
+// elements encoded with JournalCodec; associative containers write the key, then the value.
+// The time is in nanoseconds since the epoch (0 and no tags for containers without a VersionIndex).
+// At most chunk_bytes (plus one element) of encoded data are buffered before they go to the sink.
+class SnapshotExporter
+{
+public:
+    // Receives consecutive pieces of the stream; a final call with size 0 marks its end
+    using Sink = std::function<void(const char* data, size_t size)>;
+
+    explicit SnapshotExporter(size_t chunk_bytes = 65536)
+        : chunk_bytes(chunk_bytes == 0 ? 1 : chunk_bytes)
+    {
+        worker = std::thread([this] { workerLoop(); });
+    }
+
+    SnapshotExporter(const SnapshotExporter&) = delete;
+    SnapshotExporter& operator=(const SnapshotExporter&) = delete;
+
+    // Finishes all queued exports
+    ~SnapshotExporter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        worker.join();
+    }
+
+    // Method to export versions of a container to a sink; the future holds the number of bytes written.
+    // Invalid version indices throw here; errors of the sink are reported through the future.
+    // The container must outlive the export.
+    template <typename Container>
+    std::future<size_t> exportVersions(const Container& container, const std::vector<size_t>& indices, Sink sink)
+    {
+        using Snapshot = typename Container::Snapshot;
+        std::vector<Entry<Snapshot>> snapshots;
+        snapshots.reserve(indices.size());
+        for (size_t idx : indices)
+        {
+            Entry<Snapshot> entry{ idx, container.snapshot(idx) };
+            if constexpr (ExportsVersionIndex<Container>::value)
+            {
+                entry.time = VersionIndex::toNanoseconds(container.versionTime(idx));
+                entry.tags = container.versionTags(idx);
+            }
+            snapshots.push_back(std::move(entry));
+        }
+
+        auto task = std::make_shared<std::packaged_task<size_t()>>(
+            [this, snapshots = std::move(snapshots), sink = std::move(sink)]() { return encode(snapshots, sink); });
+        std::future<size_t> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back([task] { (*task)(); });
+        }
+        wakeup.notify_one();
+        return result;
+    }
+
+    // Method to export versions of a container to a file; the file is opened (and truncated) right away
+    template <typename Container>
+    std::future<size_t> exportToFile(const Container& container, const std::vector<size_t>& indices, const std::string& path)
+    {
+        std::shared_ptr<std::FILE> file(std::fopen(path.c_str(), "wb"), [](std::FILE* f) { if (f) std::fclose(f); });
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open snapshot file: " + path);
+        }
+
+        return exportVersions(container, indices, [file](const char* data, size_t size)
+        {
+            if ((size > 0 && std::fwrite(data, 1, size, file.get()) != size) || (size == 0 && std::fflush(file.get()) != 0))
+            {
+                throw std::runtime_error("Failed to write snapshot");
+            }
+        });
+    }
+
+    // Sequential reader over an exported stream.
+    // The whole file is loaded with one read, elements are decoded in place.
+    class Reader
+    {
+    public:
+        Reader(const std::string& path)
+        {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in)
+            {
+                throw std::runtime_error("Cannot open snapshot file: " + path);
+            }
+            data.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(data.data(), data.size());
+
+            if (data.size() < sizeof(magic) || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+            {
+                throw std::runtime_error("Not a snapshot file: " + path);
+            }
+            position = data.data() + sizeof(magic);
+        }
+
+        // Method to move to the next version; its elements are then read with read<T>()
+        bool next(size_t& version, size_t& count)
+        {
+            if (position == data.data() + data.size())
+            {
+                return false;
+            }
+            version = JournalCodec<std::uint32_t>::read(position, data.data() + data.size());
+            version_time = VersionIndex::fromNanoseconds(JournalCodec<std::int64_t>::read(position, data.data() + data.size()));
+            version_tags = JournalCodec<std::vector<std::string>>::read(position, data.data() + data.size());
+            count = static_cast<size_t>(JournalCodec<std::uint64_t>::read(position, data.data() + data.size()));
+            return true;
+        }
+
+        // Creation time of the current version
+        VersionIndex::Clock::time_point time() const
+        {
+            return version_time;
+        }
+
+        // Tags of the current version
+        const std::vector<std::string>& tags() const
+        {
+            return version_tags;
+        }
+
+        template <typename T>
+        T read()
+        {
+            return JournalCodec<T>::read(position, data.data() + data.size());
+        }
+
+    private:
+        std::vector<char> data;
+        const char* position{};
+        VersionIndex::Clock::time_point version_time{};
+        std::vector<std::string> version_tags{};
+    };
+
+private:
+    static constexpr char magic[8] = { 'P', 'S', 'N', 'P', '0', '0', '0', '2' };
+
+    template <typename Snapshot>
+    struct Entry
+    {
+        size_t version;
+        Snapshot snapshot;
+        std::int64_t time{};
+        std::vector<std::string> tags{};
+    };
+
+    size_t chunk_bytes;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<std::function<void()>> jobs;
+    bool stopping{};
+
+    template <typename Snapshot>
+    size_t encode(const std::vector<Entry<Snapshot>>& snapshots, const Sink& sink) const
+    {
+        std::vector<char> buffer;
+        buffer.reserve(chunk_bytes + 64);
+        buffer.insert(buffer.end(), magic, magic + sizeof(magic));
+        size_t written = 0;
+        auto flush = [&]()
+        {
+            sink(buffer.data(), buffer.size());
+            written += buffer.size();
+            buffer.clear();
+        };
+
+        for (const auto& entry : snapshots)
+        {
+            JournalCodec<std::uint32_t>::write(buffer, static_cast<std::uint32_t>(entry.version));
+            JournalCodec<std::int64_t>::write(buffer, entry.time);
+            JournalCodec<std::vector<std::string>>::write(buffer, entry.tags);
+            JournalCodec<std::uint64_t>::write(buffer, static_cast<std::uint64_t>(entry.snapshot.size()));
+            entry.snapshot.forEach([&](const auto&... fields)
+            {
+                int expand[] = { 0, (JournalCodec<typename std::decay<decltype(fields)>::type>::write(buffer, fields), 0)... };
+                (void)expand;
+                if (buffer.size() >= chunk_bytes)
+                {
+                    flush();
+                }
+            });
+        }
+        if (!buffer.empty())
+        {
+            flush();
+        }
+        sink(nullptr, 0);
+        return written;
+    }
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                {
+                    return; // Stopping and drained
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job(); // Exceptions are stored in the future by packaged_task
+        }
+    }
+};
+
+#endif // PERSISTENT_EXPORT_H
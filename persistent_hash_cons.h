@@ -0,0 +1,96 @@
+#ifndef PERSISTENT_HASH_CONS_H
+#define PERSISTENT_HASH_CONS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+
+// Mix a value into a running hash
+inline size_t hashCombine(size_t seed, size_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// Interned nodes for hash-consing, keyed by a content hash.
+// Nodes are interned bottom-up, so two nodes are equal exactly when their own fields are equal
+// and their children are the same pointers: comparing a node never walks its subtrees.
+// The table holds weak references and does not keep nodes alive; expired entries are dropped
+// while looking up and whenever the table has doubled since the last sweep.
+// A weak reference keeps the control block of its node alive, so interned nodes should be
+// allocated with a separate control block (shared_ptr<Node>(new Node)) rather than make_shared,
+// which would keep the whole node allocation until the entry is dropped.
+template <typename Node>
+class HashConsTable
+{
+public:
+    // Interned node with the given hash for which equal(node) holds, nullptr if there is none
+    template <typename Equal>
+    std::shared_ptr<Node> find(size_t hash, Equal equal)
+    {
+        auto range = nodes.equal_range(hash);
+        for (auto it = range.first; it != range.second;)
+        {
+            std::shared_ptr<Node> node = it->second.lock();
+            if (!node)
+            {
+                it = nodes.erase(it);
+                continue;
+            }
+            if (equal(*node))
+            {
+                hit_count++;
+                return node;
+            }
+            ++it;
+        }
+        return nullptr;
+    }
+
+    // Method to intern a node that find did not return
+    void insert(size_t hash, const std::shared_ptr<Node>& node)
+    {
+        nodes.emplace(hash, node);
+        if (nodes.size() >= sweep_at)
+        {
+            sweep();
+        }
+    }
+
+    // Number of interned entries, including expired ones not swept yet
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    // Number of nodes that were reused instead of allocated
+    std::uint64_t hits() const
+    {
+        return hit_count;
+    }
+
+    // Bytes of the table: one allocation per entry (next pointer, hash and weak reference) and the bucket array
+    size_t bytes() const
+    {
+        return nodes.size() * (sizeof(void*) + sizeof(typename Map::value_type)) + nodes.bucket_count() * sizeof(void*);
+    }
+
+private:
+    using Map = std::unordered_multimap<size_t, std::weak_ptr<Node>>;
+
+    Map nodes{};
+    size_t sweep_at = 1024;
+    std::uint64_t hit_count{};
+
+    void sweep()
+    {
+        for (auto it = nodes.begin(); it != nodes.end();)
+        {
+            it = it->second.expired() ? nodes.erase(it) : std::next(it);
+        }
+        sweep_at = std::max<size_t>(1024, nodes.size() * 2);
+    }
+};
+
+#endif // PERSISTENT_HASH_CONS_H
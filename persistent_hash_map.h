@@ -0,0 +1,474 @@
+#ifndef PERSISTENT_HASH_MAP_H
+#define PERSISTENT_HASH_MAP_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_latency.h"
+#include "persistent_stats.h"
+#include "persistent_storage.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Number of set bits, used to turn a bitmap position into a compact array index
+inline int hamt_popcount(std::uint32_t bits)
+{
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt(bits));
+#else
+    return __builtin_popcount(bits);
+#endif
+}
+
+template <typename KeyType, typename ValueType>
+struct HAMT_entry
+{
+    KeyType key;
+    ValueType value;
+    size_t hash;
+};
+
+// Node of a hash array mapped trie.
+// Every level consumes 5 bits of the hash; datamap marks slots holding an entry,
+// nodemap marks slots holding a subtrie. Both arrays are compact (no empty slots),
+// the position of a slot is the popcount of the lower bits of its map.
+// When all hash bits are consumed, the node is a collision node with a plain list of entries.
+template <typename KeyType, typename ValueType>
+struct HAMT_node
+{
+    std::uint32_t datamap{};
+    std::uint32_t nodemap{};
+    bool collision{};
+    size_t node_count{ 1 }; // Nodes in the subtrie, this one included
+    std::vector<HAMT_entry<KeyType, ValueType>> entries{};
+    std::vector<std::shared_ptr<const HAMT_node<KeyType, ValueType>>> children{};
+};
+
+template <typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>>
+class PersistentHashMap
+{
+private:
+    using Node = HAMT_node<KeyType, ValueType>;
+    using NodePtr = std::shared_ptr<const Node>;
+    using Entry = HAMT_entry<KeyType, ValueType>;
+
+    static const int bits_per_level = 5;
+    static const int hash_bits = static_cast<int>(sizeof(size_t) * 8);
+
+    std::vector<NodePtr> versions{}; // Root of every version
+    std::vector<size_t> sizes{}; // Number of keys in every version
+
+    int current_version{};
+    Hash hasher{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    MemoryCounters memory{ sharedAllocationBytes<Node>() }; // Entry and child arrays are counted separately
+
+    // Method to record the last stored version in the memory counters.
+    // Nodes of older versions are referenced from those versions as well,
+    // so the nodes with a single owner are the ones allocated for this version.
+    void countVersion()
+    {
+        const NodePtr& root = versions.back();
+        if (root.use_count() == 1)
+        {
+            countNodes(*root);
+        }
+        memory.pushVersion(root->node_count);
+    }
+
+    void countNodes(const Node& node)
+    {
+        size_t arrays = (node.entries.empty() ? 0 : 1) + (node.children.empty() ? 0 : 1);
+        memory.addNodes(1);
+        memory.addAllocations(arrays, node.entries.capacity() * sizeof(Entry) + node.children.capacity() * sizeof(NodePtr));
+        for (const auto& child : node.children)
+        {
+            if (child.use_count() == 1)
+            {
+                countNodes(*child);
+            }
+        }
+    }
+
+    static std::uint32_t slotBit(size_t hash, int shift)
+    {
+        return std::uint32_t(1) << ((hash >> shift) & 31);
+    }
+
+    static int slotIndex(std::uint32_t map, std::uint32_t bit)
+    {
+        return hamt_popcount(map & (bit - 1));
+    }
+
+    // Build the smallest subtrie holding two entries with different keys
+    static NodePtr mergeEntries(Entry first, Entry second, int shift)
+    {
+        auto node = std::make_shared<Node>();
+        if (shift >= hash_bits)
+        {
+            node->collision = true;
+            node->entries.push_back(std::move(first));
+            node->entries.push_back(std::move(second));
+            return node;
+        }
+
+        std::uint32_t first_bit = slotBit(first.hash, shift);
+        std::uint32_t second_bit = slotBit(second.hash, shift);
+        if (first_bit == second_bit)
+        {
+            node->nodemap = first_bit;
+            node->children.push_back(mergeEntries(std::move(first), std::move(second), shift + bits_per_level));
+            node->node_count += node->children.back()->node_count;
+        }
+        else
+        {
+            node->datamap = first_bit | second_bit;
+            if (first_bit < second_bit)
+            {
+                node->entries.push_back(std::move(first));
+                node->entries.push_back(std::move(second));
+            }
+            else
+            {
+                node->entries.push_back(std::move(second));
+                node->entries.push_back(std::move(first));
+            }
+        }
+        return node;
+    }
+
+    // Path-copying insert; only the nodes on the path to the key are copied.
+    // Sets added to true when the key was not present in the source version.
+    static NodePtr insert(const NodePtr& node, Entry entry, int shift, bool& added)
+    {
+        auto copy = std::make_shared<Node>(*node);
+
+        if (copy->collision)
+        {
+            for (auto& existing : copy->entries)
+            {
+                if (existing.key == entry.key)
+                {
+                    existing.value = std::move(entry.value);
+                    return copy;
+                }
+            }
+            copy->entries.push_back(std::move(entry));
+            added = true;
+            return copy;
+        }
+
+        std::uint32_t bit = slotBit(entry.hash, shift);
+        if (copy->datamap & bit)
+        {
+            int index = slotIndex(copy->datamap, bit);
+            if (copy->entries[index].key == entry.key)
+            {
+                copy->entries[index].value = std::move(entry.value); // Update value when the key matches
+                return copy;
+            }
+
+            // Two different keys share the slot: push both one level down
+            Entry existing = copy->entries[index];
+            copy->entries.erase(copy->entries.begin() + index);
+            copy->datamap &= ~bit;
+            copy->nodemap |= bit;
+            NodePtr merged = mergeEntries(std::move(existing), std::move(entry), shift + bits_per_level);
+            copy->node_count += merged->node_count;
+            copy->children.insert(copy->children.begin() + slotIndex(copy->nodemap, bit), std::move(merged));
+            added = true;
+        }
+        else if (copy->nodemap & bit)
+        {
+            int index = slotIndex(copy->nodemap, bit);
+            NodePtr child = insert(copy->children[index], std::move(entry), shift + bits_per_level, added);
+            copy->node_count = copy->node_count + child->node_count - copy->children[index]->node_count;
+            copy->children[index] = std::move(child);
+        }
+        else
+        {
+            copy->datamap |= bit;
+            copy->entries.insert(copy->entries.begin() + slotIndex(copy->datamap, bit), std::move(entry));
+            added = true;
+        }
+        return copy;
+    }
+
+    const Entry* findEntry(const NodePtr& root, const KeyType& key) const
+    {
+        size_t hash = hasher(key);
+        const Node* node = root.get();
+        int shift = 0;
+
+        while (node)
+        {
+            if (node->collision)
+            {
+                for (const auto& entry : node->entries)
+                {
+                    if (entry.key == key)
+                    {
+                        return &entry;
+                    }
+                }
+                return nullptr;
+            }
+
+            std::uint32_t bit = slotBit(hash, shift);
+            if (node->datamap & bit)
+            {
+                const Entry& entry = node->entries[slotIndex(node->datamap, bit)];
+                return entry.key == key ? &entry : nullptr;
+            }
+            if (!(node->nodemap & bit))
+            {
+                return nullptr;
+            }
+            node = node->children[slotIndex(node->nodemap, bit)].get();
+            shift += bits_per_level;
+        }
+        return nullptr;
+    }
+
+    // Recursive function to visit all entries of a trie, pre-order: the entries stored in a node
+    // come before the entries of its children, so the order is not sorted by hash
+    template <typename Visitor>
+    static void forEachEntry(const Node* node, Visitor& visit)
+    {
+        if (!node)
+        {
+            return;
+        }
+        for (const auto& entry : node->entries)
+        {
+            visit(entry);
+        }
+        for (const auto& child : node->children)
+        {
+            forEachEntry(child.get(), visit);
+        }
+    }
+
+    void build(const std::vector<KeyType>& keys, const ValueType* values)
+    {
+        NodePtr root = std::make_shared<Node>();
+        size_t size = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            bool added = false;
+            root = insert(root, Entry{ keys[i], values[i], hasher(keys[i]) }, 0, added);
+            size += added ? 1 : 0;
+        }
+        storeBase(std::move(root), size);
+    }
+
+    void storeBase(NodePtr root, size_t size)
+    {
+        versions.push_back(std::move(root));
+        sizes.push_back(size);
+        current_version = 0;
+        countVersion();
+    }
+
+public:
+    PersistentHashMap(const std::vector<KeyType>& keys, ValueType* values_array, size_t values_array_size)
+    {
+        if (keys.size() != values_array_size || keys.empty())
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+        build(keys, values_array);
+    }
+
+    PersistentHashMap(const std::vector<KeyType>& keys, const std::vector<ValueType>& values, size_t values_array_size)
+    {
+        if (keys.size() != values_array_size || values.size() != values_array_size || keys.empty())
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+        build(keys, values.data());
+    }
+
+    // Constructor from an iterator range of key/value pairs (anything with first and second),
+    // read in one pass without intermediate key and value vectors; the last duplicate wins
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentHashMap(InputIt first, InputIt last)
+    {
+        if (first == last)
+        {
+            throw std::invalid_argument("Keys and values must have the same non-zero length.");
+        }
+
+        NodePtr root = std::make_shared<Node>();
+        size_t size = 0;
+        for (; first != last; ++first)
+        {
+            bool added = false;
+            root = insert(root, Entry{ first->first, first->second, hasher(first->first) }, 0, added);
+            size += added ? 1 : 0;
+        }
+        storeBase(std::move(root), size);
+    }
+
+    // Function to add a new version with a value change
+    void addVersion(int root_position, KeyType change_key, ValueType new_value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        bool added = false;
+        size_t hash = hasher(change_key);
+        versions.push_back(insert(versions[root_position], Entry{ std::move(change_key), std::move(new_value), hash }, 0, added));
+        sizes.push_back(sizes[root_position] + (added ? 1 : 0));
+        current_version++;
+        countVersion();
+    }
+
+    // Method to make UNDO action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+        countVersion();
+    }
+
+    // Method to make REDO action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;  // Move to the next version
+        versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+        countVersion();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Memory and sharing statistics, O(1); the version part describes what idx allocated itself
+    MemoryStats memoryStats(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return memory.stats(idx);
+    }
+
+    // Function to find the value of a key in the given version
+    ValueType find(size_t idx, const KeyType& key) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        const Entry* entry = findEntry(versions[idx], key);
+        if (!entry)
+        {
+            throw std::runtime_error("Key not found");
+        }
+        return entry->value;
+    }
+
+    bool contains(size_t idx, const KeyType& key) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return findEntry(versions[idx], key) != nullptr;
+    }
+
+    size_t size(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return sizes[idx];
+    }
+
+    // Function to print all versions
+    void printAllVersions()
+    {
+        for (size_t i = 0; i < versions.size(); ++i)
+        {
+            std::cout << "Version [" << i << "]\t";
+            std::cout << "{";
+            size_t printed = 0;
+            auto print_entry = [&](const Entry& entry)
+            {
+                std::cout << "'" << entry.key << "': " << entry.value;
+                if (++printed < sizes[i])
+                {
+                    std::cout << ", ";
+                }
+            };
+            forEachEntry(versions[i].get(), print_entry);
+            std::cout << "}" << std::endl;
+        }
+    }
+
+    // Values of a version in trie order (see forEachEntry); keys are returned by getKeys in the same order
+    std::vector<ValueType> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        if (idx < versions.size())
+        {
+            std::vector<ValueType> result;
+            result.reserve(sizes[idx]);
+            auto collect = [&](const Entry& entry) { result.push_back(entry.value); };
+            forEachEntry(versions[idx].get(), collect);
+            return result; // Return the vector of values
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+
+    std::vector<KeyType> getKeys(size_t idx) const
+    {
+        if (idx < versions.size())
+        {
+            std::vector<KeyType> result;
+            result.reserve(sizes[idx]);
+            auto collect = [&](const Entry& entry) { result.push_back(entry.key); };
+            forEachEntry(versions[idx].get(), collect);
+            return result;
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+};
+
+#endif // PERSISTENT_HASH_MAP_H
@@ -0,0 +1,336 @@
+#ifndef PERSISTENT_JOURNAL_H
+#define PERSISTENT_JOURNAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Binary encoding of journal fields.
+// Trivially copyable types are stored as raw bytes, strings and vectors are length-prefixed.
+// Specialize JournalCodec for other value types that should be journaled;
+// containers of any other type still compile, but attaching a journal to them throws.
+template <typename T, typename Enable = void>
+struct JournalCodec
+{
+    static void write(std::vector<char>&, const T&)
+    {
+        throw std::logic_error("No JournalCodec for this type");
+    }
+
+    static T read(const char*&, const char*)
+    {
+        throw std::logic_error("No JournalCodec for this type");
+    }
+};
+
+template <typename T>
+struct JournalCodec<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type>
+{
+    static void write(std::vector<char>& out, const T& value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    static T read(const char*& in, const char* end)
+    {
+        if (end - in < static_cast<std::ptrdiff_t>(sizeof(T)))
+        {
+            throw std::runtime_error("Journal record is truncated");
+        }
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+template <>
+struct JournalCodec<std::string>
+{
+    static void write(std::vector<char>& out, const std::string& value)
+    {
+        JournalCodec<std::uint32_t>::write(out, static_cast<std::uint32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    static std::string read(const char*& in, const char* end)
+    {
+        std::uint32_t size = JournalCodec<std::uint32_t>::read(in, end);
+        if (static_cast<std::uint32_t>(end - in) < size)
+        {
+            throw std::runtime_error("Journal record is truncated");
+        }
+        std::string value(in, size);
+        in += size;
+        return value;
+    }
+};
+
+template <typename T>
+struct JournalCodec<std::vector<T>>
+{
+    static void write(std::vector<char>& out, const std::vector<T>& values)
+    {
+        JournalCodec<std::uint32_t>::write(out, static_cast<std::uint32_t>(values.size()));
+        for (const auto& value : values)
+        {
+            JournalCodec<T>::write(out, value);
+        }
+    }
+
+    static std::vector<T> read(const char*& in, const char* end)
+    {
+        std::uint32_t size = JournalCodec<std::uint32_t>::read(in, end);
+        std::vector<T> values;
+        values.reserve(size);
+        for (std::uint32_t i = 0; i < size; ++i)
+        {
+            values.push_back(JournalCodec<T>::read(in, end));
+        }
+        return values;
+    }
+};
+
+// Append-only write-ahead journal of container operations.
+// File layout: magic, then records of [op:u8][payload size:u32][checksum:u32][payload].
+// The first record is always a checkpoint with the base version of the container,
+// so replaying the journal from the start rebuilds the same sequence of versions.
+// Records are buffered and written with a single fsync per group (group commit).
+// Opening in Append mode continues an existing journal after its last valid record,
+// so a container rebuilt with replayJournal can keep journaling to the same file.
+class OperationJournal
+{
+public:
+    enum class Op : std::uint8_t
+    {
+        Checkpoint = 1,
+        AddVersion = 2,
+        PushFront = 3,
+        PushBack = 4,
+        Undo = 5,
+        Redo = 6,
+        Erase = 7,
+        ScaleVersion = 8,
+        Tag = 9,
+        Time = 10, // Creation time of the latest version, see VersionIndex::toNanoseconds
+        Splice = 11 // New values followed by the tail of a version, see PersistentDoublyLinkedList::commit
+    };
+
+    enum class Mode
+    {
+        Truncate, // Start a new, empty journal
+        Append    // Keep the valid records of an existing journal and drop a torn tail
+    };
+
+    // Opens the journal file; group_size records are batched per fsync
+    OperationJournal(const std::string& path, size_t group_size = 64, Mode mode = Mode::Truncate)
+        : group_size(group_size == 0 ? 1 : group_size)
+    {
+        std::error_code error;
+        if (mode == Mode::Append && std::filesystem::file_size(path, error) > 0 && !error)
+        {
+            Reader reader(path);
+            Op op;
+            const char* payload;
+            const char* payload_end;
+            while (reader.next(op, payload, payload_end))
+            {
+                records++;
+            }
+
+            std::filesystem::resize_file(path, reader.offset(), error);
+            file = error ? nullptr : std::fopen(path.c_str(), "r+b");
+            if (file && std::fseek(file, 0, SEEK_END) != 0)
+            {
+                std::fclose(file);
+                file = nullptr;
+            }
+        }
+        else
+        {
+            file = std::fopen(path.c_str(), "wb");
+            buffer.insert(buffer.end(), magic, magic + sizeof(magic));
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open journal file: " + path);
+        }
+    }
+
+    OperationJournal(const OperationJournal&) = delete;
+    OperationJournal& operator=(const OperationJournal&) = delete;
+
+    ~OperationJournal()
+    {
+        try
+        {
+            commit();
+        }
+        catch (...)
+        {
+        }
+        std::fclose(file);
+    }
+
+    // Method to append a record; the payload is the encoding of all fields in order.
+    // Fields are encoded into a scratch buffer first, so a codec that throws leaves the journal unchanged.
+    template <typename... Fields>
+    void append(Op op, const Fields&... fields)
+    {
+        scratch.clear();
+        int expand[] = { 0, (JournalCodec<Fields>::write(scratch, fields), 0)... };
+        (void)expand;
+
+        char header[header_size];
+        std::uint32_t payload_size = static_cast<std::uint32_t>(scratch.size());
+        std::uint32_t sum = checksum(scratch.data(), scratch.size());
+        header[0] = static_cast<char>(op);
+        std::memcpy(&header[1], &payload_size, sizeof(payload_size));
+        std::memcpy(&header[5], &sum, sizeof(sum));
+
+        buffer.reserve(buffer.size() + header_size + scratch.size()); // The inserts below cannot throw
+        buffer.insert(buffer.end(), header, header + header_size);
+        buffer.insert(buffer.end(), scratch.begin(), scratch.end());
+        records++;
+
+        if (++pending >= group_size)
+        {
+            commit();
+        }
+    }
+
+    // Method to write all buffered records and make them durable
+    void commit()
+    {
+        if (!buffer.empty())
+        {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size() || std::fflush(file) != 0)
+            {
+                throw std::runtime_error("Failed to write journal");
+            }
+            buffer.clear();
+        }
+        if (pending > 0)
+        {
+#ifdef _WIN32
+            int synced = _commit(_fileno(file));
+#else
+            int synced = fsync(fileno(file));
+#endif
+            if (synced != 0)
+            {
+                throw std::runtime_error("Failed to sync journal");
+            }
+            pending = 0;
+        }
+    }
+
+    size_t pendingRecords() const
+    {
+        return pending;
+    }
+
+    // Number of records in the journal, including the ones kept from an appended file
+    size_t recordCount() const
+    {
+        return records;
+    }
+
+    // Sequential reader over a journal file.
+    // The whole file is loaded with one read, records are decoded in place.
+    // A torn record at the tail (crash during write) ends the journal.
+    class Reader
+    {
+    public:
+        Reader(const std::string& path)
+        {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in)
+            {
+                throw std::runtime_error("Cannot open journal file: " + path);
+            }
+            data.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(data.data(), data.size());
+
+            if (data.size() < sizeof(magic) || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+            {
+                throw std::runtime_error("Not a journal file: " + path);
+            }
+            position = sizeof(magic);
+        }
+
+        // Method to move to the next complete record; returns false at the end of the journal
+        bool next(Op& op, const char*& payload, const char*& payload_end)
+        {
+            if (data.size() - position < header_size)
+            {
+                return false;
+            }
+
+            std::uint32_t payload_size;
+            std::uint32_t sum;
+            std::memcpy(&payload_size, &data[position + 1], sizeof(payload_size));
+            std::memcpy(&sum, &data[position + 5], sizeof(sum));
+            if (data.size() - position - header_size < payload_size ||
+                checksum(&data[position + header_size], payload_size) != sum)
+            {
+                return false;
+            }
+
+            op = static_cast<Op>(data[position]);
+            payload = data.data() + position + header_size;
+            payload_end = payload + payload_size;
+            position += header_size + payload_size;
+            return true;
+        }
+
+        // Byte offset just past the last record returned by next
+        size_t offset() const
+        {
+            return position;
+        }
+
+    private:
+        std::vector<char> data;
+        size_t position{};
+    };
+
+private:
+    static constexpr char magic[8] = { 'P', 'J', 'N', 'L', '0', '0', '0', '1' };
+    static constexpr size_t header_size = 1 + 2 * sizeof(std::uint32_t);
+
+    // FNV-1a, used to detect torn or corrupted records
+    static std::uint32_t checksum(const char* data, size_t size)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    std::FILE* file{};
+    std::vector<char> buffer{};
+    std::vector<char> scratch{}; // Payload of the record being appended
+    size_t group_size{};
+    size_t pending{};
+    size_t records{};
+};
+
+#endif // PERSISTENT_JOURNAL_H
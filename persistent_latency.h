@@ -0,0 +1,248 @@
+#ifndef PERSISTENT_LATENCY_H
+#define PERSISTENT_LATENCY_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Latency instrumentation of the hot paths of the containers.
+// Compile with PERSISTENT_INSTRUMENTATION defined to enable it; otherwise every
+// container holds an empty NullLatencyRecorder and PERSISTENT_TIME_OPERATION
+// expands to nothing, so there is no cost at all.
+
+enum class LatencyOp
+{
+    AddVersion,
+    EraseVersion,
+    Push,
+    GetVersion,
+    Lookup,
+    Undo,
+    Redo,
+    Convert,
+    Count // Number of operations, not an operation
+};
+
+inline const char* latencyOpName(LatencyOp op)
+{
+    static const char* const names[] = { "addVersion", "eraseVersion", "push", "getVersion", "lookup", "undo", "redo", "convert" };
+    return names[static_cast<int>(op)];
+}
+
+// HDR-style histogram of nanosecond latencies.
+// Values below 64 have exact buckets; above that every power of two is split
+// into 32 linear sub-buckets, so any recorded value is known within ~3%.
+// Recording is a few instructions and lock-free (relaxed atomics), so const
+// methods of a container can record from several threads at once.
+class LatencyHistogram
+{
+public:
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr int max_shift = 35; // Values are capped at 2^41 ns (~36 minutes)
+    static constexpr int bucket_count = (max_shift + 2) << sub_bucket_bits;
+
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram& other)
+    {
+        *this = other;
+    }
+
+    LatencyHistogram& operator=(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < bucket_count; ++i)
+        {
+            counts[i].store(other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        total.store(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        sum.store(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        maximum.store(other.maximum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    void record(std::uint64_t nanoseconds)
+    {
+        counts[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        std::uint64_t current = maximum.load(std::memory_order_relaxed);
+        while (nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::uint64_t count() const
+    {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t max() const
+    {
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    double mean() const
+    {
+        std::uint64_t recorded = count();
+        return recorded == 0 ? 0.0 : double(sum.load(std::memory_order_relaxed)) / double(recorded);
+    }
+
+    // Smallest bucket bound below which the given fraction (0..1) of the values lies
+    std::uint64_t percentile(double fraction) const
+    {
+        std::uint64_t recorded = count();
+        if (recorded == 0)
+        {
+            return 0;
+        }
+
+        std::uint64_t rank = static_cast<std::uint64_t>(fraction * double(recorded) + 0.5);
+        rank = std::max<std::uint64_t>(1, std::min(rank, recorded));
+        std::uint64_t seen = 0;
+        for (int i = 0; i < bucket_count; ++i)
+        {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return std::min(bucketUpperBound(i), max());
+            }
+        }
+        return max();
+    }
+
+    static int bucketIndex(std::uint64_t value)
+    {
+        // Shift that brings the value into [32, 64): position of the highest set bit minus sub_bucket_bits
+        int shift = 0;
+        if (value >= (std::uint64_t(2) << sub_bucket_bits))
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            shift = 63 - __builtin_clzll(value) - sub_bucket_bits;
+#else
+            while ((value >> shift) >= (std::uint64_t(2) << sub_bucket_bits))
+            {
+                ++shift;
+            }
+#endif
+            shift = std::min(shift, max_shift);
+        }
+        std::uint64_t sub_bucket = std::min<std::uint64_t>(value >> shift, (std::uint64_t(2) << sub_bucket_bits) - 1);
+        return (shift << sub_bucket_bits) + static_cast<int>(sub_bucket);
+    }
+
+    // Largest value that falls into a bucket
+    static std::uint64_t bucketUpperBound(int index)
+    {
+        int shift = std::max(0, (index >> sub_bucket_bits) - 1);
+        std::uint64_t sub_bucket = index - (shift << sub_bucket_bits);
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<std::uint64_t> counts[bucket_count]{};
+    std::atomic<std::uint64_t> total{};
+    std::atomic<std::uint64_t> sum{};
+    std::atomic<std::uint64_t> maximum{};
+};
+
+// One histogram per operation of a container instance
+class LatencyRecorder
+{
+public:
+    void record(LatencyOp op, std::uint64_t nanoseconds)
+    {
+        histograms[static_cast<int>(op)].record(nanoseconds);
+    }
+
+    const LatencyHistogram& histogram(LatencyOp op) const
+    {
+        return histograms[static_cast<int>(op)];
+    }
+
+    // Method to write one line per recorded operation: count, mean, p50/p90/p99/p99.9 and max in ns
+    void dump(std::ostream& out) const
+    {
+        out << "operation\tcount\tmean\tp50\tp90\tp99\tp99.9\tmax (ns)\n";
+        for (int i = 0; i < static_cast<int>(LatencyOp::Count); ++i)
+        {
+            const LatencyHistogram& h = histograms[i];
+            if (h.count() == 0)
+            {
+                continue;
+            }
+            out << latencyOpName(static_cast<LatencyOp>(i)) << "\t" << h.count() << "\t" << static_cast<std::uint64_t>(h.mean())
+                << "\t" << h.percentile(0.5) << "\t" << h.percentile(0.9) << "\t" << h.percentile(0.99)
+                << "\t" << h.percentile(0.999) << "\t" << h.max() << "\n";
+        }
+    }
+
+    // Method to write the same data as a JSON object keyed by operation name
+    void dumpJson(std::ostream& out) const
+    {
+        out << "{";
+        bool first = true;
+        for (int i = 0; i < static_cast<int>(LatencyOp::Count); ++i)
+        {
+            const LatencyHistogram& h = histograms[i];
+            if (h.count() == 0)
+            {
+                continue;
+            }
+            out << (first ? "" : ",") << "\"" << latencyOpName(static_cast<LatencyOp>(i)) << "\":{\"count\":" << h.count()
+                << ",\"mean_ns\":" << h.mean() << ",\"p50_ns\":" << h.percentile(0.5) << ",\"p90_ns\":" << h.percentile(0.9)
+                << ",\"p99_ns\":" << h.percentile(0.99) << ",\"p999_ns\":" << h.percentile(0.999) << ",\"max_ns\":" << h.max() << "}";
+            first = false;
+        }
+        out << "}";
+    }
+
+private:
+    LatencyHistogram histograms[static_cast<int>(LatencyOp::Count)];
+};
+
+// Stand-in used when instrumentation is compiled out
+class NullLatencyRecorder
+{
+public:
+    void dump(std::ostream&) const {}
+
+    void dumpJson(std::ostream& out) const
+    {
+        out << "{}";
+    }
+};
+
+// Records the lifetime of the object as one sample of an operation
+class LatencyTimer
+{
+public:
+    LatencyTimer(LatencyRecorder& recorder, LatencyOp op)
+        : recorder(recorder), op(op), start(std::chrono::steady_clock::now()) {}
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+    ~LatencyTimer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        recorder.record(op, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+private:
+    LatencyRecorder& recorder;
+    LatencyOp op;
+    std::chrono::steady_clock::time_point start;
+};
+
+#ifdef PERSISTENT_INSTRUMENTATION
+using OperationLatencies = LatencyRecorder;
+#define PERSISTENT_TIME_OPERATION(recorder, op) LatencyTimer latency_timer((recorder), (op))
+#else
+using OperationLatencies = NullLatencyRecorder;
+#define PERSISTENT_TIME_OPERATION(recorder, op) ((void)0)
+#endif
+
+#endif // PERSISTENT_LATENCY_H
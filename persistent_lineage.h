@@ -0,0 +1,77 @@
+#ifndef PERSISTENT_LINEAGE_H
+#define PERSISTENT_LINEAGE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Parent links between versions and the element each version changed.
+// Versions form a tree (every edit derives from one earlier version), so the elements
+// that differ between two versions are found by walking both up to their common
+// ancestor: the cost is the number of versions in between, not the size of a version.
+class VersionLineage
+{
+public:
+    // Method to add a version that does not derive from another one
+    void pushRoot()
+    {
+        entries.push_back({ entries.size(), 0, rewritten });
+    }
+
+    // Method to add a version that differs from parent in one position
+    void pushEdit(size_t parent, size_t position)
+    {
+        entries.push_back({ parent, entries[parent].depth + 1, position });
+    }
+
+    // Method to add a version equal to parent (undo/redo)
+    void pushCopy(size_t parent)
+    {
+        entries.push_back({ parent, entries[parent].depth + 1, unchanged });
+    }
+
+    // Method to add a version where any position may differ from parent
+    void pushRewrite(size_t parent)
+    {
+        entries.push_back({ parent, entries[parent].depth + 1, rewritten });
+    }
+
+    // Method to collect the positions that may differ between two versions.
+    // Returns false when the versions are not related by single-position edits only,
+    // or when more than limit versions lie between them; positions may repeat.
+    bool changedPositions(size_t from, size_t to, std::vector<size_t>& positions, size_t limit) const
+    {
+        size_t steps = 0;
+        while (from != to)
+        {
+            // Step up from the deeper version; both sides step up at equal depth
+            size_t& deeper = entries[from].depth >= entries[to].depth ? from : to;
+            const Entry& entry = entries[deeper];
+            if (entry.parent == deeper || entry.changed == rewritten || ++steps > limit)
+            {
+                return false; // Reached a root or a full rewrite, or walking would cost more than a copy
+            }
+            if (entry.changed != unchanged)
+            {
+                positions.push_back(entry.changed);
+            }
+            deeper = entry.parent;
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t unchanged = std::numeric_limits<size_t>::max();
+    static constexpr size_t rewritten = std::numeric_limits<size_t>::max() - 1;
+
+    struct Entry
+    {
+        size_t parent; // Equal to the version itself for a root
+        size_t depth; // Number of parent links to the root
+        size_t changed; // Changed position, unchanged or rewritten
+    };
+
+    std::vector<Entry> entries{};
+};
+
+#endif // PERSISTENT_LINEAGE_H
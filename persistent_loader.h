@@ -0,0 +1,381 @@
+#ifndef PERSISTENT_LOADER_H
+#define PERSISTENT_LOADER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "persistent_parallel.h"
+
+// Streaming sources for the iterator range constructors of the containers.
+// Files are memory-mapped and read in place: building a base version from them needs
+// no intermediate copy of the data set, and the mapped pages are backed by the file,
+// so the kernel can drop them again once they have been read.
+// Key order matters for the associative arrays: rows in ascending key order are loaded in O(n)
+// by both trees. Otherwise the B+-tree collects and sorts the rows, and PersistentAssociativeArray,
+// an unbalanced tree, inserts them one by one, which is O(n^2) for mostly descending keys.
+
+// Read-only mapping of a whole file (read into memory on platforms without mmap)
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        buffer.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(buffer.data(), buffer.size());
+        address = buffer.data();
+        length = buffer.size();
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0)
+        {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("Cannot map file: " + path);
+            }
+            madvise(mapped, length, MADV_SEQUENTIAL);
+            address = static_cast<const char*>(mapped);
+        }
+        close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (address)
+        {
+            munmap(const_cast<char*>(address), length);
+        }
+#endif
+    }
+
+    const char* data() const
+    {
+        return address;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+    const char* address{};
+    size_t length{};
+};
+
+// Binary file of consecutive T records, e.g. PersistentArray<T>(records.begin(), records.end()).
+// The records are read straight from the mapping, so T must be trivially copyable.
+template <typename T>
+class BinaryRecords
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Binary records must be trivially copyable");
+
+public:
+    explicit BinaryRecords(const std::string& path)
+        : file(std::make_shared<MappedFile>(path))
+    {
+        if (file->size() % sizeof(T) != 0)
+        {
+            throw std::runtime_error("File size is not a multiple of the record size: " + path);
+        }
+    }
+
+    const T* begin() const
+    {
+        return reinterpret_cast<const T*>(file->data());
+    }
+
+    const T* end() const
+    {
+        return begin() + size();
+    }
+
+    size_t size() const
+    {
+        return file->size() / sizeof(T);
+    }
+
+private:
+    std::shared_ptr<MappedFile> file;
+};
+
+// Parser of one CSV field; numbers use std::from_chars, strings run to the next comma or line end
+template <typename T, typename Enable = void>
+struct CsvField;
+
+template <typename T>
+struct CsvField<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+{
+    static T parse(const char*& in, const char* end)
+    {
+        while (in != end && *in == ' ')
+        {
+            ++in;
+        }
+        T value{};
+        auto result = std::from_chars(in, end, value);
+        if (result.ec != std::errc())
+        {
+            throw std::runtime_error("Invalid CSV field");
+        }
+        in = result.ptr;
+        return value;
+    }
+};
+
+template <>
+struct CsvField<std::string>
+{
+    static std::string parse(const char*& in, const char* end)
+    {
+        const char* start = in;
+        while (in != end && *in != ',' && *in != '\n' && *in != '\r')
+        {
+            ++in;
+        }
+        return std::string(start, in);
+    }
+};
+
+// Parser of one CSV row: one column for sequences, key and value columns for std::pair rows
+template <typename Row>
+struct CsvRow
+{
+    static Row parse(const char*& in, const char* end)
+    {
+        return CsvField<Row>::parse(in, end);
+    }
+};
+
+template <typename KeyType, typename ValueType>
+struct CsvRow<std::pair<KeyType, ValueType>>
+{
+    static std::pair<KeyType, ValueType> parse(const char*& in, const char* end)
+    {
+        KeyType key = CsvField<KeyType>::parse(in, end);
+        if (in == end || *in != ',')
+        {
+            throw std::runtime_error("Invalid CSV row: expected two columns");
+        }
+        ++in;
+        return { std::move(key), CsvField<ValueType>::parse(in, end) };
+    }
+};
+
+// Rows of a memory-mapped CSV file, parsed one at a time while iterating.
+// Empty lines are skipped, columns after the parsed ones are ignored.
+template <typename Row>
+class CsvRows
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Row*;
+        using reference = const Row&;
+
+        iterator() = default;
+
+        reference operator*() const
+        {
+            return row;
+        }
+
+        pointer operator->() const
+        {
+            return &row;
+        }
+
+        iterator& operator++()
+        {
+            advance();
+            return *this;
+        }
+
+        // Post-increment of an input iterator only has to advance it
+        void operator++(int)
+        {
+            advance();
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return position == other.position;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return position != other.position;
+        }
+
+    private:
+        friend class CsvRows;
+
+        const char* position{}; // Start of the current row, nullptr at the end
+        const char* next{}; // Start of the following line
+        const char* end{};
+        Row row{};
+
+        iterator(const char* begin, const char* end) : next(begin), end(end)
+        {
+            advance();
+        }
+
+        void advance()
+        {
+            position = skipEmptyLines(next, end);
+            if (position == end)
+            {
+                position = nullptr;
+                return;
+            }
+            const char* in = position;
+            row = CsvRow<Row>::parse(in, end);
+            next = lineEnd(in, end);
+        }
+    };
+
+    // skip_header drops the first line of the file
+    explicit CsvRows(const std::string& path, bool skip_header = false)
+        : file(std::make_shared<MappedFile>(path))
+    {
+        first = file->data();
+        last = first + file->size();
+        if (skip_header)
+        {
+            first = lineEnd(first, last);
+        }
+    }
+
+    iterator begin() const
+    {
+        return iterator(first, last);
+    }
+
+    iterator end() const
+    {
+        return iterator();
+    }
+
+    // Method to parse all rows with the pool: the file is cut at line boundaries, every piece
+    // counts its rows, then every piece parses straight into its slice of the result
+    std::vector<Row> parseParallel(WorkStealingPool& pool) const
+    {
+        const size_t min_piece = 1 << 16;
+        size_t pieces = std::max<size_t>(1, std::min((last - first) / min_piece, pool.size() * 4));
+        std::vector<const char*> starts(pieces + 1, last);
+        starts[0] = first;
+        for (size_t i = 1; i < pieces; ++i)
+        {
+            starts[i] = std::max(starts[i - 1], lineEnd(first + (last - first) * i / pieces - 1, last));
+        }
+
+        std::vector<size_t> offsets(pieces + 1, 0);
+        pool.parallelFor(pieces, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                offsets[i + 1] = countRows(starts[i], starts[i + 1]);
+            }
+        });
+        for (size_t i = 0; i < pieces; ++i)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+
+        std::vector<Row> rows(offsets[pieces]);
+        pool.parallelFor(pieces, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t index = offsets[i];
+                for (iterator it(starts[i], starts[i + 1]); it != iterator(); ++it)
+                {
+                    rows[index++] = std::move(it.row);
+                }
+            }
+        });
+        return rows;
+    }
+
+private:
+    std::shared_ptr<MappedFile> file;
+    const char* first{};
+    const char* last{};
+
+    // Start of the line after the one containing in
+    static const char* lineEnd(const char* in, const char* end)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(in, '\n', end - in));
+        return newline ? newline + 1 : end;
+    }
+
+    static const char* skipEmptyLines(const char* in, const char* end)
+    {
+        while (in != end && (*in == '\n' || *in == '\r'))
+        {
+            ++in;
+        }
+        return in;
+    }
+
+    static size_t countRows(const char* in, const char* end)
+    {
+        size_t count = 0;
+        for (in = skipEmptyLines(in, end); in != end; in = skipEmptyLines(lineEnd(in, end), end))
+        {
+            ++count;
+        }
+        return count;
+    }
+};
+
+#endif // PERSISTENT_LOADER_H
@@ -0,0 +1,268 @@
+#ifndef PERSISTENT_PARALLEL_H
+#define PERSISTENT_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join thread pool with work stealing.
+// Every participant owns a deque: it pushes and pops its own tasks at the back
+// (newest, cache-warm work first) and steals from the front of other deques
+// (oldest, largest pieces of work) when it runs out.
+// The thread that waits on a TaskGroup keeps executing tasks, so nested
+// fork-join (a task spawning and waiting for subtasks) does not deadlock.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // thread_count participants: thread_count - 1 workers plus the waiting caller; 0 = hardware concurrency
+    explicit WorkStealingPool(size_t thread_count = 0)
+    {
+        if (thread_count == 0)
+        {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        for (size_t i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    size_t size() const
+    {
+        return queues.size();
+    }
+
+    // Group of tasks that can be waited for together; the first exception thrown by a task is rethrown by wait()
+    class TaskGroup
+    {
+    public:
+        explicit TaskGroup(WorkStealingPool& pool) : pool(pool) {}
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        ~TaskGroup()
+        {
+            // Tasks reference the group, so it must outlive them
+            while (pending.load() > 0)
+            {
+                if (!pool.runOne())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        template <typename F>
+        void spawn(F f)
+        {
+            pending.fetch_add(1);
+            pool.submit([this, f]()
+            {
+                try
+                {
+                    f();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+                pending.fetch_sub(1);
+            });
+        }
+
+        // Method to wait for all spawned tasks, executing queued tasks meanwhile
+        void wait()
+        {
+            while (pending.load() > 0)
+            {
+                if (!pool.runOne())
+                {
+                    std::this_thread::yield();
+                }
+            }
+            if (error)
+            {
+                std::exception_ptr rethrown = error;
+                error = nullptr;
+                std::rethrow_exception(rethrown);
+            }
+        }
+
+    private:
+        WorkStealingPool& pool;
+        std::atomic<size_t> pending{};
+        std::mutex error_mutex;
+        std::exception_ptr error{};
+    };
+
+    // Method to run f(begin, end) over [0, count), recursively halving the range down to grain elements
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, F f)
+    {
+        TaskGroup group(*this);
+        splitRange(group, 0, count, grain == 0 ? 1 : grain, f);
+        group.wait();
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued{};
+
+    std::mutex sleep_mutex;
+    std::condition_variable wakeup;
+    bool stopping{};
+
+    // Queue of the calling thread: workers own queues 1..n-1, any other thread uses queue 0
+    size_t ownQueue() const
+    {
+        return current_pool() == this ? current_queue() : 0;
+    }
+
+    static const WorkStealingPool*& current_pool()
+    {
+        static thread_local const WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& current_queue()
+    {
+        static thread_local size_t queue = 0;
+        return queue;
+    }
+
+    void submit(Task task)
+    {
+        Queue& queue = *queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        wakeup.notify_one();
+    }
+
+    // Method to execute one task: own newest task first, otherwise steal the oldest task of another queue
+    bool runOne()
+    {
+        size_t own = ownQueue();
+        Task task;
+        {
+            Queue& queue = *queues[own];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+
+        for (size_t i = 1; !task && i < queues.size(); ++i)
+        {
+            Queue& victim = *queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+        {
+            return false;
+        }
+        queued.fetch_sub(1);
+        task();
+        return true;
+    }
+
+    void workerLoop(size_t index)
+    {
+        current_pool() = this;
+        current_queue() = index;
+
+        while (true)
+        {
+            if (runOne())
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            if (stopping)
+            {
+                return;
+            }
+            wakeup.wait_for(lock, std::chrono::milliseconds(1), [this] { return stopping || queued.load() > 0; });
+        }
+    }
+
+    template <typename F>
+    void splitRange(TaskGroup& group, size_t begin, size_t end, size_t grain, F& f)
+    {
+        while (end - begin > grain)
+        {
+            size_t middle = begin + (end - begin) / 2;
+            group.spawn([this, &group, middle, end, grain, &f] { splitRange(group, middle, end, grain, f); });
+            end = middle;
+        }
+        f(begin, end);
+    }
+};
+
+// Elements per leaf task when a version is split by index
+const size_t parallel_grain = 16384;
+
+// Result of one chunk of a parallel reduction. Every result has its own cache line, so threads
+// writing neighbouring results neither race (std::vector<bool> packs its elements into shared
+// words) nor slow each other down by false sharing.
+template <typename T>
+struct alignas(64) ChunkResult
+{
+    T value;
+};
+
+#endif // PERSISTENT_PARALLEL_H
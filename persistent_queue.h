@@ -0,0 +1,370 @@
+#ifndef PERSISTENT_QUEUE_H
+#define PERSISTENT_QUEUE_H
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_latency.h"
+#include "persistent_stack.h"
+#include "persistent_storage.h"
+
+template <typename T>
+struct Queue_stream;
+
+// Evaluated cell of a front stream
+template <typename T>
+struct Queue_cell
+{
+    T value;
+    mutable std::shared_ptr<Queue_stream<T>> next; // nullptr for the end of the stream; mutable only so that the stream can be released iteratively
+
+    ~Queue_cell()
+    {
+        Queue_stream<T>::release(std::move(next));
+    }
+};
+
+// Lazy, memoized stream cell: either evaluated, or a suspended step of the rotation
+// front ++ reverse(rear) ++ accumulated that is computed when it is first forced
+template <typename T>
+struct Queue_stream
+{
+    std::shared_ptr<const Queue_cell<T>> cell; // Set once forced
+    std::shared_ptr<Queue_stream<T>> front; // Rotation arguments, released once forced
+    std::shared_ptr<const Stack_node<T>> rear;
+    std::shared_ptr<Queue_stream<T>> accumulated;
+
+    ~Queue_stream()
+    {
+        release(std::move(front));
+        release(std::move(accumulated));
+    }
+
+    // Method to release a stream and the streams after it that nothing else refers to, one at a time:
+    // releasing a long stream recursively would overflow the call stack
+    static void release(std::shared_ptr<Queue_stream<T>> rest)
+    {
+        while (rest && rest.use_count() == 1)
+        {
+            std::shared_ptr<Queue_stream<T>> next;
+            if (!rest->cell)
+            {
+                release(std::move(rest->front)); // A rotation starts on an evaluated front, so this does not nest
+                next = std::move(rest->accumulated);
+            }
+            else if (rest->cell.use_count() == 1)
+            {
+                next = std::move(rest->cell->next);
+            }
+            rest = std::move(next);
+        }
+    }
+};
+
+// Persistent FIFO queue with O(1) worst-case push and pop (Okasaki's real-time queue).
+// A version is a lazy front stream, a rear list in reverse order and a schedule: the part of
+// the front that is not evaluated yet. Every operation evaluates one cell of the schedule, so
+// when the rear has grown past the front and is rotated into it, the rotation is spread over
+// the following operations instead of costing O(n) at once; no operation does more than O(1).
+// Versions share the memoized stream cells, so reading a version may evaluate shared cells:
+// unlike the other containers, versions must not be read from several threads at once.
+template <typename T>
+class PersistentQueue
+{
+private:
+    using Stream = std::shared_ptr<Queue_stream<T>>;
+
+    struct Version
+    {
+        Stream front{};
+        std::shared_ptr<const Stack_node<T>> rear{};
+        Stream schedule{};
+        size_t front_size{};
+        size_t rear_size{};
+    };
+
+    std::vector<Version> versions{}; // All versions will be stored here
+
+    int current_version{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    static Stream ready(T value, Stream next)
+    {
+        auto stream = std::make_shared<Queue_stream<T>>();
+        stream->cell = std::make_shared<const Queue_cell<T>>(Queue_cell<T>{ std::move(value), std::move(next) });
+        return stream;
+    }
+
+    static Stream rotation(Stream front, std::shared_ptr<const Stack_node<T>> rear, Stream accumulated)
+    {
+        auto stream = std::make_shared<Queue_stream<T>>();
+        stream->front = std::move(front);
+        stream->rear = std::move(rear);
+        stream->accumulated = std::move(accumulated);
+        return stream;
+    }
+
+    // First cell of a non-empty stream; one rotation step if it was not evaluated yet
+    static const Queue_cell<T>& force(Queue_stream<T>& stream)
+    {
+        if (!stream.cell)
+        {
+            // rotate(f, r, a): head r joins a, so the rotation always yields at least one cell
+            Stream rest = ready(stream.rear->value, std::move(stream.accumulated));
+            if (!stream.front)
+            {
+                stream.cell = rest->cell;
+            }
+            else
+            {
+                const Queue_cell<T>& first = force(*stream.front);
+                stream.cell = std::make_shared<const Queue_cell<T>>(Queue_cell<T>{ first.value, rotation(first.next, stream.rear->next, std::move(rest)) });
+            }
+            stream.front = nullptr;
+            stream.rear = nullptr;
+        }
+        return *stream.cell;
+    }
+
+    // Method to restore the invariant schedule size == front size - rear size after an operation
+    static Version exec(Version version)
+    {
+        if (version.schedule)
+        {
+            version.schedule = force(*version.schedule).next;
+            return version;
+        }
+
+        // The rear is one longer than the front: start rotating it into the front
+        version.front = rotation(version.front, version.rear, nullptr);
+        version.schedule = version.front;
+        version.front_size += version.rear_size;
+        version.rear = nullptr;
+        version.rear_size = 0;
+        return version;
+    }
+
+    void checkRoot(int root_position) const
+    {
+        if (root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+    }
+
+    const Version& checkedVersion(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return versions[idx];
+    }
+
+    // Method to store the elements of a range as version 0, the first element at the front
+    template <typename InputIt>
+    void build(InputIt first, InputIt last)
+    {
+        Version base;
+        Queue_stream<T>* back = nullptr;
+        for (; first != last; ++first, ++base.front_size)
+        {
+            Stream stream = ready(*first, nullptr);
+            Queue_stream<T>* next = stream.get();
+            if (back)
+            {
+                // The cell is still private to the constructor, so it can be linked in place
+                const_cast<Queue_cell<T>&>(*back->cell).next = std::move(stream);
+            }
+            else
+            {
+                base.front = std::move(stream);
+            }
+            back = next;
+        }
+        base.schedule = base.front; // Already evaluated, forcing it is free
+
+        versions.push_back(std::move(base));
+        current_version = 0;
+    }
+
+public:
+    // Constructor of an empty queue
+    PersistentQueue()
+    {
+        versions.push_back(Version{});
+        current_version = 0;
+    }
+
+    // Constructor, accepts an array and its size; the first element is the front
+    PersistentQueue(T* arr, int size)
+    {
+        if (size < 0)
+        {
+            throw std::invalid_argument("Size must not be negative.");
+        }
+        build(arr, arr + size);
+    }
+
+    // Constructor from the first size elements of a vector
+    PersistentQueue(const std::vector<T>& vec, int size)
+    {
+        if (size < 0 || static_cast<size_t>(size) > vec.size())
+        {
+            throw std::invalid_argument("Size must be between 0 and the vector size.");
+        }
+        build(vec.begin(), vec.begin() + size);
+    }
+
+    // Constructor from an iterator range; the first element is the front
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentQueue(InputIt first, InputIt last)
+    {
+        build(first, last);
+    }
+
+    // Method to add a new version with value appended to the back of the version at root_position, O(1)
+    void pushVersion(int root_position, T value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Push);
+        checkRoot(root_position);
+        Version version = versions[root_position];
+        version.rear = std::make_shared<const Stack_node<T>>(Stack_node<T>{ std::move(value), std::move(version.rear) });
+        version.rear_size++;
+        versions.push_back(exec(std::move(version)));
+        current_version++;
+    }
+
+    // Method to add a new version with the front of the version at root_position removed, O(1)
+    void popVersion(int root_position)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::EraseVersion);
+        checkRoot(root_position);
+        Version version = versions[root_position];
+        if (!version.front)
+        {
+            throw std::out_of_range("Queue is empty"); // The front is only empty when the rear is
+        }
+        version.front = force(*version.front).next;
+        version.front_size--;
+        versions.push_back(exec(std::move(version)));
+        current_version++;
+    }
+
+    // Method to push to the back of the latest version
+    void push(T value)
+    {
+        pushVersion(static_cast<int>(versions.size()) - 1, std::move(value));
+    }
+
+    // Method to pop from the front of the latest version
+    void pop()
+    {
+        popVersion(static_cast<int>(versions.size()) - 1);
+    }
+
+    // Front element of a version
+    const T& front(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        const Version& version = checkedVersion(idx);
+        if (!version.front)
+        {
+            throw std::out_of_range("Queue is empty");
+        }
+        return force(*version.front).value;
+    }
+
+    size_t size(size_t idx) const
+    {
+        const Version& version = checkedVersion(idx);
+        return version.front_size + version.rear_size;
+    }
+
+    bool empty(size_t idx) const
+    {
+        return size(idx) == 0;
+    }
+
+    // Method to make UNDO action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+    }
+
+    // Method to make REDO action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;  // Move to the next version
+        versions.push_back(versions[current_version]);
+    }
+
+    // Elements of a version from the front to the back
+    std::vector<T> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        const Version& version = checkedVersion(idx);
+
+        std::vector<T> result;
+        result.reserve(version.front_size + version.rear_size);
+        for (Queue_stream<T>* stream = version.front.get(); stream; stream = force(*stream).next.get())
+        {
+            result.push_back(force(*stream).value);
+        }
+        for (const Stack_node<T>* node = version.rear.get(); node; node = node->next.get())
+        {
+            result.push_back(node->value);
+        }
+        std::reverse(result.begin() + version.front_size, result.end()); // The rear is stored newest first
+        return result;
+    }
+
+    // Method to print all versions, front first
+    void printAllVersions() const
+    {
+        for (size_t i = 0; i < versions.size(); i++)
+        {
+            std::vector<T> values = getVersion(i);
+            std::cout << "Version [" << i << "]: \t{";
+            for (size_t j = 0; j < values.size(); ++j)
+            {
+                std::cout << values[j] << (j + 1 < values.size() ? ", " : "");
+            }
+            std::cout << "}\n";
+        }
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+};
+
+#endif // PERSISTENT_QUEUE_H
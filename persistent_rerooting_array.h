@@ -0,0 +1,272 @@
+#ifndef PERSISTENT_REROOTING_ARRAY_H
+#define PERSISTENT_REROOTING_ARRAY_H
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_latency.h"
+#include "persistent_stats.h"
+#include "persistent_storage.h"
+
+// Version node of a rerooting array.
+// Exactly one node (the root) owns the fully materialized array;
+// every other node is a diff "same as next, except data[index] == value".
+template <typename T>
+struct RA_node
+{
+    std::vector<T> data{}; // Materialized values, only filled in the root
+    size_t index{};
+    T value{};
+    std::shared_ptr<RA_node<T>> next{}; // nullptr for the root
+
+    bool isRoot() const
+    {
+        return next == nullptr;
+    }
+};
+
+// Alternative PersistentArray with Baker's trick (rerooting):
+// the version that was accessed last is stored as a plain array, so reads and
+// addVersion on it are O(1). Accessing another version reverses the diff chain
+// between it and the current root, which costs O(distance) once.
+// Reads mutate the internal layout, so an instance must not be shared between threads.
+template <typename T>
+class RerootingPersistentArray
+{
+private:
+    using NodePtr = std::shared_ptr<RA_node<T>>;
+
+    std::vector<NodePtr> versions{}; // All versions will be stored here
+
+    int current_version{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    // Every version is one node; all of them share the single flat array through the diff chain,
+    // so a version reaches its own node and undo/redo only add a reference to an existing one
+    MemoryCounters memory{ sharedAllocationBytes<RA_node<T>>() };
+
+    // Method to record the last stored version in the memory counters
+    void countVersion(size_t new_nodes)
+    {
+        memory.addNodes(new_nodes);
+        memory.pushVersion(1);
+    }
+
+    // Method to store the base version; the flat array is its only separate allocation
+    void storeBase(NodePtr base)
+    {
+        memory.addAllocations(1, base->data.capacity() * sizeof(T));
+        versions.push_back(std::move(base)); // Store the base version
+        countVersion(1);
+    }
+
+    // Make the node of the version the root, flipping the diffs on the path to the old root
+    static void reroot(const NodePtr& node)
+    {
+        if (node->isRoot())
+        {
+            return;
+        }
+
+        std::vector<NodePtr> path;
+        for (NodePtr current = node; current; current = current->next)
+        {
+            path.push_back(current);
+        }
+
+        // Walk from the old root back to the requested node, moving the array one step at a time
+        for (size_t i = path.size() - 1; i > 0; --i)
+        {
+            const NodePtr& root = path[i];
+            const NodePtr& child = path[i - 1];
+
+            child->data = std::move(root->data);
+            root->data.clear();
+
+            root->index = child->index;
+            root->value = std::move(child->data[child->index]);
+            child->data[child->index] = std::move(child->value);
+            root->next = child;
+            child->next = nullptr;
+        }
+    }
+
+    const std::vector<T>& materialize(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        reroot(versions[idx]);
+        return versions[idx]->data;
+    }
+
+public:
+    // Constructor, accepts an array and its size
+    RerootingPersistentArray(T* arr, int size)
+    {
+        if (size < 0)
+        {
+            throw std::invalid_argument("Size must not be negative.");
+        }
+        auto base = std::make_shared<RA_node<T>>();
+        base->data.assign(arr, arr + size);
+        storeBase(std::move(base));
+    }
+
+    // Constructor from the first size elements of a vector
+    RerootingPersistentArray(std::vector<T> vec, int size)
+    {
+        if (size < 0 || static_cast<size_t>(size) > vec.size())
+        {
+            throw std::invalid_argument("Size must be between 0 and the vector size.");
+        }
+        vec.resize(size);
+        auto base = std::make_shared<RA_node<T>>();
+        base->data = std::move(vec);
+        storeBase(std::move(base));
+    }
+
+    // Constructor that builds the base version from an iterator range without an intermediate vector
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    RerootingPersistentArray(InputIt first, InputIt last)
+    {
+        auto base = std::make_shared<RA_node<T>>();
+        base->data.assign(first, last);
+        storeBase(std::move(base));
+    }
+
+    // Method to add a new version of the array; O(1) when root_position is the active version
+    void addVersion(int root_position, int change_index, T new_value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        // Check the validity of indices
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        NodePtr parent = versions[root_position];
+        reroot(parent);
+        if (change_index < 0 || static_cast<size_t>(change_index) >= parent->data.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+
+        // The new version takes over the array, the parent becomes a diff pointing to it
+        auto new_version = std::make_shared<RA_node<T>>();
+        new_version->data = std::move(parent->data);
+        parent->data.clear();
+        parent->index = change_index;
+        parent->value = std::move(new_version->data[change_index]);
+        parent->next = new_version;
+        new_version->data[change_index] = std::move(new_value);
+
+        versions.push_back(new_version); // Store the new version
+        current_version++;
+        countVersion(1); // The array moves to the new version, only the node is allocated
+    }
+
+    // Method to undo the last action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+        countVersion(0);
+    }
+
+    // Method to redo an action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;
+        versions.push_back(versions[current_version]);
+        countVersion(0);
+    }
+
+    // Method to read one element; O(1) for the active version
+    const T& get(size_t idx, size_t index) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        const std::vector<T>& data = materialize(idx);
+        if (index >= data.size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        return data[index];
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Memory and sharing statistics, O(1); the version part describes what idx allocated itself
+    MemoryStats memoryStats(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return memory.stats(idx);
+    }
+
+    // Index of the version currently stored as the flat array
+    size_t activeVersion() const
+    {
+        for (size_t i = versions.size(); i > 0; --i)
+        {
+            if (versions[i - 1]->isRoot())
+            {
+                return i - 1;
+            }
+        }
+        return 0;
+    }
+
+    // Method to print all versions
+    void printAllVersions()
+    {
+        for (size_t i = 0; i < versions.size(); i++)
+        {
+            const std::vector<T>& data = materialize(i);
+            std::cout << "Version [" << i << "]: \t{";
+            for (size_t j = 0; j < data.size(); j++)
+            {
+                std::cout << data[j];
+                if (j < data.size() - 1)
+                {
+                    std::cout << ", ";
+                }
+            }
+            std::cout << "}\n";
+        }
+    }
+
+    std::vector<T> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        return materialize(idx); // Copy of the flat array
+    }
+};
+
+#endif // PERSISTENT_REROOTING_ARRAY_H
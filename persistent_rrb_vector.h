@@ -0,0 +1,451 @@
+#ifndef PERSISTENT_RRB_VECTOR_H
+#define PERSISTENT_RRB_VECTOR_H
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_storage.h"
+
+// Node of a relaxed radix balanced tree.
+// Leaves hold up to RRBVector::leaf_capacity elements, inner nodes hold up to
+// RRBVector::branching children and a size table with cumulative element counts,
+// so nodes do not have to be full and index lookup does not rely on pure radix math.
+template <typename T>
+struct RRB_node
+{
+    std::vector<T> values{}; // Elements, only filled in leaves
+    std::vector<std::shared_ptr<const RRB_node<T>>> children{};
+    std::vector<size_t> sizes{}; // Size table: sizes[k] = number of elements in children[0..k]
+    int height{}; // 0 for leaves
+    size_t node_count{ 1 }; // Nodes in the subtree, this one included
+
+    size_t size() const
+    {
+        return height == 0 ? values.size() : sizes.back();
+    }
+};
+
+// Immutable sequence on top of an RRB tree; every modification returns a new vector
+// sharing all untouched nodes with the original.
+// at/set are O(log n); concat, split, slice, insert and erase are O(log n) as well:
+// concatenation only rebuilds the nodes along the seam between the two trees,
+// and splitting only copies the nodes along the path to the split point.
+template <typename T>
+class RRBVector
+{
+public:
+    using Node = RRB_node<T>;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    static constexpr size_t branching = 32;
+    static constexpr size_t leaf_capacity = leafCapacity<T>(branching); // Chosen from sizeof(T), see persistent_storage.h
+
+    RRBVector() = default;
+
+    explicit RRBVector(const std::vector<T>& values)
+    {
+        if (values.empty())
+        {
+            return;
+        }
+
+        // Build full leaves, then group them level by level
+        std::vector<NodePtr> level;
+        for (size_t i = 0; i < values.size(); i += leaf_capacity)
+        {
+            auto leaf = std::make_shared<Node>();
+            leaf->values.assign(values.begin() + i, values.begin() + std::min(values.size(), i + leaf_capacity));
+            level.push_back(leaf);
+        }
+        root = buildLevels(std::move(level));
+    }
+
+    // Built from an iterator range in one pass, one full leaf at a time
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    RRBVector(InputIt first, InputIt last)
+    {
+        std::vector<NodePtr> level;
+        while (first != last)
+        {
+            auto leaf = std::make_shared<Node>();
+            leaf->values.reserve(leaf_capacity);
+            for (; first != last && leaf->values.size() < leaf_capacity; ++first)
+            {
+                leaf->values.push_back(*first);
+            }
+            level.push_back(leaf);
+        }
+        if (!level.empty())
+        {
+            root = buildLevels(std::move(level));
+        }
+    }
+
+    size_t size() const
+    {
+        return root ? root->size() : 0;
+    }
+
+    bool empty() const
+    {
+        return !root;
+    }
+
+    int height() const
+    {
+        return root ? root->height : -1;
+    }
+
+    // Number of nodes reachable from the root, O(1)
+    size_t nodeCount() const
+    {
+        return root ? root->node_count : 0;
+    }
+
+    // Method to visit the nodes this vector does not share with any other live vector.
+    // A node of another vector is referenced from that vector's tree as well, so the walk
+    // only descends into nodes with a single owner: the ones created by the last operation.
+    template <typename Visitor>
+    void forEachUniqueNode(Visitor visit) const
+    {
+        if (root && root.use_count() == 1)
+        {
+            forEachUniqueNode(*root, visit);
+        }
+    }
+
+    const T& at(size_t index) const
+    {
+        if (index >= size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+
+        const Node* node = root.get();
+        while (node->height > 0)
+        {
+            size_t k = childIndex(*node, index);
+            index -= k > 0 ? node->sizes[k - 1] : 0;
+            node = node->children[k].get();
+        }
+        return node->values[index];
+    }
+
+    // New vector with the element at index replaced
+    RRBVector set(size_t index, T value) const
+    {
+        if (index >= size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        return RRBVector(setNode(root, index, std::move(value)));
+    }
+
+    RRBVector push_back(T value) const
+    {
+        return concat(*this, single(std::move(value)));
+    }
+
+    RRBVector push_front(T value) const
+    {
+        return concat(single(std::move(value)), *this);
+    }
+
+    // New vector with value inserted before position index (index == size() appends)
+    RRBVector insert(size_t index, T value) const
+    {
+        if (index > size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        auto parts = split(index);
+        return concat(concat(parts.first, single(std::move(value))), parts.second);
+    }
+
+    RRBVector erase(size_t index) const
+    {
+        if (index >= size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        auto parts = split(index);
+        return concat(parts.first, parts.second.split(1).second);
+    }
+
+    // Elements [first, last)
+    RRBVector slice(size_t first, size_t last) const
+    {
+        if (first > last || last > size())
+        {
+            throw std::out_of_range("Invalid slice bounds");
+        }
+        return split(last).first.split(first).second;
+    }
+
+    // Elements [0, index) and [index, size())
+    std::pair<RRBVector, RRBVector> split(size_t index) const
+    {
+        if (index > size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        if (index == 0)
+        {
+            return { RRBVector(), *this };
+        }
+        if (index == size())
+        {
+            return { *this, RRBVector() };
+        }
+
+        auto parts = splitNode(root, index);
+        return { RRBVector(collapse(parts.first)), RRBVector(collapse(parts.second)) };
+    }
+
+    static RRBVector concat(const RRBVector& left, const RRBVector& right)
+    {
+        if (!left.root)
+        {
+            return right;
+        }
+        if (!right.root)
+        {
+            return left;
+        }
+
+        std::vector<NodePtr> nodes = joinNodes(left.root, right.root);
+        return RRBVector(nodes.size() == 1 ? nodes[0] : makeInner(std::move(nodes)));
+    }
+
+    // Method to visit all elements in order
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        forEachNode(root.get(), visit);
+    }
+
+    std::vector<T> toVector() const
+    {
+        std::vector<T> result;
+        result.reserve(size());
+        appendLeaves(root.get(), result);
+        return result;
+    }
+
+private:
+    NodePtr root{};
+
+    explicit RRBVector(NodePtr root) : root(std::move(root)) {}
+
+    static RRBVector single(T value)
+    {
+        auto leaf = std::make_shared<Node>();
+        leaf->values.push_back(std::move(value));
+        return RRBVector(leaf);
+    }
+
+    // Position of the child holding the element with the given index, using the size table
+    static size_t childIndex(const Node& node, size_t index)
+    {
+        return std::upper_bound(node.sizes.begin(), node.sizes.end(), index) - node.sizes.begin();
+    }
+
+    // Group full nodes level by level until one root is left
+    static NodePtr buildLevels(std::vector<NodePtr> level)
+    {
+        while (level.size() > 1)
+        {
+            std::vector<NodePtr> parents;
+            for (size_t i = 0; i < level.size(); i += branching)
+            {
+                parents.push_back(makeInner(std::vector<NodePtr>(level.begin() + i, level.begin() + std::min(level.size(), i + branching))));
+            }
+            level.swap(parents);
+        }
+        return level[0];
+    }
+
+    static NodePtr makeInner(std::vector<NodePtr> children)
+    {
+        auto node = std::make_shared<Node>();
+        node->height = children[0]->height + 1;
+        size_t total = 0;
+        for (const auto& child : children)
+        {
+            total += child->size();
+            node->sizes.push_back(total);
+            node->node_count += child->node_count;
+        }
+        node->children = std::move(children);
+        return node;
+    }
+
+    // Pack children into one node, or two half-full nodes if they do not fit into one
+    static std::vector<NodePtr> pack(std::vector<NodePtr> children)
+    {
+        if (children.size() <= branching)
+        {
+            return { makeInner(std::move(children)) };
+        }
+        size_t half = children.size() / 2;
+        std::vector<NodePtr> second(children.begin() + half, children.end());
+        children.resize(half);
+        return { makeInner(std::move(children)), makeInner(std::move(second)) };
+    }
+
+    // Join two trees, descending along the seam until both sides have the same height.
+    // Returns one or two nodes of height max(left->height, right->height).
+    static std::vector<NodePtr> joinNodes(const NodePtr& left, const NodePtr& right)
+    {
+        if (left->height == 0 && right->height == 0)
+        {
+            if (left->size() + right->size() > leaf_capacity)
+            {
+                return { left, right };
+            }
+            auto leaf = std::make_shared<Node>();
+            leaf->values.reserve(left->size() + right->size());
+            leaf->values.insert(leaf->values.end(), left->values.begin(), left->values.end());
+            leaf->values.insert(leaf->values.end(), right->values.begin(), right->values.end());
+            return { leaf };
+        }
+
+        std::vector<NodePtr> children;
+        if (left->height > right->height)
+        {
+            children.assign(left->children.begin(), left->children.end() - 1);
+            for (auto& node : joinNodes(left->children.back(), right))
+            {
+                children.push_back(std::move(node));
+            }
+        }
+        else if (left->height < right->height)
+        {
+            children = joinNodes(left, right->children.front());
+            children.insert(children.end(), right->children.begin() + 1, right->children.end());
+        }
+        else
+        {
+            children.assign(left->children.begin(), left->children.end() - 1);
+            for (auto& node : joinNodes(left->children.back(), right->children.front()))
+            {
+                children.push_back(std::move(node));
+            }
+            children.insert(children.end(), right->children.begin() + 1, right->children.end());
+        }
+        return pack(std::move(children));
+    }
+
+    // Split a node at 0 < index < node->size(); both parts keep the height of the node
+    static std::pair<NodePtr, NodePtr> splitNode(const NodePtr& node, size_t index)
+    {
+        auto left = std::make_shared<Node>();
+        auto right = std::make_shared<Node>();
+
+        if (node->height == 0)
+        {
+            left->values.assign(node->values.begin(), node->values.begin() + index);
+            right->values.assign(node->values.begin() + index, node->values.end());
+            return { left, right };
+        }
+
+        size_t k = childIndex(*node, index);
+        size_t local = index - (k > 0 ? node->sizes[k - 1] : 0);
+
+        std::vector<NodePtr> left_children(node->children.begin(), node->children.begin() + k);
+        std::vector<NodePtr> right_children;
+        if (local == 0)
+        {
+            right_children.assign(node->children.begin() + k, node->children.end());
+        }
+        else
+        {
+            auto parts = splitNode(node->children[k], local);
+            left_children.push_back(parts.first);
+            right_children.push_back(parts.second);
+            right_children.insert(right_children.end(), node->children.begin() + k + 1, node->children.end());
+        }
+        return { makeInner(std::move(left_children)), makeInner(std::move(right_children)) };
+    }
+
+    // Remove single-child roots left over after a split
+    static NodePtr collapse(NodePtr node)
+    {
+        while (node->height > 0 && node->children.size() == 1)
+        {
+            node = node->children[0];
+        }
+        return node;
+    }
+
+    static NodePtr setNode(const NodePtr& node, size_t index, T value)
+    {
+        auto copy = std::make_shared<Node>(*node);
+        if (copy->height == 0)
+        {
+            copy->values[index] = std::move(value);
+            return copy;
+        }
+
+        size_t k = childIndex(*copy, index);
+        copy->children[k] = setNode(copy->children[k], index - (k > 0 ? copy->sizes[k - 1] : 0), std::move(value));
+        return copy;
+    }
+
+    // Method to append whole leaves; a bulk copy (memmove) for trivially copyable elements
+    static void appendLeaves(const Node* node, std::vector<T>& out)
+    {
+        if (!node)
+        {
+            return;
+        }
+        if (node->height == 0)
+        {
+            out.insert(out.end(), node->values.begin(), node->values.end());
+            return;
+        }
+        for (const auto& child : node->children)
+        {
+            appendLeaves(child.get(), out);
+        }
+    }
+
+    template <typename Visitor>
+    static void forEachUniqueNode(const Node& node, Visitor& visit)
+    {
+        visit(node);
+        for (const auto& child : node.children)
+        {
+            if (child.use_count() == 1)
+            {
+                forEachUniqueNode(*child, visit);
+            }
+        }
+    }
+
+    template <typename Visitor>
+    static void forEachNode(const Node* node, Visitor& visit)
+    {
+        if (!node)
+        {
+            return;
+        }
+        if (node->height == 0)
+        {
+            for (const auto& value : node->values)
+            {
+                visit(value);
+            }
+            return;
+        }
+        for (const auto& child : node->children)
+        {
+            forEachNode(child.get(), visit);
+        }
+    }
+};
+
+#endif // PERSISTENT_RRB_VECTOR_H
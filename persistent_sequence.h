@@ -0,0 +1,274 @@
+#ifndef PERSISTENT_SEQUENCE_H
+#define PERSISTENT_SEQUENCE_H
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "persistent_rrb_vector.h"
+#include "persistent_latency.h"
+#include "persistent_stats.h"
+
+// Persistent sequence backed by an RRB tree.
+// Offers both the PersistentArray interface (addVersion by index) and the
+// PersistentDoublyLinkedList interface (push_front, push_back), plus positional
+// insert/erase, concatenation and slicing, all O(log n) per new version.
+template <typename T>
+class PersistentSequence
+{
+private:
+    std::vector<RRBVector<T>> versions{}; // All versions will be stored here
+
+    int current_version{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    MemoryCounters memory{ sharedAllocationBytes<RRB_node<T>>() }; // Element, child and size arrays are counted separately
+
+    // Method to record the last stored version in the memory counters
+    void countVersion()
+    {
+        const RRBVector<T>& version = versions.back();
+        version.forEachUniqueNode([&](const RRB_node<T>& node)
+        {
+            size_t arrays = node.height == 0 ? (node.values.empty() ? 0 : 1) : 2;
+            memory.addNodes(1);
+            memory.addAllocations(arrays, node.values.capacity() * sizeof(T) +
+                node.children.capacity() * sizeof(typename RRBVector<T>::NodePtr) + node.sizes.capacity() * sizeof(size_t));
+        });
+        memory.pushVersion(version.nodeCount());
+    }
+
+    void checkRoot(int root_position) const
+    {
+        if (current_version < 0 || static_cast<size_t>(current_version) >= versions.size() ||
+            root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+    }
+
+    void pushVersion(RRBVector<T> version)
+    {
+        versions.push_back(std::move(version)); // Store the new version
+        current_version++;
+        countVersion();
+    }
+
+public:
+    // Constructor, accepts an array and its size
+    PersistentSequence(T* arr, int size)
+    {
+        if (size < 0)
+        {
+            throw std::invalid_argument("Size must not be negative.");
+        }
+        versions.push_back(RRBVector<T>(arr, arr + size)); // Store the base version
+        countVersion();
+    }
+
+    // Constructor from the first size elements of a vector
+    PersistentSequence(const std::vector<T>& vec, int size)
+    {
+        if (size < 0 || static_cast<size_t>(size) > vec.size())
+        {
+            throw std::invalid_argument("Size must be between 0 and the vector size.");
+        }
+        versions.push_back(RRBVector<T>(vec.begin(), vec.begin() + size)); // Store the base version
+        countVersion();
+    }
+
+    // Constructor that builds the base version from an iterator range without an intermediate vector
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentSequence(InputIt first, InputIt last)
+    {
+        versions.push_back(RRBVector<T>(first, last)); // Store the base version
+        countVersion();
+    }
+
+    // Constructor sharing an existing sequence as the base version, O(1)
+    explicit PersistentSequence(const RRBVector<T>& base)
+    {
+        versions.push_back(base);
+        countVersion(); // The nodes are shared with base and not counted as allocated here
+    }
+
+    // Method to add a new version with one element replaced
+    void addVersion(int root_position, int change_index, T new_value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        checkRoot(root_position);
+        if (change_index < 0 || static_cast<size_t>(change_index) >= versions[root_position].size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+        pushVersion(versions[root_position].set(change_index, std::move(new_value)));
+    }
+
+    // Method to add a new version with a value inserted before position index
+    void insertVersion(int root_position, int index, T value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::AddVersion);
+        checkRoot(root_position);
+        if (index < 0 || static_cast<size_t>(index) > versions[root_position].size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        pushVersion(versions[root_position].insert(index, std::move(value)));
+    }
+
+    // Method to add a new version with the element at position index removed
+    void eraseVersion(int root_position, int index)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::EraseVersion);
+        checkRoot(root_position);
+        if (index < 0 || static_cast<size_t>(index) >= versions[root_position].size())
+        {
+            throw std::out_of_range("Invalid element index");
+        }
+        pushVersion(versions[root_position].erase(index));
+    }
+
+    // Method to add a new version that is the concatenation of two versions
+    void concatVersions(int left_position, int right_position)
+    {
+        checkRoot(left_position);
+        checkRoot(right_position);
+        pushVersion(RRBVector<T>::concat(versions[left_position], versions[right_position]));
+    }
+
+    // Method to add a new version holding elements [first, last) of a version
+    void sliceVersion(int root_position, int first, int last)
+    {
+        checkRoot(root_position);
+        if (first < 0 || last < first || static_cast<size_t>(last) > versions[root_position].size())
+        {
+            throw std::out_of_range("Invalid slice bounds");
+        }
+        pushVersion(versions[root_position].slice(first, last));
+    }
+
+    // Method to add a new element to the front of the latest version
+    void push_front(T value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Push);
+        pushVersion(versions.back().push_front(std::move(value)));
+    }
+
+    // Method to add a new element to the end of the latest version
+    void push_back(T value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Push);
+        pushVersion(versions.back().push_back(std::move(value)));
+    }
+
+    // Method to undo the last action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+        countVersion();
+    }
+
+    // Method to redo an action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;
+        versions.push_back(versions[current_version]);
+        countVersion();
+    }
+
+    const T& at(size_t idx, size_t index) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        return getSequence(idx).at(index);
+    }
+
+    size_t size(size_t idx) const
+    {
+        return getSequence(idx).size();
+    }
+
+    // Read-only view of one version: the tree of a version is immutable and shared,
+    // so a copy can be read on another thread while new versions are added
+    using Snapshot = RRBVector<T>;
+
+    // Snapshot of a version, O(1)
+    Snapshot snapshot(size_t idx) const
+    {
+        return getSequence(idx);
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+
+    // Memory and sharing statistics, O(1); the version part describes what idx allocated itself
+    MemoryStats memoryStats(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return memory.stats(idx);
+    }
+
+    // The immutable sequence of a version; shares all nodes with the container
+    const RRBVector<T>& getSequence(size_t idx) const
+    {
+        if (idx < versions.size())
+        {
+            return versions[idx];
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+
+    // Method to print all versions
+    void printAllVersions()
+    {
+        for (size_t i = 0; i < versions.size(); i++)
+        {
+            std::cout << "Version [" << i << "]: \t{";
+            size_t printed = 0;
+            versions[i].forEach([&](const T& value)
+            {
+                std::cout << value;
+                if (++printed < versions[i].size())
+                {
+                    std::cout << ", ";
+                }
+            });
+            std::cout << "}\n";
+        }
+    }
+
+    std::vector<T> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        return getSequence(idx).toVector();
+    }
+};
+
+#endif // PERSISTENT_SEQUENCE_H
@@ -0,0 +1,338 @@
+#ifndef PERSISTENT_SHARDED_H
+#define PERSISTENT_SHARDED_H
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_associative_array.h"
+#include "persistent_storage.h"
+
+// Associative array split by key hash into independent persistent trees (shards).
+// Every shard has its own versions and its own lock, so writers on different shards run in
+// parallel; a write becomes a new version of its shard only. A global version is the list of
+// shard versions that belong together: commit() records the latest version of every shard
+// under all shard locks, so a global version is an atomic cut through concurrent writes.
+// Undo and redo move between global versions; writes that were not committed are dropped.
+template <typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>>
+class PersistentShardedAssociativeArray
+{
+public:
+    using Shard = PersistentAssociativeArray<KeyType, ValueType>;
+    using Composite = std::vector<size_t>; // Version of every shard, in shard order
+
+    // Read-only view of a global version: a snapshot of every shard, each sharing the nodes
+    // of its shard version. It can be read on any thread while writers continue.
+    class Snapshot
+    {
+    public:
+        ValueType find(const KeyType& key) const
+        {
+            return shards[Hash{}(key) % shards.size()].find(key);
+        }
+
+        bool contains(const KeyType& key) const
+        {
+            try
+            {
+                find(key);
+                return true;
+            }
+            catch (const std::runtime_error&)
+            {
+                return false;
+            }
+        }
+
+        size_t size() const
+        {
+            size_t total = 0;
+            for (const auto& shard : shards)
+            {
+                total += shard.size();
+            }
+            return total;
+        }
+
+        // Method to call f(key, value) for every key; in key order within a shard, shard after shard
+        template <typename F>
+        void forEach(F f) const
+        {
+            for (const auto& shard : shards)
+            {
+                shard.forEach(f);
+            }
+        }
+
+        const typename Shard::Snapshot& shard(size_t shard_index) const
+        {
+            return shards.at(shard_index);
+        }
+
+    private:
+        friend class PersistentShardedAssociativeArray;
+
+        std::vector<typename Shard::Snapshot> shards{};
+    };
+
+    // Constructor of shard_count empty shards; global version 0 has no keys
+    explicit PersistentShardedAssociativeArray(size_t shard_count)
+    {
+        build(std::vector<std::vector<std::pair<KeyType, ValueType>>>(shard_count));
+    }
+
+    // Constructor from an iterator range of key/value pairs, distributed over shard_count shards
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentShardedAssociativeArray(size_t shard_count, InputIt first, InputIt last)
+    {
+        std::vector<std::vector<std::pair<KeyType, ValueType>>> parts(shard_count);
+        for (; shard_count > 0 && first != last; ++first)
+        {
+            parts[Hash{}(first->first) % shard_count].emplace_back(first->first, first->second);
+        }
+        build(std::move(parts));
+    }
+
+    PersistentShardedAssociativeArray(const PersistentShardedAssociativeArray&) = delete;
+    PersistentShardedAssociativeArray& operator=(const PersistentShardedAssociativeArray&) = delete;
+
+    // Function to set the value of a key in its shard; safe to call from several threads
+    void insert(const KeyType& key, ValueType value)
+    {
+        ShardState& shard = *shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.tree.addVersion(static_cast<int>(shard.head), key, std::move(value));
+        shard.head = shard.tree.versionCount() - 1;
+    }
+
+    // Function to remove a key from its shard; throws if the key is not present
+    void erase(const KeyType& key)
+    {
+        ShardState& shard = *shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.tree.eraseVersion(static_cast<int>(shard.head), key);
+        shard.head = shard.tree.versionCount() - 1;
+    }
+
+    // Method to record the current state of all shards as a new global version; returns its index
+    size_t commit()
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockShards();
+        Composite composite(shards.size());
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            composite[i] = shards[i]->head;
+        }
+
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        versions.push_back(std::move(composite));
+        current_version = static_cast<int>(versions.size()) - 1;
+        return versions.size() - 1;
+    }
+
+    // Method to make UNDO action: the shards continue from the previous global version
+    void undo()
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockShards();
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+        resetHeads(versions.back());
+    }
+
+    // Method to make REDO action
+    void redo()
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockShards();
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;  // Move to the next version
+        versions.push_back(versions[current_version]);
+        resetHeads(versions.back());
+    }
+
+    // Snapshot of a global version
+    Snapshot snapshot(size_t idx) const
+    {
+        Composite composite = version(idx);
+        Snapshot result;
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            std::lock_guard<std::mutex> lock(shards[i]->mutex);
+            result.shards.push_back(shards[i]->tree.snapshot(composite[i]));
+        }
+        return result;
+    }
+
+    // Snapshot of the current state of all shards, including writes that are not committed yet
+    Snapshot snapshotLatest() const
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockShards();
+        Snapshot result;
+        for (const auto& shard : shards)
+        {
+            result.shards.push_back(shard->tree.snapshot(shard->head));
+        }
+        return result;
+    }
+
+    // Shard versions of a global version
+    Composite version(size_t idx) const
+    {
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return versions[idx];
+    }
+
+    // Function to find the value of a key in the given global version
+    ValueType find(size_t idx, const KeyType& key) const
+    {
+        size_t shard_index = shardOf(key);
+        size_t shard_version = version(idx)[shard_index];
+        std::lock_guard<std::mutex> lock(shards[shard_index]->mutex);
+        return shards[shard_index]->tree.find(shard_version, key);
+    }
+
+    // Number of keys in a global version
+    size_t size(size_t idx) const
+    {
+        return snapshot(idx).size();
+    }
+
+    // Values of a global version in key order, like PersistentAssociativeArray::getVersion
+    std::vector<ValueType> getVersion(size_t idx) const
+    {
+        std::vector<ValueType> result;
+        for (auto& pair : sortedPairs(idx))
+        {
+            result.push_back(std::move(pair.second));
+        }
+        return result;
+    }
+
+    // Keys of a global version in the same order as the values returned by getVersion
+    std::vector<KeyType> getKeys(size_t idx) const
+    {
+        std::vector<KeyType> result;
+        for (auto& pair : sortedPairs(idx))
+        {
+            result.push_back(std::move(pair.first));
+        }
+        return result;
+    }
+
+    // Number of global versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        return versions.size();
+    }
+
+    size_t shardCount() const
+    {
+        return shards.size();
+    }
+
+    // Shard that holds a key
+    size_t shardOf(const KeyType& key) const
+    {
+        return Hash{}(key) % shards.size();
+    }
+
+    // Function to print all global versions
+    void printAllVersions() const
+    {
+        for (size_t i = 0; i < versionCount(); ++i)
+        {
+            std::cout << "Version [" << i << "]\t{";
+            std::vector<std::pair<KeyType, ValueType>> pairs = sortedPairs(i);
+            for (size_t j = 0; j < pairs.size(); ++j)
+            {
+                std::cout << (j ? ", " : "") << pairs[j].first << ": " << pairs[j].second;
+            }
+            std::cout << "}" << std::endl;
+        }
+    }
+
+private:
+    struct ShardState
+    {
+        Shard tree;
+        size_t head{}; // Shard version the next write derives from
+        mutable std::mutex mutex;
+
+        ShardState() = default;
+
+        template <typename InputIt>
+        ShardState(InputIt first, InputIt last) : tree(first, last) {}
+    };
+
+    std::vector<std::unique_ptr<ShardState>> shards{};
+    std::vector<Composite> versions{};
+    int current_version{};
+    mutable std::mutex versions_mutex; // Taken after the shard locks
+
+    // Method to create one shard per part, each with its pairs as version 0
+    void build(std::vector<std::vector<std::pair<KeyType, ValueType>>> parts)
+    {
+        if (parts.empty())
+        {
+            throw std::invalid_argument("Shard count must be non-zero.");
+        }
+
+        for (auto& part : parts)
+        {
+            shards.push_back(part.empty() ? std::make_unique<ShardState>() : std::make_unique<ShardState>(part.begin(), part.end()));
+        }
+        versions.push_back(Composite(parts.size(), 0));
+        current_version = 0;
+    }
+
+    // Shard locks are always taken in shard order, so writers that lock all shards cannot deadlock
+    std::vector<std::unique_lock<std::mutex>> lockShards() const
+    {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        for (const auto& shard : shards)
+        {
+            locks.emplace_back(shard->mutex);
+        }
+        return locks;
+    }
+
+    void resetHeads(const Composite& composite)
+    {
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            shards[i]->head = composite[i];
+        }
+    }
+
+    std::vector<std::pair<KeyType, ValueType>> sortedPairs(size_t idx) const
+    {
+        std::vector<std::pair<KeyType, ValueType>> pairs;
+        snapshot(idx).forEach([&](const KeyType& key, const ValueType& value) { pairs.emplace_back(key, value); });
+        std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        return pairs;
+    }
+};
+
+#endif // PERSISTENT_SHARDED_H
@@ -0,0 +1,472 @@
+#ifndef PERSISTENT_SIMD_H
+#define PERSISTENT_SIMD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized bulk kernels over contiguous buffers of int and double.
+// The instruction set is chosen at runtime: AVX2, SSE4.1 or the scalar loop.
+// SIMD paths are only compiled with GCC/Clang on x86; other targets use the scalar loops.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PERSISTENT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+enum class SimdLevel
+{
+    Scalar,
+    SSE41,
+    AVX2
+};
+
+// Detected once per process
+inline SimdLevel simdLevel()
+{
+#ifdef PERSISTENT_SIMD_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2
+        : __builtin_cpu_supports("sse4.1") ? SimdLevel::SSE41
+        : SimdLevel::Scalar;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+namespace simd_detail
+{
+    // Scalar kernels, also used for the tails of the vector loops
+
+    template <typename T, typename Sum>
+    Sum sumScalar(const T* data, size_t size, Sum sum)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    template <typename T>
+    T minScalar(const T* data, size_t size, T result)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            result = std::min(result, data[i]);
+        }
+        return result;
+    }
+
+    template <typename T>
+    T maxScalar(const T* data, size_t size, T result)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            result = std::max(result, data[i]);
+        }
+        return result;
+    }
+
+    template <typename T>
+    void scaleScalar(const T* in, T* out, size_t size, T factor)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            out[i] = in[i] * factor;
+        }
+    }
+
+    template <typename T>
+    size_t countEqualScalar(const T* first, const T* second, size_t size)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            count += first[i] == second[i] ? 1 : 0;
+        }
+        return count;
+    }
+
+#ifdef PERSISTENT_SIMD_X86
+
+    // AVX2, 8 ints or 4 doubles per instruction
+
+    __attribute__((target("avx2"))) inline long long sumAvx2(const int* data, size_t size)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        alignas(32) long long lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return sumScalar(data + i, size - i, lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+
+    __attribute__((target("avx2"))) inline double sumAvx2(const double* data, size_t size)
+    {
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(data + i));
+            acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(data + i + 4));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_add_pd(acc0, acc1));
+        return sumScalar(data + i, size - i, (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+    }
+
+    __attribute__((target("avx2"))) inline int minAvx2(const int* data, size_t size)
+    {
+        __m256i acc = _mm256_set1_epi32(data[0]);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            acc = _mm256_min_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        }
+        alignas(32) int lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return minScalar(data + i, size - i, minScalar(lanes, 8, lanes[0]));
+    }
+
+    __attribute__((target("avx2"))) inline double minAvx2(const double* data, size_t size)
+    {
+        __m256d acc = _mm256_set1_pd(data[0]);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            acc = _mm256_min_pd(acc, _mm256_loadu_pd(data + i));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, acc);
+        return minScalar(data + i, size - i, minScalar(lanes, 4, lanes[0]));
+    }
+
+    __attribute__((target("avx2"))) inline int maxAvx2(const int* data, size_t size)
+    {
+        __m256i acc = _mm256_set1_epi32(data[0]);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            acc = _mm256_max_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        }
+        alignas(32) int lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return maxScalar(data + i, size - i, maxScalar(lanes, 8, lanes[0]));
+    }
+
+    __attribute__((target("avx2"))) inline double maxAvx2(const double* data, size_t size)
+    {
+        __m256d acc = _mm256_set1_pd(data[0]);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            acc = _mm256_max_pd(acc, _mm256_loadu_pd(data + i));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, acc);
+        return maxScalar(data + i, size - i, maxScalar(lanes, 4, lanes[0]));
+    }
+
+    __attribute__((target("avx2"))) inline void scaleAvx2(const int* in, int* out, size_t size, int factor)
+    {
+        __m256i f = _mm256_set1_epi32(factor);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(v, f));
+        }
+        scaleScalar(in + i, out + i, size - i, factor);
+    }
+
+    __attribute__((target("avx2"))) inline void scaleAvx2(const double* in, double* out, size_t size, double factor)
+    {
+        __m256d f = _mm256_set1_pd(factor);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(in + i), f));
+        }
+        scaleScalar(in + i, out + i, size - i, factor);
+    }
+
+    __attribute__((target("avx2"))) inline size_t countEqualAvx2(const int* first, const int* second, size_t size)
+    {
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(second + i));
+            count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))));
+        }
+        return count + countEqualScalar(first + i, second + i, size - i);
+    }
+
+    __attribute__((target("avx2"))) inline size_t countEqualAvx2(const double* first, const double* second, size_t size)
+    {
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m256d eq = _mm256_cmp_pd(_mm256_loadu_pd(first + i), _mm256_loadu_pd(second + i), _CMP_EQ_OQ);
+            count += __builtin_popcount(_mm256_movemask_pd(eq));
+        }
+        return count + countEqualScalar(first + i, second + i, size - i);
+    }
+
+    // SSE4.1, 4 ints or 2 doubles per instruction
+
+    __attribute__((target("sse4.1"))) inline long long sumSse41(const int* data, size_t size)
+    {
+        __m128i acc = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+            acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_unpackhi_epi64(v, v)));
+        }
+        alignas(16) long long lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        return sumScalar(data + i, size - i, lanes[0] + lanes[1]);
+    }
+
+    __attribute__((target("sse4.1"))) inline double sumSse41(const double* data, size_t size)
+    {
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            acc0 = _mm_add_pd(acc0, _mm_loadu_pd(data + i));
+            acc1 = _mm_add_pd(acc1, _mm_loadu_pd(data + i + 2));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, _mm_add_pd(acc0, acc1));
+        return sumScalar(data + i, size - i, lanes[0] + lanes[1]);
+    }
+
+    __attribute__((target("sse4.1"))) inline int minSse41(const int* data, size_t size)
+    {
+        __m128i acc = _mm_set1_epi32(data[0]);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            acc = _mm_min_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        }
+        alignas(16) int lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        return minScalar(data + i, size - i, minScalar(lanes, 4, lanes[0]));
+    }
+
+    __attribute__((target("sse4.1"))) inline double minSse41(const double* data, size_t size)
+    {
+        __m128d acc = _mm_set1_pd(data[0]);
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            acc = _mm_min_pd(acc, _mm_loadu_pd(data + i));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, acc);
+        return minScalar(data + i, size - i, std::min(lanes[0], lanes[1]));
+    }
+
+    __attribute__((target("sse4.1"))) inline int maxSse41(const int* data, size_t size)
+    {
+        __m128i acc = _mm_set1_epi32(data[0]);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            acc = _mm_max_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        }
+        alignas(16) int lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        return maxScalar(data + i, size - i, maxScalar(lanes, 4, lanes[0]));
+    }
+
+    __attribute__((target("sse4.1"))) inline double maxSse41(const double* data, size_t size)
+    {
+        __m128d acc = _mm_set1_pd(data[0]);
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            acc = _mm_max_pd(acc, _mm_loadu_pd(data + i));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, acc);
+        return maxScalar(data + i, size - i, std::max(lanes[0], lanes[1]));
+    }
+
+    __attribute__((target("sse4.1"))) inline void scaleSse41(const int* in, int* out, size_t size, int factor)
+    {
+        __m128i f = _mm_set1_epi32(factor);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_mullo_epi32(v, f));
+        }
+        scaleScalar(in + i, out + i, size - i, factor);
+    }
+
+    __attribute__((target("sse4.1"))) inline void scaleSse41(const double* in, double* out, size_t size, double factor)
+    {
+        __m128d f = _mm_set1_pd(factor);
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(in + i), f));
+        }
+        scaleScalar(in + i, out + i, size - i, factor);
+    }
+
+    __attribute__((target("sse4.1"))) inline size_t countEqualSse41(const int* first, const int* second, size_t size)
+    {
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + i));
+            count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))));
+        }
+        return count + countEqualScalar(first + i, second + i, size - i);
+    }
+
+    __attribute__((target("sse4.1"))) inline size_t countEqualSse41(const double* first, const double* second, size_t size)
+    {
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            count += __builtin_popcount(_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(first + i), _mm_loadu_pd(second + i))));
+        }
+        return count + countEqualScalar(first + i, second + i, size - i);
+    }
+
+#endif // PERSISTENT_SIMD_X86
+}
+
+// Type of the sum of a buffer; ints are summed in 64 bits
+template <typename T>
+struct SimdSumType
+{
+    using type = T;
+};
+
+template <>
+struct SimdSumType<int>
+{
+    using type = long long;
+};
+
+// Bulk kernels for one element type. The primary template is the scalar fallback
+// for any arithmetic type; int and double dispatch to the vector kernels.
+template <typename T>
+struct SimdKernels
+{
+    using SumType = typename SimdSumType<T>::type;
+
+    static SumType sum(const T* data, size_t size)
+    {
+        return simd_detail::sumScalar(data, size, SumType());
+    }
+
+    // min and max require size > 0
+    static T min(const T* data, size_t size)
+    {
+        return simd_detail::minScalar(data, size, data[0]);
+    }
+
+    static T max(const T* data, size_t size)
+    {
+        return simd_detail::maxScalar(data, size, data[0]);
+    }
+
+    static void scale(const T* in, T* out, size_t size, T factor)
+    {
+        simd_detail::scaleScalar(in, out, size, factor);
+    }
+
+    static size_t countEqual(const T* first, const T* second, size_t size)
+    {
+        return simd_detail::countEqualScalar(first, second, size);
+    }
+};
+
+#ifdef PERSISTENT_SIMD_X86
+
+// Shared dispatch for the vectorized element types
+template <typename T>
+struct DispatchedSimdKernels
+{
+    using SumType = typename SimdSumType<T>::type;
+
+    static SumType sum(const T* data, size_t size)
+    {
+        switch (simdLevel())
+        {
+        case SimdLevel::AVX2: return simd_detail::sumAvx2(data, size);
+        case SimdLevel::SSE41: return simd_detail::sumSse41(data, size);
+        default: return simd_detail::sumScalar(data, size, SumType());
+        }
+    }
+
+    static T min(const T* data, size_t size)
+    {
+        switch (simdLevel())
+        {
+        case SimdLevel::AVX2: return simd_detail::minAvx2(data, size);
+        case SimdLevel::SSE41: return simd_detail::minSse41(data, size);
+        default: return simd_detail::minScalar(data, size, data[0]);
+        }
+    }
+
+    static T max(const T* data, size_t size)
+    {
+        switch (simdLevel())
+        {
+        case SimdLevel::AVX2: return simd_detail::maxAvx2(data, size);
+        case SimdLevel::SSE41: return simd_detail::maxSse41(data, size);
+        default: return simd_detail::maxScalar(data, size, data[0]);
+        }
+    }
+
+    static void scale(const T* in, T* out, size_t size, T factor)
+    {
+        switch (simdLevel())
+        {
+        case SimdLevel::AVX2: simd_detail::scaleAvx2(in, out, size, factor); break;
+        case SimdLevel::SSE41: simd_detail::scaleSse41(in, out, size, factor); break;
+        default: simd_detail::scaleScalar(in, out, size, factor); break;
+        }
+    }
+
+    static size_t countEqual(const T* first, const T* second, size_t size)
+    {
+        switch (simdLevel())
+        {
+        case SimdLevel::AVX2: return simd_detail::countEqualAvx2(first, second, size);
+        case SimdLevel::SSE41: return simd_detail::countEqualSse41(first, second, size);
+        default: return simd_detail::countEqualScalar(first, second, size);
+        }
+    }
+};
+
+template <>
+struct SimdKernels<int> : DispatchedSimdKernels<int> {};
+
+template <>
+struct SimdKernels<double> : DispatchedSimdKernels<double> {};
+
+#endif // PERSISTENT_SIMD_X86
+
+#endif // PERSISTENT_SIMD_H
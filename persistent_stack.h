@@ -0,0 +1,254 @@
+#ifndef PERSISTENT_STACK_H
+#define PERSISTENT_STACK_H
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "persistent_latency.h"
+#include "persistent_storage.h"
+
+template <typename T>
+struct Stack_node
+{
+    T value;
+    mutable std::shared_ptr<const Stack_node<T>> next; // Node below, shared by every version that pushed on top of it; mutable only so that the destructor can unlink it
+
+    // Nodes below are released iteratively: releasing a long stack recursively would overflow the call stack
+    ~Stack_node()
+    {
+        std::shared_ptr<const Stack_node<T>> rest = std::move(next);
+        while (rest && rest.use_count() == 1)
+        {
+            rest = std::move(rest->next);
+        }
+    }
+};
+
+// Persistent LIFO stack: a version is its top node, and push and pop are O(1) because a new
+// version only adds a node on top of, or points below, the top of its source version.
+// push/pop work on the latest version, pushVersion/popVersion on any version.
+template <typename T>
+class PersistentStack
+{
+private:
+    std::vector<std::shared_ptr<const Stack_node<T>>> versions{}; // Top node of every version
+    std::vector<size_t> sizes{}; // Number of elements in every version
+
+    int current_version{};
+
+    mutable OperationLatencies latency{}; // Recorded by const methods too
+
+    void checkRoot(int root_position) const
+    {
+        if (root_position < 0 || static_cast<size_t>(root_position) >= versions.size())
+        {
+            throw std::out_of_range("Invalid root position");
+        }
+    }
+
+    // Method to store the elements of a range as version 0, the first element on top
+    template <typename InputIt>
+    void build(InputIt first, InputIt last)
+    {
+        std::shared_ptr<const Stack_node<T>> top;
+        std::shared_ptr<Stack_node<T>> bottom; // Still private to the constructor, so it can be linked in place
+        size_t size = 0;
+        for (; first != last; ++first, ++size)
+        {
+            auto node = std::make_shared<Stack_node<T>>(Stack_node<T>{ *first, nullptr });
+            if (bottom)
+            {
+                bottom->next = node;
+            }
+            else
+            {
+                top = node;
+            }
+            bottom = node;
+        }
+
+        versions.push_back(top);
+        sizes.push_back(size);
+        current_version = 0;
+    }
+
+public:
+    // Constructor of an empty stack
+    PersistentStack()
+    {
+        versions.push_back(nullptr);
+        sizes.push_back(0);
+        current_version = 0;
+    }
+
+    // Constructor, accepts an array and its size; the first element is the top
+    PersistentStack(T* arr, int size)
+    {
+        if (size < 0)
+        {
+            throw std::invalid_argument("Size must not be negative.");
+        }
+        build(arr, arr + size);
+    }
+
+    // Constructor from the first size elements of a vector
+    PersistentStack(const std::vector<T>& vec, int size)
+    {
+        if (size < 0 || static_cast<size_t>(size) > vec.size())
+        {
+            throw std::invalid_argument("Size must be between 0 and the vector size.");
+        }
+        build(vec.begin(), vec.begin() + size);
+    }
+
+    // Constructor from an iterator range; the first element is the top
+    template <typename InputIt, typename = RequireInputIterator<InputIt>>
+    PersistentStack(InputIt first, InputIt last)
+    {
+        build(first, last);
+    }
+
+    // Method to add a new version with value pushed on top of the version at root_position
+    void pushVersion(int root_position, T value)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Push);
+        checkRoot(root_position);
+        versions.push_back(std::make_shared<const Stack_node<T>>(Stack_node<T>{ std::move(value), versions[root_position] }));
+        sizes.push_back(sizes[root_position] + 1);
+        current_version++;
+    }
+
+    // Method to add a new version with the top of the version at root_position removed
+    void popVersion(int root_position)
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::EraseVersion);
+        checkRoot(root_position);
+        if (!versions[root_position])
+        {
+            throw std::out_of_range("Stack is empty");
+        }
+        versions.push_back(versions[root_position]->next);
+        sizes.push_back(sizes[root_position] - 1);
+        current_version++;
+    }
+
+    // Method to push on the latest version
+    void push(T value)
+    {
+        pushVersion(static_cast<int>(versions.size()) - 1, std::move(value));
+    }
+
+    // Method to pop from the latest version
+    void pop()
+    {
+        popVersion(static_cast<int>(versions.size()) - 1);
+    }
+
+    // Top element of a version
+    const T& top(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Lookup);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        if (!versions[idx])
+        {
+            throw std::out_of_range("Stack is empty");
+        }
+        return versions[idx]->value;
+    }
+
+    size_t size(size_t idx) const
+    {
+        if (idx < versions.size())
+        {
+            return sizes[idx];
+        }
+        throw std::out_of_range("Invalid version index");
+    }
+
+    bool empty(size_t idx) const
+    {
+        return size(idx) == 0;
+    }
+
+    // Method to make UNDO action
+    void undo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Undo);
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+    }
+
+    // Method to make REDO action
+    void redo()
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::Redo);
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;  // Move to the next version
+        versions.push_back(versions[current_version]);
+        sizes.push_back(sizes[current_version]);
+    }
+
+    // Elements of a version from the top down
+    std::vector<T> getVersion(size_t idx) const
+    {
+        PERSISTENT_TIME_OPERATION(latency, LatencyOp::GetVersion);
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+
+        std::vector<T> result;
+        result.reserve(sizes[idx]);
+        for (const Stack_node<T>* node = versions[idx].get(); node; node = node->next.get())
+        {
+            result.push_back(node->value);
+        }
+        return result;
+    }
+
+    // Method to print all versions, top first
+    void printAllVersions() const
+    {
+        for (size_t i = 0; i < versions.size(); i++)
+        {
+            std::cout << "Version [" << i << "]: \t{";
+            for (const Stack_node<T>* node = versions[i].get(); node; node = node->next.get())
+            {
+                std::cout << node->value << (node->next ? ", " : "");
+            }
+            std::cout << "}\n";
+        }
+    }
+
+    // Number of stored versions; the latest one is versionCount() - 1
+    size_t versionCount() const
+    {
+        return versions.size();
+    }
+
+    // Per-operation latency histograms; empty unless built with PERSISTENT_INSTRUMENTATION
+    OperationLatencies& latencies() const
+    {
+        return latency;
+    }
+};
+
+#endif // PERSISTENT_STACK_H
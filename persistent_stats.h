@@ -0,0 +1,104 @@
+#ifndef PERSISTENT_STATS_H
+#define PERSISTENT_STATS_H
+
+#include <vector>
+
+// Memory accounting of a persistent container.
+// Counters are updated when a version is created, so a snapshot costs O(1)
+// and can be exported periodically. Sizes are shallow: heap memory owned by
+// the stored values themselves (e.g. string contents) is not included.
+struct MemoryStats
+{
+    size_t version_count{};
+    size_t node_count{}; // Nodes allocated by all versions
+    size_t node_references{}; // Sum over all versions of the nodes reachable from the version
+    size_t allocation_count{}; // Heap allocations: nodes plus per-version spines
+    size_t total_bytes{}; // Bytes of all allocations
+    size_t version_nodes{}; // Nodes allocated when the requested version was created
+    size_t version_unique_bytes{}; // Bytes allocated when the requested version was created
+    size_t table_bytes{}; // Current size of side tables such as the hash-consing table, included in total_bytes
+    double shared_node_ratio{}; // 1 - node_count / node_references: share of references that reuse another version's node
+};
+
+// Bytes of one std::make_shared allocation: the object plus the control block (vtable pointer and two counters)
+template <typename Node>
+constexpr size_t sharedAllocationBytes()
+{
+    return sizeof(Node) + sizeof(void*) + 2 * sizeof(int);
+}
+
+// Incremental counters kept by every container.
+// Nodes allocated while a version is built are counted with addNodes and
+// attributed to that version by pushVersion.
+class MemoryCounters
+{
+public:
+    explicit MemoryCounters(size_t node_bytes) : node_bytes(node_bytes) {}
+
+    // Method to count nodes allocated for the version being built; separate_blocks of them
+    // were allocated with new and own a separate control block, which also holds the node pointer
+    void addNodes(size_t count, size_t separate_blocks = 0)
+    {
+        pending_nodes += count;
+        pending_blocks += separate_blocks;
+    }
+
+    // Method to count allocations of varying size made for the version being built,
+    // such as the element and child arrays of its nodes
+    void addAllocations(size_t count, size_t bytes)
+    {
+        pending_allocations += count;
+        pending_bytes += bytes;
+    }
+
+    // Method to close the version being built; spines are per-version allocations holding node pointers
+    void pushVersion(size_t reachable_nodes, size_t spine_allocations = 0, size_t spine_bytes = 0)
+    {
+        size_t bytes = pending_nodes * node_bytes + pending_blocks * sizeof(void*) + pending_bytes + spine_bytes;
+        deltas.push_back(Delta{ pending_nodes, bytes, reachable_nodes });
+
+        node_count += pending_nodes;
+        node_references += reachable_nodes;
+        allocation_count += pending_nodes + pending_blocks + pending_allocations + spine_allocations;
+        total_bytes += bytes;
+        pending_nodes = 0;
+        pending_blocks = 0;
+        pending_allocations = 0;
+        pending_bytes = 0;
+    }
+
+    MemoryStats stats(size_t version) const
+    {
+        MemoryStats result;
+        result.version_count = deltas.size();
+        result.node_count = node_count;
+        result.node_references = node_references;
+        result.allocation_count = allocation_count;
+        result.total_bytes = total_bytes;
+        result.version_nodes = deltas[version].nodes;
+        result.version_unique_bytes = deltas[version].bytes;
+        result.shared_node_ratio = node_references == 0 ? 0.0 : 1.0 - double(node_count) / double(node_references);
+        return result;
+    }
+
+private:
+    struct Delta
+    {
+        size_t nodes;
+        size_t bytes;
+        size_t reachable;
+    };
+
+    size_t node_bytes;
+    size_t pending_nodes{};
+    size_t pending_blocks{};
+    size_t pending_allocations{};
+    size_t pending_bytes{};
+    size_t node_count{};
+    size_t node_references{};
+    size_t allocation_count{};
+    size_t total_bytes{};
+    std::vector<Delta> deltas{};
+};
+
+#endif // PERSISTENT_STATS_H
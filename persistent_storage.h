@@ -0,0 +1,154 @@
+#ifndef PERSISTENT_STORAGE_H
+#define PERSISTENT_STORAGE_H
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Element storage chosen at compile time.
+// Small trivially copyable values are stored unboxed, directly in the version vectors,
+// and copied in bulk with memcpy; copying a version is then a single memcpy of
+// the values instead of one reference count increment per element.
+// Other types, and values larger than two shared pointers (every new version
+// copies the whole vector, so large values would make that copy more expensive
+// than copying pointers), are boxed in shared_ptr and shared between versions.
+// bool is boxed as well: std::vector<bool> is bit-packed, with no data() and proxy references.
+template <typename T>
+struct ElementStorage
+{
+    static constexpr bool unboxed = std::is_trivially_copyable<T>::value && !std::is_same<T, bool>::value &&
+        sizeof(T) <= 2 * sizeof(std::shared_ptr<T>);
+
+    using Slot = typename std::conditional<unboxed, T, std::shared_ptr<T>>::type;
+
+    static Slot make(const T& value)
+    {
+        if constexpr (unboxed)
+        {
+            return value;
+        }
+        else
+        {
+            return std::make_shared<T>(value);
+        }
+    }
+
+    // Slot with a value constructed in place from args; boxed values are never copied or moved
+    template <typename... Args>
+    static Slot emplace(Args&&... args)
+    {
+        if constexpr (unboxed)
+        {
+            return T(std::forward<Args>(args)...);
+        }
+        else
+        {
+            return std::make_shared<T>(std::forward<Args>(args)...);
+        }
+    }
+
+    static const T& get(const Slot& slot)
+    {
+        if constexpr (unboxed)
+        {
+            return slot;
+        }
+        else
+        {
+            return *slot;
+        }
+    }
+
+    // Address of the stored value, used when printing versions
+    static const void* address(const Slot& slot)
+    {
+        return &get(slot);
+    }
+
+    // Method to fill slots with count contiguous values
+    static void assign(std::vector<Slot>& slots, const T* values, size_t count)
+    {
+        if constexpr (unboxed)
+        {
+            slots.resize(count);
+            if (count > 0)
+            {
+                std::memcpy(slots.data(), values, count * sizeof(T));
+            }
+        }
+        else
+        {
+            slots.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                slots.push_back(make(values[i]));
+            }
+        }
+    }
+
+    // Method to fill slots with count contiguous values that may be moved from
+    static void assignMoving(std::vector<Slot>& slots, T* values, size_t count)
+    {
+        if constexpr (unboxed)
+        {
+            assign(slots, values, count);
+        }
+        else
+        {
+            slots.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                slots.push_back(std::make_shared<T>(std::move(values[i])));
+            }
+        }
+    }
+
+    // Method to copy the values of slots into a plain vector
+    static std::vector<T> values(const std::vector<Slot>& slots)
+    {
+        if constexpr (unboxed)
+        {
+            return slots;
+        }
+        else
+        {
+            std::vector<T> result;
+            result.reserve(slots.size());
+            for (const auto& slot : slots)
+            {
+                result.push_back(*slot);
+            }
+            return result;
+        }
+    }
+};
+
+// Enables the iterator range constructors of the containers for input iterators only,
+// so that (pointer, size) calls keep selecting the existing constructors
+template <typename It>
+using RequireInputIterator = typename std::enable_if<
+    std::is_convertible<typename std::iterator_traits<It>::iterator_category, std::input_iterator_tag>::value>::type;
+
+// Elements per RRB tree leaf: about 1 KB worth of trivially copyable values
+// (64 ints or doubles, 16 64-byte structs), never fewer than 8 or more than 64.
+// Small elements get wide leaves (cheap bulk copies, fewer nodes); large ones
+// narrow leaves, so that copying a leaf on an update stays cheap.
+// Leaves of other types keep the inner branching factor.
+template <typename T>
+constexpr size_t leafCapacity(size_t branching)
+{
+    if constexpr (std::is_trivially_copyable<T>::value)
+    {
+        return std::max<size_t>(8, std::min<size_t>(64, 1024 / sizeof(T)));
+    }
+    else
+    {
+        return branching;
+    }
+}
+
+#endif // PERSISTENT_STORAGE_H
@@ -0,0 +1,514 @@
+#ifndef PERSISTENT_TRACE_H
+#define PERSISTENT_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "persistent_array.h"
+#include "persistent_doubly_linked_list.h"
+#include "persistent_associative_array.h"
+#include "persistent_btree.h"
+#include "persistent_latency.h"
+#include "persistent_sequence.h"
+
+// Workload traces: the shape of a sequence of container operations without the data.
+// A trace keeps the operation, the version it was applied to and the element index
+// (or a dense id in place of a key), never a value, so it can be shared freely and
+// replayed against a synthetic container of the same size and kind.
+
+enum class TraceContainer : std::uint8_t
+{
+    Array = 1,
+    List = 2,
+    AssociativeArray = 3,
+    Sequence = 4,
+    BTree = 5
+};
+
+enum class TraceOp : std::uint8_t
+{
+    AddVersion = 1, // version, index or key id
+    Insert = 2, // version, index
+    Erase = 3, // version, index or key id
+    PushFront = 4,
+    PushBack = 5,
+    GetVersion = 6, // version
+    Undo = 7,
+    Redo = 8,
+    Convert = 9 // version, target TraceContainer
+};
+
+struct TraceRecord
+{
+    TraceOp op{};
+    std::uint64_t version{};
+    std::uint64_t argument{};
+};
+
+// Kind of a container type and the type used to address its elements
+template <typename Container>
+struct TraceContainerKind;
+
+template <typename T, typename Aggregate>
+struct TraceContainerKind<PersistentArray<T, Aggregate>>
+{
+    static constexpr TraceContainer kind = TraceContainer::Array;
+    using key_type = size_t;
+};
+
+template <typename T>
+struct TraceContainerKind<PersistentDoublyLinkedList<T>>
+{
+    static constexpr TraceContainer kind = TraceContainer::List;
+    using key_type = size_t;
+};
+
+template <typename KeyType, typename ValueType, typename Aggregate>
+struct TraceContainerKind<PersistentAssociativeArray<KeyType, ValueType, Aggregate>>
+{
+    static constexpr TraceContainer kind = TraceContainer::AssociativeArray;
+    using key_type = KeyType;
+};
+
+template <typename T>
+struct TraceContainerKind<PersistentSequence<T>>
+{
+    static constexpr TraceContainer kind = TraceContainer::Sequence;
+    using key_type = size_t;
+};
+
+template <typename KeyType, typename ValueType>
+struct TraceContainerKind<PersistentBTreeAssociativeArray<KeyType, ValueType>>
+{
+    static constexpr TraceContainer kind = TraceContainer::BTree;
+    using key_type = KeyType;
+};
+
+// A recorded trace and its file format.
+// File layout: magic, [container:u8][base size:varint], then records of
+// [op:u8][version:varint][argument:varint], with unused fields left out.
+struct WorkloadTrace
+{
+    TraceContainer container{};
+    std::uint64_t base_size{}; // Elements (or keys) of the version the recording started from
+    std::vector<TraceRecord> records{};
+
+    static bool hasVersion(TraceOp op)
+    {
+        return op == TraceOp::AddVersion || op == TraceOp::Insert || op == TraceOp::Erase ||
+            op == TraceOp::GetVersion || op == TraceOp::Convert;
+    }
+
+    static bool hasArgument(TraceOp op)
+    {
+        return op == TraceOp::AddVersion || op == TraceOp::Insert || op == TraceOp::Erase || op == TraceOp::Convert;
+    }
+
+    void save(const std::string& path) const
+    {
+        std::vector<char> out(magic, magic + sizeof(magic));
+        out.push_back(static_cast<char>(container));
+        writeVarint(out, base_size);
+        for (const auto& record : records)
+        {
+            out.push_back(static_cast<char>(record.op));
+            if (hasVersion(record.op))
+            {
+                writeVarint(out, record.version);
+            }
+            if (hasArgument(record.op))
+            {
+                writeVarint(out, record.argument);
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.write(out.data(), out.size()))
+        {
+            throw std::runtime_error("Cannot write trace file: " + path);
+        }
+    }
+
+    static WorkloadTrace load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open trace file: " + path);
+        }
+        std::vector<char> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(data.data(), data.size());
+        if (data.size() < sizeof(magic) + 1 || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("Not a trace file: " + path);
+        }
+
+        const char* in = data.data() + sizeof(magic);
+        const char* end = data.data() + data.size();
+        WorkloadTrace trace;
+        trace.container = static_cast<TraceContainer>(*in++);
+        trace.base_size = readVarint(in, end);
+        while (in != end)
+        {
+            TraceRecord record;
+            record.op = static_cast<TraceOp>(*in++);
+            if (record.op < TraceOp::AddVersion || record.op > TraceOp::Convert)
+            {
+                throw std::runtime_error("Unexpected trace record");
+            }
+            if (hasVersion(record.op))
+            {
+                record.version = readVarint(in, end);
+            }
+            if (hasArgument(record.op))
+            {
+                record.argument = readVarint(in, end);
+            }
+            trace.records.push_back(record);
+        }
+        return trace;
+    }
+
+private:
+    static constexpr char magic[8] = { 'P', 'T', 'R', 'C', '0', '0', '0', '1' };
+
+    // LEB128: 7 bits per byte, high bit set on all but the last byte
+    static void writeVarint(std::vector<char>& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static std::uint64_t readVarint(const char*& in, const char* end)
+    {
+        std::uint64_t value = 0;
+        for (int shift = 0; in != end && shift < 64; shift += 7)
+        {
+            std::uint8_t byte = static_cast<std::uint8_t>(*in++);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("Trace record is truncated");
+    }
+};
+
+// Records the operations applied through it to a container.
+// Every method forwards to the container and is recorded once it succeeded.
+// Version numbers are stored relative to the latest version at the start of the recording,
+// which becomes version 0 of the replay; older versions are recorded as version 0.
+// Keys are replaced by dense ids: base keys get 0..n-1 in key order, new keys the next free id.
+template <typename Container>
+class TraceRecorder
+{
+private:
+    using Kind = TraceContainerKind<Container>;
+    using Key = typename Kind::key_type;
+    static constexpr bool keyed = Kind::kind == TraceContainer::AssociativeArray || Kind::kind == TraceContainer::BTree;
+
+    Container& container;
+    WorkloadTrace recorded{};
+    size_t first_version{};
+    std::map<Key, std::uint64_t> key_ids{};
+
+    std::uint64_t relative(int version) const
+    {
+        return version < 0 || static_cast<size_t>(version) < first_version ? 0 : version - first_version;
+    }
+
+    std::uint64_t argument(const Key& position)
+    {
+        if constexpr (keyed)
+        {
+            auto inserted = key_ids.insert({ position, key_ids.size() });
+            return inserted.first->second;
+        }
+        else
+        {
+            return static_cast<std::uint64_t>(position);
+        }
+    }
+
+    void record(TraceOp op, std::uint64_t version = 0, std::uint64_t value = 0)
+    {
+        recorded.records.push_back({ op, version, value });
+    }
+
+public:
+    explicit TraceRecorder(Container& container)
+        : container(container)
+    {
+        first_version = container.versionCount() - 1;
+        auto base = container.snapshot(first_version);
+        recorded.container = Kind::kind;
+        recorded.base_size = base.size();
+        if constexpr (keyed)
+        {
+            base.forEach([this](const Key& key, const auto&) { argument(key); });
+        }
+    }
+
+    const WorkloadTrace& trace() const
+    {
+        return recorded;
+    }
+
+    void save(const std::string& path) const
+    {
+        recorded.save(path);
+    }
+
+    template <typename Value>
+    void addVersion(int root_position, const Key& position, Value&& value)
+    {
+        container.addVersion(root_position, position, std::forward<Value>(value));
+        record(TraceOp::AddVersion, relative(root_position), argument(position));
+    }
+
+    template <typename Value>
+    void insertVersion(int root_position, int index, Value&& value)
+    {
+        container.insertVersion(root_position, index, std::forward<Value>(value));
+        record(TraceOp::Insert, relative(root_position), index);
+    }
+
+    void eraseVersion(int root_position, const Key& position)
+    {
+        container.eraseVersion(root_position, position);
+        record(TraceOp::Erase, relative(root_position), argument(position));
+    }
+
+    template <typename Value>
+    void push_front(Value&& value)
+    {
+        container.push_front(std::forward<Value>(value));
+        record(TraceOp::PushFront);
+    }
+
+    template <typename Value>
+    void push_back(Value&& value)
+    {
+        container.push_back(std::forward<Value>(value));
+        record(TraceOp::PushBack);
+    }
+
+    auto getVersion(size_t idx)
+    {
+        auto result = container.getVersion(idx);
+        record(TraceOp::GetVersion, relative(static_cast<int>(idx)));
+        return result;
+    }
+
+    void undo()
+    {
+        container.undo();
+        record(TraceOp::Undo);
+    }
+
+    void redo()
+    {
+        container.redo();
+        record(TraceOp::Redo);
+    }
+
+    // Method to run a conversion, e.g. [](const auto& a, size_t i) { return Convert<int>::convertArrayToList(a, i); }
+    template <typename F>
+    auto convert(size_t idx, F f)
+    {
+        auto result = f(static_cast<const Container&>(container), idx);
+        record(TraceOp::Convert, relative(static_cast<int>(idx)), static_cast<std::uint64_t>(TraceContainerKind<decltype(result)>::kind));
+        return result;
+    }
+};
+
+// Re-executes a trace on a synthetic container of long long values with the recorded kind and
+// base size (values 0..n-1, keys 0..n-1), timing every operation into latencies.
+// Conversions are replayed as materializing the version and building the target container.
+class TraceReplayer
+{
+public:
+    using Value = long long;
+
+    // Returns the number of replayed operations
+    static size_t replay(const WorkloadTrace& trace, LatencyRecorder& latencies)
+    {
+        std::vector<Value> values(trace.base_size);
+        std::vector<Value> keys(trace.base_size);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            values[i] = static_cast<Value>(i);
+            keys[i] = static_cast<Value>(i);
+        }
+
+        switch (trace.container)
+        {
+        case TraceContainer::Array:
+        {
+            PersistentArray<Value> container(values, static_cast<int>(values.size()));
+            return run(trace, container, latencies);
+        }
+        case TraceContainer::List:
+        {
+            PersistentDoublyLinkedList<Value> container(values, static_cast<int>(values.size()));
+            return run(trace, container, latencies);
+        }
+        case TraceContainer::AssociativeArray:
+        {
+            PersistentAssociativeArray<Value, Value> container(keys, values, values.size());
+            return run(trace, container, latencies);
+        }
+        case TraceContainer::Sequence:
+        {
+            PersistentSequence<Value> container(values, static_cast<int>(values.size()));
+            return run(trace, container, latencies);
+        }
+        case TraceContainer::BTree:
+        {
+            PersistentBTreeAssociativeArray<Value, Value> container(keys, values, values.size());
+            return run(trace, container, latencies);
+        }
+        }
+        throw std::runtime_error("Unexpected trace container");
+    }
+
+private:
+    template <typename Container>
+    static size_t run(const WorkloadTrace& trace, Container& container, LatencyRecorder& latencies)
+    {
+        constexpr TraceContainer kind = TraceContainerKind<Container>::kind;
+        Value next_value = 0;
+        for (const TraceRecord& record : trace.records)
+        {
+            int version = static_cast<int>(record.version);
+            switch (record.op)
+            {
+            case TraceOp::AddVersion:
+            {
+                LatencyTimer timer(latencies, LatencyOp::AddVersion);
+                if constexpr (kind != TraceContainer::List)
+                {
+                    container.addVersion(version, static_cast<typename TraceContainerKind<Container>::key_type>(record.argument), next_value++);
+                }
+                break;
+            }
+            case TraceOp::Insert:
+            {
+                LatencyTimer timer(latencies, LatencyOp::AddVersion);
+                if constexpr (kind == TraceContainer::Sequence)
+                {
+                    container.insertVersion(version, static_cast<int>(record.argument), next_value++);
+                }
+                break;
+            }
+            case TraceOp::Erase:
+            {
+                LatencyTimer timer(latencies, LatencyOp::EraseVersion);
+                if constexpr (kind == TraceContainer::AssociativeArray || kind == TraceContainer::BTree)
+                {
+                    container.eraseVersion(version, static_cast<Value>(record.argument));
+                }
+                else if constexpr (kind == TraceContainer::Sequence)
+                {
+                    container.eraseVersion(version, static_cast<int>(record.argument));
+                }
+                break;
+            }
+            case TraceOp::PushFront:
+            {
+                LatencyTimer timer(latencies, LatencyOp::Push);
+                if constexpr (kind == TraceContainer::List || kind == TraceContainer::Sequence)
+                {
+                    container.push_front(next_value++);
+                }
+                break;
+            }
+            case TraceOp::PushBack:
+            {
+                LatencyTimer timer(latencies, LatencyOp::Push);
+                if constexpr (kind == TraceContainer::List || kind == TraceContainer::Sequence)
+                {
+                    container.push_back(next_value++);
+                }
+                break;
+            }
+            case TraceOp::GetVersion:
+            {
+                LatencyTimer timer(latencies, LatencyOp::GetVersion);
+                container.getVersion(record.version);
+                break;
+            }
+            case TraceOp::Undo:
+            {
+                LatencyTimer timer(latencies, LatencyOp::Undo);
+                container.undo();
+                break;
+            }
+            case TraceOp::Redo:
+            {
+                LatencyTimer timer(latencies, LatencyOp::Redo);
+                container.redo();
+                break;
+            }
+            case TraceOp::Convert:
+            {
+                LatencyTimer timer(latencies, LatencyOp::Convert);
+                materialize(static_cast<TraceContainer>(record.argument), container.getVersion(record.version));
+                break;
+            }
+            }
+        }
+        return trace.records.size();
+    }
+
+    static void materialize(TraceContainer target, std::vector<Value> values)
+    {
+        std::vector<Value> keys(values.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = static_cast<Value>(i);
+        }
+        int size = static_cast<int>(values.size());
+
+        switch (target)
+        {
+        case TraceContainer::Array:
+            PersistentArray<Value>(std::move(values), size);
+            break;
+        case TraceContainer::List:
+            PersistentDoublyLinkedList<Value>(std::move(values), size);
+            break;
+        case TraceContainer::AssociativeArray:
+            if (size > 0)
+            {
+                PersistentAssociativeArray<Value, Value>(keys, std::move(values), keys.size());
+            }
+            break;
+        case TraceContainer::Sequence:
+            PersistentSequence<Value>(values, size);
+            break;
+        case TraceContainer::BTree:
+            if (size > 0)
+            {
+                PersistentBTreeAssociativeArray<Value, Value>(keys, values, keys.size());
+            }
+            break;
+        }
+    }
+};
+
+#endif // PERSISTENT_TRACE_H
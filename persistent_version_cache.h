@@ -0,0 +1,156 @@
+#ifndef PERSISTENT_VERSION_CACHE_H
+#define PERSISTENT_VERSION_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Bounded LRU cache of materialized versions of a container.
+// get(idx) returns the flat contents of a version (what getVersion returns) as a shared,
+// immutable vector; repeated calls for the same version return the same vector without
+// walking the container again. Versions never change, so entries are never invalidated,
+// only evicted, least recently used first, when the cached bytes exceed the capacity.
+// A returned view stays valid after its entry is evicted. get() may be called from
+// several threads; the container must outlive the cache.
+template <typename Container>
+class VersionCache
+{
+public:
+    using Value = typename decltype(std::declval<const Container&>().getVersion(0))::value_type;
+    using View = std::shared_ptr<const std::vector<Value>>;
+
+    VersionCache(const Container& container, size_t capacity_bytes)
+        : container(container), capacity(capacity_bytes) {}
+
+    VersionCache(const VersionCache&) = delete;
+    VersionCache& operator=(const VersionCache&) = delete;
+
+    // Contents of a version; materialized on a miss. Versions larger than the capacity are returned but not kept.
+    View get(size_t idx)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = entries.find(idx);
+            if (found != entries.end())
+            {
+                hit_count++;
+                order.splice(order.begin(), order, found->second.position); // Most recently used first
+                return found->second.view;
+            }
+            miss_count++;
+        }
+
+        // Materialize without holding the lock, so hits on other versions are not blocked
+        View view = std::make_shared<const std::vector<Value>>(container.getVersion(idx));
+        size_t size = bytesOf(*view);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(idx);
+        if (found != entries.end())
+        {
+            return found->second.view; // Another thread materialized it meanwhile
+        }
+        if (size > capacity)
+        {
+            return view;
+        }
+
+        order.push_front(idx);
+        entries.emplace(idx, Entry{ view, size, order.begin() });
+        cached_bytes += size;
+        evict();
+        return view;
+    }
+
+    // Method to change the capacity, evicting entries if the cache is now over it
+    void setCapacity(size_t capacity_bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = capacity_bytes;
+        evict();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        order.clear();
+        cached_bytes = 0;
+    }
+
+    std::uint64_t hits() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hit_count;
+    }
+
+    std::uint64_t misses() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return miss_count;
+    }
+
+    std::uint64_t evictions() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return eviction_count;
+    }
+
+    // Number of cached versions
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    // Estimated bytes held by the cached versions
+    size_t bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cached_bytes;
+    }
+
+    // Estimated footprint of a materialized version: the vector and its elements.
+    // Memory owned by the elements themselves (e.g. string contents) is not counted.
+    static size_t bytesOf(const std::vector<Value>& values)
+    {
+        return sizeof(values) + values.capacity() * sizeof(Value);
+    }
+
+private:
+    struct Entry
+    {
+        View view;
+        size_t size;
+        std::list<size_t>::iterator position; // Position in the LRU order
+    };
+
+    const Container& container;
+    size_t capacity;
+
+    mutable std::mutex mutex;
+    std::unordered_map<size_t, Entry> entries{};
+    std::list<size_t> order{}; // Version indices, most recently used first
+    size_t cached_bytes{};
+    std::uint64_t hit_count{};
+    std::uint64_t miss_count{};
+    std::uint64_t eviction_count{};
+
+    void evict()
+    {
+        while (cached_bytes > capacity && !order.empty())
+        {
+            auto found = entries.find(order.back());
+            cached_bytes -= found->second.size;
+            entries.erase(found);
+            order.pop_back();
+            eviction_count++;
+        }
+    }
+};
+
+#endif // PERSISTENT_VERSION_CACHE_H
@@ -0,0 +1,111 @@
+#ifndef PERSISTENT_VERSION_INDEX_H
+#define PERSISTENT_VERSION_INDEX_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tag and timestamp index over the versions of a container.
+// Every stored version is stamped with the wall-clock time it was created;
+// stamps never decrease (a clock step back reuses the previous stamp), so the
+// version that was current at a time is found by binary search, O(log V).
+// Tags are names for version indices kept in a hash table, O(1).
+// The index is a plain member, so copies of a container keep their tags and times.
+// Journals and exports store stamps as nanoseconds since the epoch, so replayed
+// versions keep the times they were first created at.
+class VersionIndex
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    // Method to stamp the version that was just stored
+    void stamp()
+    {
+        Clock::time_point now = Clock::now();
+        times.push_back(times.empty() ? now : std::max(now, times.back()));
+    }
+
+    // Method to replace the stamp of the latest version, e.g. with its time from a journal
+    void restamp(Clock::time_point time)
+    {
+        if (times.empty())
+        {
+            throw std::logic_error("No version to restamp");
+        }
+        times.back() = times.size() > 1 ? std::max(time, times[times.size() - 2]) : time;
+    }
+
+    void tag(const std::string& name, size_t version)
+    {
+        if (!tags.emplace(name, version).second)
+        {
+            throw std::invalid_argument("Tag already exists");
+        }
+    }
+
+    size_t byTag(const std::string& name) const
+    {
+        auto found = tags.find(name);
+        if (found == tags.end())
+        {
+            throw std::runtime_error("Tag not found");
+        }
+        return found->second;
+    }
+
+    // Latest version created at or before time
+    size_t asOf(Clock::time_point time) const
+    {
+        auto after = std::upper_bound(times.begin(), times.end(), time);
+        if (after == times.begin())
+        {
+            throw std::out_of_range("No version at that time");
+        }
+        return static_cast<size_t>(after - times.begin()) - 1;
+    }
+
+    Clock::time_point time(size_t version) const
+    {
+        return times[version];
+    }
+
+    Clock::time_point latest() const
+    {
+        return times.back();
+    }
+
+    // Tags naming a version in lexicographic order, O(number of tags)
+    std::vector<std::string> tagsOf(size_t version) const
+    {
+        std::vector<std::string> result;
+        for (const auto& entry : tags)
+        {
+            if (entry.second == version)
+            {
+                result.push_back(entry.first);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    static std::int64_t toNanoseconds(Clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    static Clock::time_point fromNanoseconds(std::int64_t nanoseconds)
+    {
+        return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(nanoseconds)));
+    }
+
+private:
+    std::vector<Clock::time_point> times{};
+    std::unordered_map<std::string, size_t> tags{};
+};
+
+#endif // PERSISTENT_VERSION_INDEX_H
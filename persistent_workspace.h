@@ -0,0 +1,172 @@
+#ifndef PERSISTENT_WORKSPACE_H
+#define PERSISTENT_WORKSPACE_H
+
+#include <array>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Group of persistent containers that are versioned together.
+// A composite version is the list of member versions that belong together. A commit starts
+// from the current composite version: members the edit added versions to are recorded at their
+// latest version, the others keep their version from the current composite, so a commit after
+// a global undo does not bring back the undone versions of members it did not edit.
+// Global undo/redo only move through the composite versions, so they are O(1) and never touch the members.
+// Readers see a consistent composite version: read() runs under a shared lock, commit()
+// and undo/redo under an exclusive one. While readers are active, members must only be
+// edited inside commit(). The members are not owned and must outlive the workspace.
+template <typename... Containers>
+class PersistentWorkspace
+{
+public:
+    static constexpr size_t member_count = sizeof...(Containers);
+    using Composite = std::array<size_t, member_count>; // Version of every member, in member order
+
+    // Version 0 groups the latest version of every member
+    explicit PersistentWorkspace(Containers&... containers)
+        : members(containers...)
+    {
+        versions.push_back(latestVersions());
+        current_version = 0;
+    }
+
+    PersistentWorkspace(const PersistentWorkspace&) = delete;
+    PersistentWorkspace& operator=(const PersistentWorkspace&) = delete;
+
+    // Method to apply edit(current, members...) and commit the result as one composite version; returns its index.
+    // current is the current composite version, the member versions edits should start from.
+    // If edit throws, no composite version is added.
+    template <typename F>
+    size_t commit(F edit)
+    {
+        std::unique_lock<std::shared_mutex> lock = writeLock();
+        const Composite current = versions[current_version];
+        Composite before = versionCounts();
+        std::apply([&](Containers&... containers) { edit(current, containers...); }, members);
+        Composite after = versionCounts();
+
+        Composite next = current;
+        for (size_t i = 0; i < member_count; ++i)
+        {
+            if (after[i] != before[i])
+            {
+                next[i] = after[i] - 1; // The member was edited: its latest version belongs to the commit
+            }
+        }
+        versions.push_back(next);
+        current_version = static_cast<int>(versions.size()) - 1;
+        return versions.size() - 1;
+    }
+
+    // Method to make UNDO action on all members at once
+    void undo()
+    {
+        std::unique_lock<std::shared_mutex> lock = writeLock();
+        if (current_version <= 0)
+        {
+            std::cout << "No actions to undo!" << std::endl;
+            return;
+        }
+
+        current_version--;
+        versions.push_back(versions[current_version]);
+    }
+
+    // Method to make REDO action on all members at once
+    void redo()
+    {
+        std::unique_lock<std::shared_mutex> lock = writeLock();
+        if (current_version >= static_cast<int>(versions.size()) - 1)
+        {
+            std::cout << "No actions to redo!" << std::endl;
+            return;
+        }
+
+        current_version++;  // Move to the next version
+        versions.push_back(versions[current_version]);
+    }
+
+    size_t versionCount() const
+    {
+        std::shared_lock<std::shared_mutex> lock = readLock();
+        return versions.size();
+    }
+
+    // Latest composite version
+    size_t latestVersion() const
+    {
+        std::shared_lock<std::shared_mutex> lock = readLock();
+        return versions.size() - 1;
+    }
+
+    // Member versions of a composite version
+    Composite version(size_t idx) const
+    {
+        std::shared_lock<std::shared_mutex> lock = readLock();
+        return checkedVersion(idx);
+    }
+
+    // Method to call f(composite, members...) with the member versions of a composite version.
+    // Any number of readers run concurrently; commits wait until they finish.
+    template <typename F>
+    decltype(auto) read(size_t idx, F f) const
+    {
+        std::shared_lock<std::shared_mutex> lock = readLock();
+        const Composite& composite = checkedVersion(idx);
+        return std::apply([&](const Containers&... containers) -> decltype(auto) { return f(composite, containers...); }, members);
+    }
+
+    // Method to read the latest composite version
+    template <typename F>
+    decltype(auto) readLatest(F f) const
+    {
+        std::shared_lock<std::shared_mutex> lock = readLock();
+        const Composite& composite = versions.back();
+        return std::apply([&](const Containers&... containers) -> decltype(auto) { return f(composite, containers...); }, members);
+    }
+
+private:
+    std::tuple<Containers&...> members;
+    std::vector<Composite> versions{};
+    int current_version{};
+
+    mutable std::shared_mutex mutex;
+    mutable std::mutex writer_gate; // Held by a waiting writer so that a stream of readers cannot starve it
+
+    std::shared_lock<std::shared_mutex> readLock() const
+    {
+        std::lock_guard<std::mutex> gate(writer_gate);
+        return std::shared_lock<std::shared_mutex>(mutex);
+    }
+
+    std::unique_lock<std::shared_mutex> writeLock()
+    {
+        std::lock_guard<std::mutex> gate(writer_gate);
+        return std::unique_lock<std::shared_mutex>(mutex);
+    }
+
+    Composite latestVersions() const
+    {
+        return std::apply([](const Containers&... containers) { return Composite{ { (containers.versionCount() - 1)... } }; }, members);
+    }
+
+    Composite versionCounts() const
+    {
+        return std::apply([](const Containers&... containers) { return Composite{ { containers.versionCount()... } }; }, members);
+    }
+
+    const Composite& checkedVersion(size_t idx) const
+    {
+        if (idx >= versions.size())
+        {
+            throw std::out_of_range("Invalid version index");
+        }
+        return versions[idx];
+    }
+};
+
+#endif // PERSISTENT_WORKSPACE_H
@@ -154,6 +154,18 @@ TEST_F(PersistentDoublyLinkedListTest, NoActionToRedo)
     EXPECT_EQ(output, "No actions to redo!\n");
 }
 
+TEST_F(PersistentDoublyLinkedListTest, PushBackKeepsOlderVersions) 
+{
+    list->push_back(6);
+    list->undo();
+    list->push_back(7); // The tail of version 2 is shared with version 1, which already has 6 after it
+    EXPECT_EQ(list->getVersion(0), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(list->getVersion(1), std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
+    EXPECT_EQ(list->getVersion(2), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(list->getVersion(3), std::vector<int>({ 1, 2, 3, 4, 5, 7 }));
+    EXPECT_EQ(list->snapshot(3).size(), 6u);
+}
+
 // Test fixture for PersistentAssociativeArray tests
 class PersistentAssociativeArrayTest : public ::testing::Test 
 {
@@ -178,6 +190,14 @@ TEST_F(PersistentAssociativeArrayTest, InitialVersion)
     EXPECT_EQ(array->getVersion(0), std::vector<std::string>({ "A", "B", "C" }));
 }
 
+TEST_F(PersistentAssociativeArrayTest, ConstructorSizeMismatch) 
+{
+    std::vector<int> keys = { 1, 2 };
+    std::vector<std::string> values = { "A", "B" };
+    EXPECT_THROW((PersistentAssociativeArray<int, std::string>(keys, values, 3)), std::invalid_argument);
+    EXPECT_THROW((PersistentAssociativeArray<int, std::string>(keys, std::move(values), 1)), std::invalid_argument);
+}
+
 TEST_F(PersistentAssociativeArrayTest, AddVersionSameKey) 
 {
     array->addVersion(0, 2, "D"); // Change the value with key 2 to "D"
@@ -233,6 +253,54 @@ TEST_F(PersistentAssociativeArrayTest, NoActionToRedo)
     EXPECT_EQ(output, "No actions to redo!\n");
 }
 
+TEST_F(PersistentAssociativeArrayTest, EraseVersion) 
+{
+    array->addVersion(0, 4, "D"); // Version[1]
+    array->eraseVersion(1, 2); // Version[2], node with two children
+    array->eraseVersion(2, 4); // Version[3], leaf
+    array->eraseVersion(3, 1); // Version[4], node with one child
+    EXPECT_EQ(array->getVersion(1), std::vector<std::string>({ "A", "B", "C", "D" }));
+    EXPECT_EQ(array->getVersion(2), std::vector<std::string>({ "A", "C", "D" }));
+    EXPECT_EQ(array->getVersion(3), std::vector<std::string>({ "A", "C" }));
+    EXPECT_EQ(array->getVersion(4), std::vector<std::string>({ "C" }));
+    EXPECT_EQ(array->getKeys(4), std::vector<int>({ 3 }));
+    EXPECT_EQ(array->size(1), 4u);
+    EXPECT_EQ(array->size(4), 1u);
+}
+
+TEST_F(PersistentAssociativeArrayTest, EraseToEmptyAndReinsert) 
+{
+    array->eraseVersion(0, 1);
+    array->eraseVersion(1, 2);
+    array->eraseVersion(2, 3);
+    EXPECT_EQ(array->size(3), 0u);
+    EXPECT_TRUE(array->getVersion(3).empty());
+    array->addVersion(3, 7, "G");
+    EXPECT_EQ(array->getVersion(4), std::vector<std::string>({ "G" }));
+    EXPECT_EQ(array->size(4), 1u);
+}
+
+TEST_F(PersistentAssociativeArrayTest, EraseMissingKey) 
+{
+    EXPECT_THROW(array->eraseVersion(0, 10), std::runtime_error);
+    EXPECT_THROW(array->eraseVersion(5, 1), std::out_of_range);
+    EXPECT_THROW(array->getVersion(1), std::out_of_range);
+}
+
+TEST_F(PersistentAssociativeArrayTest, PrintUsesKeysOfEachVersion) 
+{
+    array->eraseVersion(0, 2);
+    array->addVersion(1, 5, "E");
+    testing::internal::CaptureStdout();
+    array->printAllVersions();
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(output,
+        "Version [0]\t{'1': A, '2': B, '3': C}\n"
+        "Version [1]\t{'1': A, '3': C}\n"
+        "Version [2]\t{'1': A, '3': C, '5': E}\n");
+}
+
 // Test fixture for the Convert class tests
 class ConvertTest : public ::testing::Test 
 {
@@ -329,3 +397,2550 @@ TEST_F(ConvertTest, ConvertListToAssociativeArrayInvalidKeys)
     std::vector<int> keys = { 1, 2 }; 
     EXPECT_THROW(Convert<double>::convertListToAssociativeArray<int>(*list, keys, 0), std::invalid_argument);
 }
+
+// Test fixture for OperationJournal tests
+class OperationJournalTest : public ::testing::Test 
+{
+protected:
+    std::string path;
+
+    void SetUp() override 
+    {
+        path = testing::TempDir() + "persistent_journal_test.bin";
+    }
+
+    void TearDown() override 
+    {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(OperationJournalTest, ReplayArray) 
+{
+    int init_arr[] = { 1, 2, 3, 4, 5 };
+    PersistentArray<int> array(init_arr, 5);
+    {
+        OperationJournal journal(path, 2);
+        array.attachJournal(journal);
+        array.addVersion(0, 0, 10);
+        array.addVersion(1, 4, 50);
+        array.undo();
+        array.redo();
+    }
+
+    PersistentArray<int> restored = PersistentArray<int>::replayJournal(path);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(restored.getVersion(i), array.getVersion(i));
+    }
+    EXPECT_THROW(restored.getVersion(5), std::out_of_range);
+}
+
+TEST_F(OperationJournalTest, ReplayList) 
+{
+    int init_arr[] = { 1, 2, 3 };
+    PersistentDoublyLinkedList<int> list(init_arr, 3);
+    {
+        OperationJournal journal(path);
+        list.attachJournal(journal);
+        list.push_front(0);
+        list.push_back(4);
+    }
+
+    PersistentDoublyLinkedList<int> restored = PersistentDoublyLinkedList<int>::replayJournal(path);
+    EXPECT_EQ(restored.getVersion(2), std::vector<int>({ 0, 1, 2, 3, 4 }));
+}
+
+TEST_F(OperationJournalTest, ReplayListCursorCommit) 
+{
+    int init_arr[] = { 1, 2, 3, 4 };
+    PersistentDoublyLinkedList<int> list(init_arr, 4);
+    {
+        OperationJournal journal(path);
+        list.attachJournal(journal);
+        list.commit(list.cursor(0, 1).replace(20)); // {1, 20, 3, 4}
+        list.commit(list.cursor(1, 4).insert(5)); // {1, 20, 3, 4, 5}, nothing shared
+        list.commit(list.cursor(0, 0).erase()); // {2, 3, 4}, all shared
+    }
+
+    PersistentDoublyLinkedList<int> restored = PersistentDoublyLinkedList<int>::replayJournal(path);
+    ASSERT_EQ(restored.versionCount(), 4u);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(restored.getVersion(i), list.getVersion(i));
+    }
+    EXPECT_EQ(restored.getVersion(3), std::vector<int>({ 2, 3, 4 }));
+}
+
+TEST_F(OperationJournalTest, ReplayAssociativeArray) 
+{
+    std::vector<std::string> keys = { "b", "a", "c" };
+    std::string values[] = { "B", "A", "C" };
+    PersistentAssociativeArray<std::string, std::string> array(keys, values, 3);
+    {
+        OperationJournal journal(path);
+        array.attachJournal(journal);
+        array.addVersion(0, "d", "D");
+        array.addVersion(1, "a", "X");
+    }
+
+    auto restored = PersistentAssociativeArray<std::string, std::string>::replayJournal(path);
+    EXPECT_EQ(restored.getVersion(0), std::vector<std::string>({ "A", "B", "C" }));
+    EXPECT_EQ(restored.getVersion(2), std::vector<std::string>({ "X", "B", "C", "D" }));
+}
+
+TEST_F(OperationJournalTest, TornRecordIsIgnored) 
+{
+    int init_arr[] = { 1, 2, 3 };
+    PersistentArray<int> array(init_arr, 3);
+    {
+        OperationJournal journal(path);
+        array.attachJournal(journal);
+        array.addVersion(0, 1, 20);
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x02\x40\x00", 3); // partially written record
+    }
+
+    PersistentArray<int> restored = PersistentArray<int>::replayJournal(path);
+    EXPECT_EQ(restored.getVersion(1), std::vector<int>({ 1, 20, 3 }));
+    EXPECT_THROW(restored.getVersion(2), std::out_of_range);
+}
+
+TEST_F(OperationJournalTest, AttachAfterEditThrows) 
+{
+    int init_arr[] = { 1, 2, 3 };
+    PersistentArray<int> array(init_arr, 3);
+    array.addVersion(0, 0, 10);
+
+    OperationJournal journal(path);
+    EXPECT_THROW(array.attachJournal(journal), std::logic_error);
+}
+
+TEST_F(OperationJournalTest, FailedCheckpointLeavesJournalEmpty) 
+{
+    std::vector<std::pair<int, int>> init = { { 1, 2 }, { 3, 4 } }; // No JournalCodec for std::pair
+    PersistentArray<std::pair<int, int>> array(init, 2);
+    {
+        OperationJournal journal(path);
+        EXPECT_THROW(array.attachJournal(journal), std::logic_error);
+        EXPECT_EQ(journal.recordCount(), 0u);
+        array.addVersion(0, 0, { 5, 6 }); // Not journaled
+    }
+
+    OperationJournal::Reader reader(path);
+    OperationJournal::Op op;
+    const char* payload;
+    const char* end;
+    EXPECT_FALSE(reader.next(op, payload, end));
+}
+
+TEST_F(OperationJournalTest, AppendResumesAfterReplay) 
+{
+    int init_arr[] = { 1, 2, 3 };
+    PersistentArray<int> array(init_arr, 3);
+    {
+        OperationJournal journal(path);
+        array.attachJournal(journal);
+        array.addVersion(0, 0, 10);
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x02\x40\x00", 3); // partially written record
+    }
+
+    PersistentArray<int> restored = PersistentArray<int>::replayJournal(path);
+    {
+        OperationJournal journal(path, 64, OperationJournal::Mode::Append);
+        EXPECT_EQ(journal.recordCount(), 4u); // Checkpoint, edit and the time of both versions
+        restored.resumeJournal(journal);
+        restored.addVersion(1, 2, 30);
+        restored.undo();
+    }
+
+    PersistentArray<int> replayed = PersistentArray<int>::replayJournal(path);
+    EXPECT_EQ(replayed.getVersion(2), std::vector<int>({ 10, 2, 30 }));
+    EXPECT_EQ(replayed.getVersion(3), std::vector<int>({ 10, 2, 3 }));
+    EXPECT_THROW(replayed.getVersion(4), std::out_of_range);
+}
+
+TEST_F(OperationJournalTest, ResumeWithoutCheckpointThrows) 
+{
+    int init_arr[] = { 1, 2, 3 };
+    PersistentDoublyLinkedList<int> list(init_arr, 3);
+
+    OperationJournal journal(path, 64, OperationJournal::Mode::Append); // No file yet: starts a new journal
+    EXPECT_THROW(list.resumeJournal(journal), std::logic_error);
+    list.attachJournal(journal);
+    EXPECT_EQ(journal.recordCount(), 2u); // Checkpoint and the time of version 0
+}
+
+// Test fixture for PersistentHashMap tests
+class PersistentHashMapTest : public ::testing::Test 
+{
+protected:
+    PersistentHashMap<std::string, int>* map;
+
+    void SetUp() override 
+    {
+        std::vector<std::string> keys = { "one", "two", "three" };
+        int values[] = { 1, 2, 3 };
+        map = new PersistentHashMap<std::string, int>(keys, values, 3);
+    }
+
+    void TearDown() override 
+    {
+        delete map;
+    }
+};
+
+// Hash that sends every key to the same slot to exercise collision nodes
+struct ConstantHash
+{
+    size_t operator()(int) const
+    {
+        return 42;
+    }
+};
+
+TEST_F(PersistentHashMapTest, InitialVersion) 
+{
+    EXPECT_EQ(map->find(0, "two"), 2);
+    EXPECT_EQ(map->size(0), 3u);
+    EXPECT_THROW(map->find(0, "four"), std::runtime_error);
+}
+
+TEST_F(PersistentHashMapTest, AddVersionKeepsOldVersion) 
+{
+    map->addVersion(0, "two", 20);
+    map->addVersion(1, "four", 4);
+    EXPECT_EQ(map->find(0, "two"), 2);
+    EXPECT_FALSE(map->contains(1, "four"));
+    EXPECT_EQ(map->find(2, "two"), 20);
+    EXPECT_EQ(map->find(2, "four"), 4);
+    EXPECT_EQ(map->size(1), 3u);
+    EXPECT_EQ(map->size(2), 4u);
+}
+
+TEST_F(PersistentHashMapTest, UndoRedo) 
+{
+    map->addVersion(0, "one", 10);
+    map->undo(); // Version[2]
+    map->redo(); // Version[3]
+    EXPECT_EQ(map->find(2, "one"), 1);
+    EXPECT_EQ(map->find(3, "one"), 10);
+}
+
+TEST_F(PersistentHashMapTest, ManyKeys) 
+{
+    std::vector<int> keys;
+    std::vector<int> values;
+    for (int i = 0; i < 5000; ++i)
+    {
+        keys.push_back(i * 7919);
+        values.push_back(i);
+    }
+    PersistentHashMap<int, int> big(keys, values, values.size());
+    big.addVersion(0, 7919 * 10, -1);
+    for (int i = 0; i < 5000; ++i)
+    {
+        EXPECT_EQ(big.find(0, i * 7919), i);
+    }
+    EXPECT_EQ(big.find(1, 7919 * 10), -1);
+    EXPECT_EQ(big.getVersion(0).size(), 5000u);
+}
+
+TEST_F(PersistentHashMapTest, HashCollisions) 
+{
+    std::vector<int> keys = { 1, 2, 3 };
+    std::vector<int> values = { 10, 20, 30 };
+    PersistentHashMap<int, int, ConstantHash> colliding(keys, values, 3);
+    colliding.addVersion(0, 2, 200);
+    colliding.addVersion(1, 4, 40);
+    EXPECT_EQ(colliding.find(0, 2), 20);
+    EXPECT_EQ(colliding.find(2, 2), 200);
+    EXPECT_EQ(colliding.find(2, 4), 40);
+    EXPECT_EQ(colliding.size(2), 4u);
+    EXPECT_THROW((PersistentHashMap<int, int, ConstantHash>(keys, values, 2)), std::invalid_argument);
+}
+
+TEST_F(PersistentHashMapTest, NoActionToUndo) 
+{
+    testing::internal::CaptureStdout();
+    map->undo(); 
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(output, "No actions to undo!\n");
+}
+
+// Test conversion between PersistentArray and PersistentHashMap
+TEST_F(ConvertTest, ConvertArrayToHashMapAndBack) 
+{
+    std::vector<int> keys = { 1, 2, 3, 4, 5 };
+    PersistentHashMap<int, double> hash_map = Convert<double>::convertArrayToHashMap<int>(*array, keys, 0);
+    EXPECT_EQ(hash_map.find(0, 3), 300.3);
+
+    PersistentArray<double> newArray = Convert<double>::convertHashMapToArray(hash_map);
+    EXPECT_EQ(newArray.getVersion(0), hash_map.getVersion(0));
+}
+
+// Test conversion between PersistentAssociativeArray and PersistentHashMap
+TEST_F(ConvertTest, ConvertAssociativeArrayToHashMapAndBack) 
+{
+    PersistentHashMap<int, double> hash_map = Convert<double>::convertAssociativeArrayToHashMap(*associative_array);
+    EXPECT_EQ(hash_map.find(0, 5), 500.5);
+
+    PersistentAssociativeArray<int, double> newAssociativeArray = Convert<double>::convertHashMapToAssociativeArray(hash_map);
+    EXPECT_EQ(newAssociativeArray.getVersion(0), associative_array->getVersion(0));
+}
+
+// Test for invalid key size in Convert List to HashMap
+TEST_F(ConvertTest, ConvertListToHashMapInvalidKeys) 
+{
+    std::vector<int> keys = { 1, 2 }; 
+    EXPECT_THROW(Convert<double>::convertListToHashMap<int>(*list, keys, 0), std::invalid_argument);
+}
+
+// Test fixture for RerootingPersistentArray tests
+class RerootingPersistentArrayTest : public ::testing::Test 
+{
+protected:
+    RerootingPersistentArray<int>* array;
+
+    void SetUp() override 
+    {
+        int init_arr[] = { 1, 2, 3, 4, 5 };
+        array = new RerootingPersistentArray<int>(init_arr, 5);
+    }
+
+    void TearDown() override 
+    {
+        delete array;
+    }
+};
+
+TEST_F(RerootingPersistentArrayTest, InitialVersion) 
+{
+    EXPECT_EQ(array->getVersion(0), std::vector<int>({ 1, 2, 3, 4, 5 }));
+}
+
+TEST_F(RerootingPersistentArrayTest, AddVersionMovesActiveArray) 
+{
+    array->addVersion(0, 0, 10);
+    array->addVersion(1, 4, 50);
+    EXPECT_EQ(array->activeVersion(), 2u);
+    EXPECT_EQ(array->get(2, 4), 50);
+
+    // Reading an old version reroots to it, newer versions stay reachable
+    EXPECT_EQ(array->getVersion(0), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(array->activeVersion(), 0u);
+    EXPECT_EQ(array->getVersion(2), std::vector<int>({ 10, 2, 3, 4, 50 }));
+    EXPECT_EQ(array->getVersion(1), std::vector<int>({ 10, 2, 3, 4, 5 }));
+}
+
+TEST_F(RerootingPersistentArrayTest, BranchingVersions) 
+{
+    array->addVersion(0, 1, 20); // Version[1]
+    array->addVersion(0, 1, 200); // Version[2], sibling of Version[1]
+    array->addVersion(1, 2, 30); // Version[3]
+    EXPECT_EQ(array->getVersion(3), std::vector<int>({ 1, 20, 30, 4, 5 }));
+    EXPECT_EQ(array->getVersion(2), std::vector<int>({ 1, 200, 3, 4, 5 }));
+    EXPECT_EQ(array->get(1, 1), 20);
+    EXPECT_EQ(array->get(0, 1), 2);
+}
+
+TEST_F(RerootingPersistentArrayTest, UndoRedo) 
+{
+    array->addVersion(0, 0, 10);
+    array->undo(); // Version[2]
+    array->redo(); // Version[3]
+    EXPECT_EQ(array->getVersion(2), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(array->getVersion(3), std::vector<int>({ 10, 2, 3, 4, 5 }));
+}
+
+TEST_F(RerootingPersistentArrayTest, InvalidIndices) 
+{
+    EXPECT_THROW(array->addVersion(0, 10, 0), std::out_of_range);
+    EXPECT_THROW(array->addVersion(3, 0, 0), std::out_of_range);
+    EXPECT_THROW(array->getVersion(10), std::out_of_range);
+    EXPECT_THROW(array->get(0, 5), std::out_of_range);
+}
+
+TEST_F(RerootingPersistentArrayTest, ConstructorSizes) 
+{
+    std::vector<int> values = { 1, 2, 3 };
+    EXPECT_EQ(RerootingPersistentArray<int>(values, 2).getVersion(0), std::vector<int>({ 1, 2 }));
+    EXPECT_THROW(RerootingPersistentArray<int>(values, 4), std::invalid_argument);
+    EXPECT_THROW(RerootingPersistentArray<int>(values, -1), std::invalid_argument);
+    EXPECT_THROW(RerootingPersistentArray<int>(values.data(), -1), std::invalid_argument);
+}
+
+// Test fixture for RRBVector and PersistentSequence tests
+class PersistentSequenceTest : public ::testing::Test 
+{
+protected:
+    PersistentSequence<int>* sequence;
+
+    void SetUp() override 
+    {
+        int init_arr[] = { 1, 2, 3, 4, 5 };
+        sequence = new PersistentSequence<int>(init_arr, 5);
+    }
+
+    void TearDown() override 
+    {
+        delete sequence;
+    }
+
+    static std::vector<int> range(int first, int last)
+    {
+        std::vector<int> result;
+        for (int i = first; i < last; ++i)
+        {
+            result.push_back(i);
+        }
+        return result;
+    }
+};
+
+TEST_F(PersistentSequenceTest, ArrayAndListOperations) 
+{
+    sequence->addVersion(0, 0, 10); // Version[1]
+    sequence->push_front(0); // Version[2]
+    sequence->push_back(6); // Version[3]
+    EXPECT_EQ(sequence->getVersion(0), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(sequence->getVersion(1), std::vector<int>({ 10, 2, 3, 4, 5 }));
+    EXPECT_EQ(sequence->getVersion(3), std::vector<int>({ 0, 10, 2, 3, 4, 5, 6 }));
+}
+
+TEST_F(PersistentSequenceTest, ConstructorSizes) 
+{
+    std::vector<int> values = { 1, 2, 3 };
+    EXPECT_EQ(PersistentSequence<int>(values, 2).getVersion(0), std::vector<int>({ 1, 2 }));
+    EXPECT_TRUE(PersistentSequence<int>(values, 0).getVersion(0).empty());
+    EXPECT_THROW(PersistentSequence<int>(values, 4), std::invalid_argument);
+    EXPECT_THROW(PersistentSequence<int>(values, -1), std::invalid_argument);
+    EXPECT_THROW(PersistentSequence<int>(values.data(), -1), std::invalid_argument);
+}
+
+TEST_F(PersistentSequenceTest, InsertEraseConcatSlice) 
+{
+    sequence->insertVersion(0, 2, 100); // Version[1]
+    sequence->eraseVersion(1, 0); // Version[2]
+    sequence->concatVersions(0, 2); // Version[3]
+    sequence->sliceVersion(3, 3, 8); // Version[4]
+    EXPECT_EQ(sequence->getVersion(1), std::vector<int>({ 1, 2, 100, 3, 4, 5 }));
+    EXPECT_EQ(sequence->getVersion(2), std::vector<int>({ 2, 100, 3, 4, 5 }));
+    EXPECT_EQ(sequence->getVersion(3), std::vector<int>({ 1, 2, 3, 4, 5, 2, 100, 3, 4, 5 }));
+    EXPECT_EQ(sequence->getVersion(4), std::vector<int>({ 4, 5, 2, 100, 3 }));
+    EXPECT_EQ(sequence->at(3, 6), 100);
+}
+
+TEST_F(PersistentSequenceTest, LargeSplitAndConcat) 
+{
+    RRBVector<int> vector(range(0, 10000));
+    for (size_t cut : { 1u, 31u, 32u, 33u, 1024u, 5000u, 9999u })
+    {
+        auto parts = vector.split(cut);
+        EXPECT_EQ(parts.first.toVector(), range(0, cut));
+        EXPECT_EQ(parts.second.toVector(), range(cut, 10000));
+        EXPECT_EQ(RRBVector<int>::concat(parts.first, parts.second).toVector(), range(0, 10000));
+    }
+
+    RRBVector<int> built;
+    for (int i = 0; i < 3000; ++i)
+    {
+        built = (i % 2 == 0) ? built.push_back(i) : RRBVector<int>::concat(built, RRBVector<int>(range(i, i + 1)));
+    }
+    EXPECT_EQ(built.toVector(), range(0, 3000));
+    EXPECT_LE(built.height(), 3);
+    EXPECT_EQ(built.at(2999), 2999);
+}
+
+TEST_F(PersistentSequenceTest, RepeatedInsertInMiddle) 
+{
+    RRBVector<int> vector;
+    std::vector<int> expected;
+    for (int i = 0; i < 2000; ++i)
+    {
+        size_t position = expected.size() / 2;
+        vector = vector.insert(position, i);
+        expected.insert(expected.begin() + position, i);
+    }
+    EXPECT_EQ(vector.toVector(), expected);
+    for (int i = 0; i < 1000; ++i)
+    {
+        size_t position = (i * 7) % expected.size();
+        vector = vector.erase(position);
+        expected.erase(expected.begin() + position);
+    }
+    EXPECT_EQ(vector.toVector(), expected);
+}
+
+TEST_F(PersistentSequenceTest, UndoRedo) 
+{
+    sequence->push_back(6);
+    sequence->undo(); // Version[2]
+    sequence->redo(); // Version[3]
+    EXPECT_EQ(sequence->getVersion(2), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(sequence->getVersion(3), std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
+}
+
+TEST_F(PersistentSequenceTest, InvalidIndices) 
+{
+    EXPECT_THROW(sequence->addVersion(0, 5, 0), std::out_of_range);
+    EXPECT_THROW(sequence->insertVersion(0, 6, 0), std::out_of_range);
+    EXPECT_THROW(sequence->sliceVersion(0, 3, 2), std::out_of_range);
+    EXPECT_THROW(sequence->getVersion(10), std::out_of_range);
+}
+
+// Test conversions between PersistentSequence and the array and list
+TEST_F(ConvertTest, ConvertSequenceRoutes) 
+{
+    PersistentSequence<double> sequence = Convert<double>::convertArrayToSequence(*array, 0);
+    sequence.push_back(600.6);
+    PersistentDoublyLinkedList<double> newList = Convert<double>::convertSequenceToList(sequence, 1);
+    EXPECT_EQ(newList.getVersion(0), std::vector<double>({ 100.1, 200.2, 300.3, 400.4, 500.5, 600.6 }));
+
+    PersistentSequence<double> shared = Convert<double>::convertSequence(sequence, 1);
+    EXPECT_EQ(shared.getVersion(0), sequence.getVersion(1));
+    EXPECT_EQ(Convert<double>::convertSequenceToArray(Convert<double>::convertListToSequence(*list)).getVersion(0), list->getVersion(0));
+}
+
+TEST_F(OperationJournalTest, ReplayAssociativeArrayErase) 
+{
+    std::vector<int> keys = { 2, 1, 3 };
+    int values[] = { 20, 10, 30 };
+    PersistentAssociativeArray<int, int> array(keys, values, 3);
+    {
+        OperationJournal journal(path);
+        array.attachJournal(journal);
+        array.eraseVersion(0, 2);
+        array.undo();
+    }
+
+    auto restored = PersistentAssociativeArray<int, int>::replayJournal(path);
+    EXPECT_EQ(restored.getVersion(1), std::vector<int>({ 10, 30 }));
+    EXPECT_EQ(restored.getVersion(2), std::vector<int>({ 10, 20, 30 }));
+    EXPECT_EQ(restored.size(1), 2u);
+}
+
+// Test fixture for the bulk kernels over PersistentArray versions
+class PersistentArrayKernelsTest : public ::testing::Test 
+{
+protected:
+    std::vector<int> ints;
+    std::vector<double> doubles;
+
+    void SetUp() override 
+    {
+        for (int i = 0; i < 1003; ++i) // Not a multiple of any vector width
+        {
+            ints.push_back((i * 37) % 1001 - 500);
+            doubles.push_back(((i * 53) % 997) * 0.5 - 100.25);
+        }
+    }
+};
+
+TEST_F(PersistentArrayKernelsTest, KernelsMatchScalarLoops) 
+{
+    for (size_t size : { 1u, 3u, 8u, 17u, 1003u })
+    {
+        long long int_sum = 0;
+        double double_sum = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            int_sum += ints[i];
+            double_sum += doubles[i];
+        }
+        EXPECT_EQ(SimdKernels<int>::sum(ints.data(), size), int_sum);
+        EXPECT_NEAR(SimdKernels<double>::sum(doubles.data(), size), double_sum, 1e-6);
+        EXPECT_EQ(SimdKernels<int>::min(ints.data(), size), *std::min_element(ints.begin(), ints.begin() + size));
+        EXPECT_EQ(SimdKernels<double>::max(doubles.data(), size), *std::max_element(doubles.begin(), doubles.begin() + size));
+    }
+}
+
+TEST_F(PersistentArrayKernelsTest, IntVersion) 
+{
+    PersistentArray<int> array(ints, ints.size());
+    array.addVersion(0, 1000, 100000);
+    array.scaleVersion(1, 3); // Version[2]
+
+    long long expected_sum = 0;
+    for (int value : ints)
+    {
+        expected_sum += value;
+    }
+    EXPECT_EQ(array.sumVersion(0), expected_sum);
+    EXPECT_EQ(array.maxVersion(1), 100000);
+    EXPECT_EQ(array.minVersion(0), -500);
+    EXPECT_EQ(array.getVersion(2)[1000], 300000);
+    EXPECT_EQ(array.getVersion(2)[5], ints[5] * 3);
+    EXPECT_EQ(array.countEqualElements(0, 1), ints.size() - 1);
+}
+
+TEST_F(PersistentArrayKernelsTest, DoubleVersion) 
+{
+    PersistentArray<double> array(doubles, doubles.size());
+    array.scaleVersion(0, 2.0);
+
+    EXPECT_NEAR(array.sumVersion(1), 2.0 * array.sumVersion(0), 1e-6);
+    EXPECT_EQ(array.minVersion(1), 2.0 * array.minVersion(0));
+    EXPECT_EQ(array.countEqualElements(0, 0), doubles.size());
+    EXPECT_THROW(array.sumVersion(5), std::out_of_range);
+}
+
+// Test fixture for parallel algorithms over one version
+class ParallelAlgorithmsTest : public ::testing::Test 
+{
+protected:
+    WorkStealingPool pool{ 4 };
+    std::vector<long long> values;
+
+    void SetUp() override 
+    {
+        for (int i = 0; i < 100000; ++i)
+        {
+            values.push_back(i % 1000);
+        }
+    }
+
+    long long expectedSum() const
+    {
+        long long sum = 0;
+        for (long long value : values)
+        {
+            sum += value;
+        }
+        return sum;
+    }
+};
+
+TEST_F(ParallelAlgorithmsTest, Array) 
+{
+    PersistentArray<long long> array(values, values.size());
+    auto plus = [](long long a, long long b) { return a + b; };
+    EXPECT_EQ(array.parallel_reduce(pool, 0, 0LL, plus), expectedSum());
+
+    std::atomic<long long> visited{ 0 };
+    array.parallel_for_each(pool, 0, [&visited](const long long& value) { visited += value; });
+    EXPECT_EQ(visited.load(), expectedSum());
+
+    array.parallel_transform(pool, 0, [](const long long& value) { return value * 2; });
+    EXPECT_EQ(array.parallel_reduce(pool, 1, 0LL, plus), 2 * expectedSum());
+    EXPECT_EQ(array.getVersion(0), values);
+}
+
+TEST_F(ParallelAlgorithmsTest, BoolReduce) 
+{
+    // Per-chunk results must not share words as in std::vector<bool>
+    std::vector<bool> flags(values.size(), true);
+    PersistentArray<bool> array(flags, flags.size());
+    PersistentDoublyLinkedList<bool> list(flags, flags.size());
+    auto both = [](bool a, bool b) { return a && b; };
+    EXPECT_TRUE(array.parallel_reduce(pool, 0, true, both));
+    EXPECT_TRUE(list.parallel_reduce(pool, 0, true, both));
+
+    array.addVersion(0, static_cast<int>(flags.size()) - 1, false);
+    EXPECT_FALSE(array.parallel_reduce(pool, 1, true, both));
+    EXPECT_TRUE(array.parallel_reduce(pool, 0, true, both));
+}
+
+TEST_F(ParallelAlgorithmsTest, List) 
+{
+    PersistentDoublyLinkedList<long long> list(values, values.size());
+    auto plus = [](long long a, long long b) { return a + b; };
+    EXPECT_EQ(list.parallel_reduce(pool, 0, 0LL, plus), expectedSum());
+
+    list.parallel_transform(pool, 0, [](const long long& value) { return value + 1; });
+    std::vector<long long> expected = values;
+    for (auto& value : expected)
+    {
+        value += 1;
+    }
+    EXPECT_EQ(list.getVersion(1), expected);
+    EXPECT_EQ(list.getVersion(0), values);
+}
+
+TEST_F(ParallelAlgorithmsTest, ListVersionEndsAtItsLength) 
+{
+    PersistentDoublyLinkedList<long long> list(values, values.size());
+    list.push_back(1000000); // Linked after the tail that version 0 shares
+    auto plus = [](long long a, long long b) { return a + b; };
+    EXPECT_EQ(list.parallel_reduce(pool, 0, 0LL, plus), expectedSum());
+    EXPECT_EQ(list.parallel_reduce(pool, 1, 0LL, plus), expectedSum() + 1000000);
+
+    list.parallel_transform(pool, 0, [](const long long& value) { return value; });
+    EXPECT_EQ(list.getVersion(2), values);
+    EXPECT_EQ(list.memoryStats(2).version_nodes, values.size());
+}
+
+TEST_F(ParallelAlgorithmsTest, AssociativeArrayKeepsKeyOrder) 
+{
+    std::vector<int> keys;
+    std::vector<std::string> strings;
+    for (int i = 0; i < 2000; ++i)
+    {
+        keys.push_back((i * 7919) % 2003);
+        strings.push_back(std::to_string(keys.back()) + ",");
+    }
+    PersistentAssociativeArray<int, std::string> array(keys, strings, strings.size());
+
+    // String concatenation is associative but not commutative
+    std::string sequential;
+    for (const auto& value : array.getVersion(0))
+    {
+        sequential += value;
+    }
+    EXPECT_EQ(array.parallel_reduce(pool, 0, std::string(), [](const std::string& a, const std::string& b) { return a + b; }), sequential);
+
+    array.parallel_transform(pool, 0, [](const std::string& value) { return value + value; });
+    EXPECT_EQ(array.getKeys(1), array.getKeys(0));
+    EXPECT_EQ(array.size(1), 2000u);
+    EXPECT_EQ(array.getVersion(1)[10], array.getVersion(0)[10] + array.getVersion(0)[10]);
+}
+
+TEST_F(ParallelAlgorithmsTest, SingleThreadPoolAndExceptions) 
+{
+    WorkStealingPool single(1);
+    PersistentArray<long long> array(values, values.size());
+    EXPECT_EQ(array.parallel_reduce(single, 0, 0LL, [](long long a, long long b) { return a + b; }), expectedSum());
+    EXPECT_THROW(array.parallel_for_each(pool, 0, [](const long long& value)
+    {
+        if (value == 999)
+        {
+            throw std::runtime_error("failure in task");
+        }
+    }), std::runtime_error);
+}
+
+// Test fixture for monoid-augmented range aggregates
+class RangeAggregateTest : public ::testing::Test 
+{
+protected:
+    std::vector<int> values;
+
+    void SetUp() override 
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            values.push_back((i * 31) % 97 - 40);
+        }
+    }
+};
+
+TEST_F(RangeAggregateTest, ArraySumAcrossVersions) 
+{
+    PersistentArray<int, SumAggregate<int>> array(values, values.size());
+    array.addVersion(0, 10, 1000); // Version[1]
+    array.addVersion(1, 150, -1000); // Version[2]
+    array.undo(); // Version[3] == Version[1]
+
+    for (size_t version = 0; version < 4; ++version)
+    {
+        std::vector<int> expected = array.getVersion(version);
+        for (size_t first = 0; first < expected.size(); first += 13)
+        {
+            for (size_t last = first; last <= expected.size(); last += 29)
+            {
+                int sum = 0;
+                for (size_t i = first; i < last; ++i)
+                {
+                    sum += expected[i];
+                }
+                EXPECT_EQ(array.rangeAggregate(version, first, last), sum);
+            }
+        }
+    }
+    EXPECT_THROW(array.rangeAggregate(0, 5, 201), std::out_of_range);
+}
+
+TEST_F(RangeAggregateTest, ArrayMinAfterScale) 
+{
+    PersistentArray<int, MinAggregate<int>> array(values, values.size());
+    array.scaleVersion(0, -1);
+    EXPECT_EQ(array.rangeAggregate(0, 0, values.size()), array.minVersion(0));
+    EXPECT_EQ(array.rangeAggregate(1, 0, values.size()), array.minVersion(1));
+    EXPECT_EQ(array.rangeAggregate(1, 3, 3), MinAggregate<int>::identity());
+}
+
+TEST_F(RangeAggregateTest, AssociativeArrayKeyRanges) 
+{
+    std::vector<int> keys;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        keys.push_back(static_cast<int>((i * 7919) % 1009));
+    }
+    PersistentAssociativeArray<int, int, SumAggregate<int>> array(keys, values, values.size());
+    array.addVersion(0, keys[5], 500); // Version[1]
+    array.eraseVersion(1, keys[7]); // Version[2]
+    array.addVersion(2, 2000, 3); // Version[3]
+
+    for (size_t version = 0; version < 4; ++version)
+    {
+        std::vector<int> version_keys = array.getKeys(version);
+        std::vector<int> version_values = array.getVersion(version);
+        for (int low = -10; low < 2100; low += 97)
+        {
+            for (int high = low; high < 2100; high += 301)
+            {
+                int sum = 0;
+                for (size_t i = 0; i < version_keys.size(); ++i)
+                {
+                    if (low <= version_keys[i] && version_keys[i] < high)
+                    {
+                        sum += version_values[i];
+                    }
+                }
+                EXPECT_EQ(array.rangeAggregate(version, low, high), sum);
+            }
+        }
+    }
+}
+
+TEST_F(RangeAggregateTest, AssociativeArrayMaxAfterTransform) 
+{
+    std::vector<int> keys = { 5, 2, 8, 1, 9 };
+    std::vector<int> small = { 50, 20, 80, 10, 90 };
+    PersistentAssociativeArray<int, int, MaxAggregate<int>> array(keys, small, small.size());
+    WorkStealingPool pool(2);
+    array.parallel_transform(pool, 0, [](const int& value) { return -value; });
+    EXPECT_EQ(array.rangeAggregate(0, 2, 9), 80);
+    EXPECT_EQ(array.rangeAggregate(1, 2, 9), -20);
+    EXPECT_EQ(array.rangeAggregate(1, 3, 5), MaxAggregate<int>::identity());
+}
+
+// Test fixture for memory accounting
+class MemoryStatsTest : public ::testing::Test 
+{
+protected:
+    std::vector<int> values = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    std::vector<int> keys = { 4, 2, 6, 1, 3, 5, 7, 8 };
+};
+
+TEST_F(MemoryStatsTest, ArrayCountsSharedElements) 
+{
+    std::vector<std::string> words;
+    for (int value : values)
+    {
+        words.push_back(std::to_string(value));
+    }
+    PersistentArray<std::string> array(words, words.size()); // Boxed elements are shared between versions
+    MemoryStats base = array.memoryStats(0);
+    EXPECT_EQ(base.version_count, 1);
+    EXPECT_EQ(base.node_count, 8);
+    EXPECT_EQ(base.allocation_count, 9); // Elements plus the spine
+    EXPECT_DOUBLE_EQ(base.shared_node_ratio, 0.0);
+
+    array.addVersion(0, 3, "40"); // Version[1]
+    array.undo(); // Version[2]
+    MemoryStats edited = array.memoryStats(1);
+    EXPECT_EQ(edited.version_count, 3);
+    EXPECT_EQ(edited.node_count, 9);
+    EXPECT_EQ(edited.node_references, 24);
+    EXPECT_EQ(edited.version_nodes, 1);
+    EXPECT_EQ(edited.version_unique_bytes, base.version_unique_bytes - 7 * sharedAllocationBytes<std::string>());
+    EXPECT_DOUBLE_EQ(edited.shared_node_ratio, 1.0 - 9.0 / 24.0);
+    EXPECT_EQ(array.memoryStats(2).version_nodes, 0);
+    EXPECT_GT(edited.total_bytes, base.total_bytes);
+    EXPECT_THROW(array.memoryStats(3), std::out_of_range);
+}
+
+TEST_F(MemoryStatsTest, UnboxedArrayHasNoNodes) 
+{
+    PersistentArray<int> array(values, values.size()); // Trivially copyable elements live in the versions
+    array.addVersion(0, 3, 40);
+    MemoryStats stats = array.memoryStats(1);
+    EXPECT_EQ(stats.node_count, 0);
+    EXPECT_EQ(stats.allocation_count, 2);
+    EXPECT_EQ(stats.version_unique_bytes, values.size() * sizeof(int));
+    EXPECT_EQ(stats.total_bytes, 2 * values.size() * sizeof(int));
+}
+
+TEST_F(MemoryStatsTest, ListCountsPushedNodes) 
+{
+    PersistentDoublyLinkedList<int> list(values, values.size());
+    list.push_front(0); // Version[1]
+    list.push_back(9); // Version[2]
+    list.undo(); // Version[3]
+
+    MemoryStats stats = list.memoryStats(3);
+    EXPECT_EQ(stats.node_count, 10);
+    EXPECT_EQ(stats.node_references, 8 + 9 + 10 + 9);
+    EXPECT_EQ(stats.version_nodes, 0);
+    EXPECT_EQ(list.memoryStats(1).version_nodes, 1);
+    EXPECT_EQ(stats.allocation_count, 10);
+}
+
+TEST_F(MemoryStatsTest, AssociativeArrayCountsCopiedPath) 
+{
+    PersistentAssociativeArray<int, int> array(keys, values, values.size());
+    EXPECT_EQ(array.memoryStats(0).node_count, 8);
+
+    array.addVersion(0, 8, 80); // Path 4 -> 6 -> 7 -> 8 is copied, Version[1]
+    EXPECT_EQ(array.memoryStats(1).version_nodes, 4);
+    array.addVersion(1, 9, 90); // Path of 4 nodes plus the new one, Version[2]
+    EXPECT_EQ(array.memoryStats(2).version_nodes, 5);
+    array.eraseVersion(2, 2); // Successor 3 replaces 2 under a copied root, Version[3]
+    EXPECT_EQ(array.memoryStats(3).version_nodes, 2);
+    EXPECT_THROW(array.eraseVersion(3, 100), std::runtime_error);
+    array.undo(); // Version[4]
+
+    MemoryStats stats = array.memoryStats(4);
+    EXPECT_EQ(stats.version_nodes, 0);
+    EXPECT_EQ(stats.node_count, 8 + 4 + 5 + 2);
+    EXPECT_EQ(stats.node_references, 8 + 8 + 9 + 8 + 9);
+    EXPECT_GT(stats.shared_node_ratio, 0.5);
+}
+
+TEST_F(MemoryStatsTest, HashMapCountsCopiedPath) 
+{
+    PersistentHashMap<int, int> map(keys, values, values.size()); // Small int hashes all fit into the root
+    MemoryStats base = map.memoryStats(0);
+    EXPECT_EQ(base.node_count, 1);
+    EXPECT_EQ(base.allocation_count, 2); // Root plus its entry array
+    EXPECT_GE(base.total_bytes, (sharedAllocationBytes<HAMT_node<int, int>>() + keys.size() * sizeof(HAMT_entry<int, int>)));
+
+    map.addVersion(0, 9, 90); // Root is copied, Version[1]
+    EXPECT_EQ(map.memoryStats(1).version_nodes, 1);
+    map.addVersion(1, 41, 410); // 41 shares the root slot of 9: copied root plus a merged node, Version[2]
+    EXPECT_EQ(map.memoryStats(2).version_nodes, 2);
+    map.undo(); // Version[3]
+
+    MemoryStats stats = map.memoryStats(3);
+    EXPECT_EQ(stats.version_nodes, 0);
+    EXPECT_EQ(stats.node_count, 1 + 1 + 2);
+    EXPECT_EQ(stats.node_references, 1 + 1 + 2 + 1);
+    EXPECT_EQ(stats.allocation_count, 2 + 2 + 5); // The copied root holds entries and children
+    EXPECT_THROW(map.memoryStats(4), std::out_of_range);
+}
+
+TEST_F(MemoryStatsTest, RerootingArrayAllocatesOneNodePerVersion) 
+{
+    RerootingPersistentArray<int> array(values, values.size());
+    MemoryStats base = array.memoryStats(0);
+    EXPECT_EQ(base.node_count, 1);
+    EXPECT_EQ(base.allocation_count, 2); // Node plus the flat array
+    EXPECT_EQ(base.total_bytes, sharedAllocationBytes<RA_node<int>>() + values.size() * sizeof(int));
+
+    array.addVersion(0, 3, 40); // The flat array moves, Version[1]
+    array.undo(); // Version[2]
+    MemoryStats edited = array.memoryStats(1);
+    EXPECT_EQ(edited.version_nodes, 1);
+    EXPECT_EQ(edited.version_unique_bytes, sharedAllocationBytes<RA_node<int>>());
+    EXPECT_EQ(array.memoryStats(2).version_nodes, 0);
+    EXPECT_EQ(edited.node_references, 3);
+    EXPECT_DOUBLE_EQ(edited.shared_node_ratio, 1.0 - 2.0 / 3.0);
+    EXPECT_THROW(array.memoryStats(3), std::out_of_range);
+}
+
+TEST_F(MemoryStatsTest, SequenceCountsCopiedPath) 
+{
+    std::vector<int> many(5000);
+    for (size_t i = 0; i < many.size(); ++i)
+    {
+        many[i] = static_cast<int>(i);
+    }
+    PersistentSequence<int> sequence(many, many.size());
+    size_t nodes = sequence.snapshot(0).nodeCount();
+    MemoryStats base = sequence.memoryStats(0);
+    EXPECT_GT(nodes, 1);
+    EXPECT_EQ(base.node_count, nodes);
+    EXPECT_EQ(base.node_references, nodes);
+
+    sequence.addVersion(0, 2500, -1); // One node per level is copied, Version[1]
+    size_t path = sequence.snapshot(0).height() + 1;
+    EXPECT_EQ(sequence.memoryStats(1).version_nodes, path);
+    sequence.concatVersions(1, 1); // Only the seam is rebuilt, Version[2]
+    EXPECT_LT(sequence.memoryStats(2).version_nodes, nodes);
+    EXPECT_EQ(sequence.snapshot(2).nodeCount(), sequence.memoryStats(2).node_references - 2 * nodes);
+    sequence.undo(); // Version[3]
+
+    MemoryStats stats = sequence.memoryStats(3);
+    EXPECT_EQ(stats.version_nodes, 0);
+    EXPECT_EQ(stats.node_references, 3 * nodes + sequence.snapshot(2).nodeCount());
+    EXPECT_GT(stats.shared_node_ratio, 0.5);
+    EXPECT_GT(stats.total_bytes, many.size() * sizeof(int));
+}
+
+// Tests for the latency histograms
+TEST(LatencyHistogramTest, BucketsKeepThreePercentPrecision) 
+{
+    for (std::uint64_t value : { 0ull, 1ull, 63ull, 64ull, 65ull, 1000ull, 123456789ull, 1ull << 40 })
+    {
+        int index = LatencyHistogram::bucketIndex(value);
+        std::uint64_t upper = LatencyHistogram::bucketUpperBound(index);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / 32);
+        EXPECT_LT(index, LatencyHistogram::bucket_count);
+    }
+    EXPECT_EQ(LatencyHistogram::bucketIndex(~0ull), LatencyHistogram::bucket_count - 1);
+}
+
+TEST(LatencyHistogramTest, PercentilesAndDump) 
+{
+    LatencyRecorder recorder;
+    for (std::uint64_t i = 1; i <= 1000; ++i)
+    {
+        recorder.record(LatencyOp::AddVersion, i * 100);
+    }
+    recorder.record(LatencyOp::Undo, 42);
+
+    const LatencyHistogram& add = recorder.histogram(LatencyOp::AddVersion);
+    EXPECT_EQ(add.count(), 1000);
+    EXPECT_EQ(add.max(), 100000);
+    EXPECT_DOUBLE_EQ(add.mean(), 50050.0);
+    EXPECT_NEAR(double(add.percentile(0.5)), 50000.0, 50000.0 / 32);
+    EXPECT_NEAR(double(add.percentile(0.99)), 99000.0, 99000.0 / 32);
+    EXPECT_EQ(add.percentile(1.0), 100000);
+    EXPECT_EQ(recorder.histogram(LatencyOp::Redo).percentile(0.5), 0);
+
+    std::ostringstream json;
+    recorder.dumpJson(json);
+    EXPECT_EQ(json.str().find("\"addVersion\":{\"count\":1000,"), 1);
+    EXPECT_NE(json.str().find("\"undo\":{\"count\":1,"), std::string::npos);
+    EXPECT_EQ(json.str().find("redo"), std::string::npos);
+
+    std::ostringstream text;
+    recorder.dump(text);
+    EXPECT_NE(text.str().find("undo\t1\t42\t42"), std::string::npos);
+}
+
+#ifdef PERSISTENT_INSTRUMENTATION
+TEST(LatencyHistogramTest, ContainersRecordOperations) 
+{
+    std::vector<int> values = { 1, 2, 3 };
+    PersistentArray<int> array(values, values.size());
+    array.addVersion(0, 1, 20);
+    array.undo();
+    array.getVersion(1);
+    Convert<int>::convertArrayToList(array, 1);
+
+    const LatencyRecorder& latencies = array.latencies();
+    EXPECT_EQ(latencies.histogram(LatencyOp::AddVersion).count(), 1);
+    EXPECT_EQ(latencies.histogram(LatencyOp::Undo).count(), 1);
+    EXPECT_EQ(latencies.histogram(LatencyOp::GetVersion).count(), 2);
+    EXPECT_EQ(latencies.histogram(LatencyOp::Convert).count(), 1);
+}
+#endif
+
+// Test fixture for version tags and timestamps
+class VersionIndexTest : public ::testing::Test 
+{
+protected:
+    std::string path;
+    std::vector<int> values = { 1, 2, 3, 4 };
+
+    void SetUp() override 
+    {
+        path = testing::TempDir() + "persistent_version_index_test.bin";
+    }
+
+    void TearDown() override 
+    {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(VersionIndexTest, TagsNameVersions) 
+{
+    PersistentArray<int> array(values, values.size());
+    array.addVersion(0, 0, 10); // Version[1]
+    array.tagVersion("release-42", 1);
+    array.undo(); // Version[2]
+    array.tagVersion("base", 0);
+
+    EXPECT_EQ(array.versionByTag("release-42"), 1);
+    EXPECT_EQ(array.getVersion(array.versionByTag("base")), values);
+    EXPECT_THROW(array.tagVersion("base", 2), std::invalid_argument);
+    EXPECT_THROW(array.tagVersion("next", 3), std::out_of_range);
+    EXPECT_THROW(array.versionByTag("missing"), std::runtime_error);
+
+    PersistentArray<int> snapshot = array;
+    EXPECT_EQ(snapshot.versionByTag("release-42"), 1);
+}
+
+TEST_F(VersionIndexTest, AsOfFindsLatestVersion) 
+{
+    PersistentAssociativeArray<int, int> map({ 1, 2, 3, 4 }, values, values.size());
+    for (int i = 0; i < 20; ++i)
+    {
+        map.addVersion(i, i, i * 10);
+    }
+    map.undo(); // Version[21]
+
+    for (size_t version = 0; version < 22; ++version)
+    {
+        VersionIndex::Clock::time_point time = map.versionTime(version);
+        size_t found = map.versionAsOf(time);
+        EXPECT_GE(found, version);
+        EXPECT_EQ(map.versionTime(found), time);
+        if (version > 0)
+        {
+            EXPECT_GE(time, map.versionTime(version - 1));
+        }
+    }
+    EXPECT_EQ(map.versionAsOf(VersionIndex::Clock::now()), 21);
+    EXPECT_THROW(map.versionAsOf(map.versionTime(0) - std::chrono::seconds(1)), std::out_of_range);
+    EXPECT_THROW(map.versionTime(22), std::out_of_range);
+}
+
+TEST_F(VersionIndexTest, JournalKeepsTags) 
+{
+    PersistentDoublyLinkedList<int> list(values, values.size());
+    {
+        OperationJournal journal(path);
+        list.attachJournal(journal);
+        list.push_back(5); // Version[1]
+        list.tagVersion("appended", 1);
+        list.push_front(0); // Version[2]
+        list.tagVersion("latest", 2);
+        journal.commit();
+        list.detachJournal();
+    }
+
+    PersistentDoublyLinkedList<int> replayed = PersistentDoublyLinkedList<int>::replayJournal(path);
+    EXPECT_EQ(replayed.versionByTag("appended"), 1);
+    EXPECT_EQ(replayed.versionByTag("latest"), 2);
+    EXPECT_EQ(replayed.getVersion(2), list.getVersion(2));
+}
+
+TEST_F(VersionIndexTest, JournalKeepsTimes) 
+{
+    std::vector<int> keys = { 1, 2, 3, 4 };
+    PersistentAssociativeArray<int, int> map(keys, values, keys.size());
+    {
+        OperationJournal journal(path);
+        map.attachJournal(journal);
+        map.addVersion(0, 5, 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        map.eraseVersion(1, 1);
+        map.undo();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2)); // Replayed versions must not carry the replay time
+    auto replayed = PersistentAssociativeArray<int, int>::replayJournal(path);
+    ASSERT_EQ(replayed.versionCount(), map.versionCount());
+    for (size_t i = 0; i < map.versionCount(); ++i)
+    {
+        EXPECT_EQ(replayed.versionTime(i), map.versionTime(i));
+    }
+    EXPECT_EQ(replayed.versionAsOf(map.versionTime(1)), 1u);
+}
+
+// Test fixture for unboxed storage of trivially copyable elements
+struct Pod64
+{
+    double values[8];
+};
+
+class UnboxedStorageTest : public ::testing::Test 
+{
+};
+
+TEST_F(UnboxedStorageTest, StorageIsChosenByType) 
+{
+    EXPECT_TRUE(ElementStorage<int>::unboxed);
+    EXPECT_TRUE(ElementStorage<double>::unboxed);
+    EXPECT_FALSE(ElementStorage<Pod64>::unboxed); // Too large: copying versions would cost more than pointers
+    EXPECT_FALSE(ElementStorage<std::string>::unboxed);
+    EXPECT_EQ(RRBVector<int>::leaf_capacity, 64);
+    EXPECT_EQ(RRBVector<double>::leaf_capacity, 64);
+    EXPECT_EQ(RRBVector<Pod64>::leaf_capacity, 16);
+    EXPECT_EQ(RRBVector<std::string>::leaf_capacity, RRBVector<std::string>::branching);
+}
+
+TEST_F(UnboxedStorageTest, PodArrayVersions) 
+{
+    std::vector<Pod64> values(100);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        values[i].values[0] = double(i);
+        values[i].values[7] = -double(i);
+    }
+    PersistentArray<Pod64> array(values.data(), values.size());
+    Pod64 changed{};
+    changed.values[3] = 42.0;
+    array.addVersion(0, 50, changed); // Version[1]
+    array.undo(); // Version[2]
+
+    std::vector<Pod64> version = array.getVersion(1);
+    EXPECT_EQ(version[50].values[3], 42.0);
+    EXPECT_EQ(version[49].values[7], -49.0);
+    EXPECT_EQ(array.getVersion(2)[50].values[0], 50.0);
+}
+
+TEST_F(UnboxedStorageTest, KernelsReadStorageDirectly) 
+{
+    std::vector<double> values;
+    for (int i = 0; i < 1000; ++i)
+    {
+        values.push_back(i % 7 - 3.0);
+    }
+    PersistentArray<double> array(values, values.size());
+    array.scaleVersion(0, 2.0); // Version[1]
+    EXPECT_DOUBLE_EQ(array.sumVersion(1), 2.0 * array.sumVersion(0));
+    EXPECT_EQ(array.maxVersion(1), 6.0);
+    EXPECT_EQ(array.countEqualElements(0, 1), 1000 / 7 + 1); // Only zeros survive scaling
+}
+
+TEST_F(UnboxedStorageTest, BoolArrayVersions) 
+{
+    EXPECT_FALSE(ElementStorage<bool>::unboxed); // std::vector<bool> cannot hold the slots
+    std::vector<bool> flags = { true, false, true };
+    PersistentArray<bool> array(flags, flags.size());
+    array.addVersion(0, 1, true); // Version[1]
+    array.undo(); // Version[2]
+    EXPECT_EQ(array.getVersion(1), std::vector<bool>({ true, true, true }));
+    EXPECT_EQ(array.getVersion(2), flags);
+
+    bool raw[] = { false, true };
+    PersistentArray<bool> from_raw(raw, 2);
+    PersistentArray<bool> from_range(flags.begin(), flags.end());
+    EXPECT_EQ(from_raw.getVersion(0), std::vector<bool>({ false, true }));
+    EXPECT_EQ(from_range.getVersion(0), flags);
+}
+
+TEST_F(UnboxedStorageTest, SequenceLeavesFollowElementSize) 
+{
+    std::vector<Pod64> values(50);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        values[i].values[0] = double(i);
+    }
+    PersistentSequence<Pod64> sequence(values, values.size());
+    sequence.insertVersion(0, 10, Pod64{}); // Version[1]
+    EXPECT_EQ(sequence.size(1), 51);
+    EXPECT_EQ(sequence.at(1, 11).values[0], 10.0);
+    EXPECT_EQ(sequence.getSequence(0).height(), 1); // 4 leaves of 16 elements under one root
+}
+
+// Value that counts how often it is copied
+struct CopyCounter
+{
+    static int copies;
+    std::string payload;
+
+    CopyCounter(std::string payload = "") : payload(std::move(payload)) {}
+    CopyCounter(const CopyCounter& other) : payload(other.payload) { ++copies; }
+    CopyCounter(CopyCounter&&) = default;
+    CopyCounter& operator=(const CopyCounter& other) { payload = other.payload; ++copies; return *this; }
+    CopyCounter& operator=(CopyCounter&&) = default;
+};
+
+int CopyCounter::copies = 0;
+
+// Test fixture for move-aware and emplace APIs
+class MoveSemanticsTest : public ::testing::Test 
+{
+protected:
+    void SetUp() override 
+    {
+        CopyCounter::copies = 0;
+    }
+};
+
+TEST_F(MoveSemanticsTest, ArrayEditsDoNotCopyValues) 
+{
+    std::vector<CopyCounter> values(4);
+    PersistentArray<CopyCounter> array(std::move(values), 4);
+    array.addVersion(0, 1, CopyCounter("moved")); // Version[1]
+    array.emplaceVersion(1, 2, "emplaced"); // Version[2]
+    array.undo(); // Version[3]
+    EXPECT_EQ(CopyCounter::copies, 0);
+    EXPECT_EQ(array.at(2, 1).payload, "moved");
+    EXPECT_EQ(array.at(2, 2).payload, "emplaced");
+    EXPECT_EQ(array.at(1, 2).payload, "");
+    EXPECT_THROW(array.at(2, 4), std::out_of_range);
+}
+
+TEST_F(MoveSemanticsTest, ListAndAssociativeArrayEditsDoNotCopyValues) 
+{
+    PersistentDoublyLinkedList<CopyCounter> list(std::vector<CopyCounter>(3), 3);
+    list.push_front(CopyCounter("front"));
+    list.emplace_back("back");
+    EXPECT_EQ(CopyCounter::copies, 0);
+
+    PersistentAssociativeArray<int, CopyCounter> map({ 2, 1, 3 }, std::vector<CopyCounter>(3), 3);
+    map.addVersion(0, 1, CopyCounter("one")); // Copies the node of key 2 on the path, which shares its boxed value
+    map.emplaceVersion(1, 4, "four"); // Copies the nodes of keys 2 and 3 on the path, not their values
+    EXPECT_EQ(CopyCounter::copies, 0);
+    std::vector<CopyCounter> latest = map.getVersion(2);
+    EXPECT_EQ(latest[0].payload, "one");
+    EXPECT_EQ(latest[3].payload, "four");
+}
+
+TEST_F(MoveSemanticsTest, MoveOnlyElements) 
+{
+    std::vector<std::unique_ptr<int>> values;
+    for (int i = 0; i < 3; ++i)
+    {
+        values.push_back(std::make_unique<int>(i));
+    }
+    PersistentArray<std::unique_ptr<int>> array(std::move(values), 3);
+    array.emplaceVersion(0, 1, new int(10)); // Version[1]
+    array.addVersion(1, 2, std::make_unique<int>(20)); // Version[2]
+    array.undo(); // Version[3]
+    EXPECT_EQ(*array.at(0, 1), 1);
+    EXPECT_EQ(*array.at(2, 1), 10);
+    EXPECT_EQ(*array.at(2, 2), 20);
+    EXPECT_EQ(array.at(3, 1).get(), array.at(1, 1).get()); // Versions share the element
+
+    PersistentDoublyLinkedList<std::unique_ptr<int>> list(std::vector<std::unique_ptr<int>>(), 0);
+    list.emplace_back(new int(1));
+    list.push_front(std::make_unique<int>(0));
+    WorkStealingPool pool(1);
+    int sum = 0;
+    list.parallel_for_each(pool, 1, [&sum](const std::unique_ptr<int>& value) { sum += *value * 10 + 1; });
+    EXPECT_EQ(sum, 12);
+}
+
+TEST_F(MoveSemanticsTest, MoveOnlyAssociativeArrayValues) 
+{
+    PersistentAssociativeArray<int, std::unique_ptr<int>> map;
+    map.addVersion(0, 2, std::make_unique<int>(2)); // Version[1]
+    map.emplaceVersion(1, 1, new int(1)); // Version[2], copies the node of key 2 on the path
+    map.addVersion(2, 3, std::make_unique<int>(3)); // Version[3]
+    map.eraseVersion(3, 2); // Version[4]
+    map.undo(); // Version[5], same as Version[3]
+    EXPECT_EQ(*map.at(2, 1), 1);
+    EXPECT_EQ(map.at(3, 2).get(), map.at(1, 2).get()); // Path copies share the value
+    EXPECT_THROW(map.at(4, 2), std::runtime_error);
+    EXPECT_EQ(map.size(5), 3u);
+
+    int sum = 0;
+    map.snapshot(3).forEach([&sum](int key, const std::unique_ptr<int>& value) { sum += key * *value; });
+    EXPECT_EQ(sum, 1 + 4 + 9);
+}
+
+// Test fixture for the B+-tree associative array
+class PersistentBTreeTest : public ::testing::Test 
+{
+protected:
+    PersistentBTreeAssociativeArray<int, int>* tree;
+
+    void SetUp() override 
+    {
+        std::vector<int> keys = { 3, 1, 2 };
+        int values[] = { 30, 10, 20 };
+        tree = new PersistentBTreeAssociativeArray<int, int>(keys, values, 3);
+    }
+
+    void TearDown() override 
+    {
+        delete tree;
+    }
+};
+
+TEST_F(PersistentBTreeTest, InitialVersion) 
+{
+    EXPECT_EQ(tree->getKeys(0), std::vector<int>({ 1, 2, 3 }));
+    EXPECT_EQ(tree->getVersion(0), std::vector<int>({ 10, 20, 30 }));
+    EXPECT_EQ(tree->find(0, 2), 20);
+    EXPECT_THROW(tree->find(0, 4), std::runtime_error);
+    EXPECT_THROW(tree->find(1, 2), std::out_of_range);
+    EXPECT_THROW(tree->eraseVersion(0, 4), std::runtime_error);
+    EXPECT_THROW(tree->addVersion(5, 4, 40), std::out_of_range);
+}
+
+TEST_F(PersistentBTreeTest, SplitsAndMergesMatchReference) 
+{
+    // Enough keys for a tree of three levels; every version is checked against a std::map
+    std::map<int, int> current = { { 1, 10 }, { 2, 20 }, { 3, 30 } };
+    std::map<int, std::map<int, int>> snapshots = { { 0, current } };
+    int version = 0;
+    for (int i = 0; i < 3000; ++i)
+    {
+        int key = (i * 7919) % 2000;
+        if (i % 3 == 2 && current.count(key))
+        {
+            tree->eraseVersion(version++, key);
+            current.erase(key);
+        }
+        else
+        {
+            tree->addVersion(version++, key, i);
+            current[key] = i;
+        }
+        if (version % 250 == 0)
+        {
+            snapshots[version] = current;
+        }
+    }
+    EXPECT_GE(tree->height(version), 2u);
+
+    for (const auto& snapshot : snapshots)
+    {
+        std::vector<int> keys;
+        std::vector<int> values;
+        for (const auto& entry : snapshot.second)
+        {
+            keys.push_back(entry.first);
+            values.push_back(entry.second);
+        }
+        EXPECT_EQ(tree->getKeys(snapshot.first), keys);
+        EXPECT_EQ(tree->getVersion(snapshot.first), values);
+        EXPECT_EQ(tree->size(snapshot.first), keys.size());
+    }
+
+    // Erase everything: merges shrink the tree back to an empty root
+    int full = version;
+    for (const auto& entry : current)
+    {
+        tree->eraseVersion(version++, entry.first);
+    }
+    EXPECT_EQ(tree->size(version), 0u);
+    EXPECT_EQ(tree->height(version), 0u);
+    EXPECT_FALSE(tree->begin(version).valid());
+    tree->addVersion(version, 5, 50);
+    EXPECT_EQ(tree->find(version + 1, 5), 50);
+    EXPECT_EQ(tree->size(full), current.size()); // Old versions untouched
+    EXPECT_EQ(tree->getKeys(full).size(), current.size());
+}
+
+TEST_F(PersistentBTreeTest, CursorAndRangeScan) 
+{
+    for (int key = 4; key <= 500; ++key)
+    {
+        tree->addVersion(key - 4, key * 2, key);
+    }
+    int last = 497;
+
+    auto cursor = tree->lowerBound(last, 101);
+    ASSERT_TRUE(cursor.valid());
+    EXPECT_EQ(cursor.key(), 102);
+    EXPECT_EQ(cursor.value(), 51);
+    EXPECT_FALSE(tree->lowerBound(last, 1001).valid());
+
+    std::vector<int> keys;
+    tree->forEachInRange(last, 3, 20, [&keys](int key, int) { keys.push_back(key); });
+    EXPECT_EQ(keys, std::vector<int>({ 3, 8, 10, 12, 14, 16, 18 }));
+
+    keys.clear();
+    tree->forEachInRange(2, 0, 100, [&keys](int key, int) { keys.push_back(key); });
+    EXPECT_EQ(keys, std::vector<int>({ 1, 2, 3, 8, 10 }));
+}
+
+TEST_F(PersistentBTreeTest, UndoRedoAndConvert) 
+{
+    tree->addVersion(0, 4, 40); // Version[1]
+    tree->undo(); // Version[2]
+    tree->redo(); // Version[3]
+    EXPECT_EQ(tree->size(2), 3u);
+    EXPECT_EQ(tree->find(3, 4), 40);
+
+    auto map = Convert<int>::convertBTreeToAssociativeArray(*tree, 3);
+    EXPECT_EQ(map.getKeys(0), std::vector<int>({ 1, 2, 3, 4 }));
+    EXPECT_EQ(map.find(0, 4), 40);
+    auto back = Convert<int>::convertAssociativeArrayToBTree(map);
+    EXPECT_EQ(back.getVersion(0), std::vector<int>({ 10, 20, 30, 40 }));
+}
+
+// Test fixture for the asynchronous snapshot export
+class SnapshotExportTest : public ::testing::Test 
+{
+protected:
+    std::string path = "snapshot_export_test.bin";
+
+    void TearDown() override 
+    {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(SnapshotExportTest, ExportWhileWriting) 
+{
+    std::vector<int> values(10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        values[i] = i;
+    }
+    PersistentArray<int> array(values, values.size());
+    array.addVersion(0, 0, -1); // Version[1]
+
+    SnapshotExporter exporter(1024);
+    std::future<size_t> done = exporter.exportToFile(array, { 1, 0 }, path);
+    for (int i = 1; i < 200; ++i)
+    {
+        array.addVersion(i, i, -i); // The writer keeps going during the export
+    }
+    size_t bytes = done.get();
+
+    SnapshotExporter::Reader reader(path);
+    size_t version = 0;
+    size_t count = 0;
+    ASSERT_TRUE(reader.next(version, count));
+    EXPECT_EQ(version, 1u);
+    ASSERT_EQ(count, 10000u);
+    std::vector<int> exported;
+    for (size_t i = 0; i < count; ++i)
+    {
+        exported.push_back(reader.read<int>());
+    }
+    EXPECT_EQ(exported, array.getVersion(1));
+    ASSERT_TRUE(reader.next(version, count));
+    EXPECT_EQ(version, 0u);
+    for (size_t i = 0; i < count; ++i)
+    {
+        EXPECT_EQ(reader.read<int>(), values[i]);
+    }
+    EXPECT_FALSE(reader.next(version, count));
+    EXPECT_EQ(bytes, 8 + 2 * (24 + 10000 * sizeof(int)));
+}
+
+TEST_F(SnapshotExportTest, SinkReceivesBoundedChunks) 
+{
+    std::vector<std::string> keys = { "b", "a", "c" };
+    int values[] = { 2, 1, 3 };
+    PersistentAssociativeArray<std::string, int> map(keys, values, 3);
+    map.addVersion(0, "d", 4);
+    PersistentDoublyLinkedList<std::string> list(std::vector<std::string>{ "x", "y" }, 2);
+    list.push_front("w");
+
+    SnapshotExporter exporter(16);
+    std::string stream;
+    size_t largest = 0;
+    bool finished = false;
+    auto sink = [&](const char* data, size_t size)
+    {
+        largest = std::max(largest, size);
+        finished = size == 0;
+        stream.append(data, size);
+    };
+    size_t bytes = exporter.exportVersions(map, { 1 }, sink).get();
+    EXPECT_EQ(bytes, stream.size());
+    EXPECT_TRUE(finished);
+    EXPECT_LT(largest, 16u + 40u); // One chunk plus at most a version header and the last record that crossed the limit
+
+    std::ofstream(path, std::ios::binary) << stream;
+    SnapshotExporter::Reader reader(path);
+    size_t version = 0;
+    size_t count = 0;
+    ASSERT_TRUE(reader.next(version, count));
+    ASSERT_EQ(count, 4u);
+    std::string key_order;
+    for (size_t i = 0; i < count; ++i)
+    {
+        key_order += reader.read<std::string>();
+        EXPECT_EQ(reader.read<int>(), static_cast<int>(i + 1));
+    }
+    EXPECT_EQ(key_order, "abcd");
+
+    exporter.exportToFile(list, { 0, 1 }, path).get();
+    SnapshotExporter::Reader list_reader(path);
+    ASSERT_TRUE(list_reader.next(version, count));
+    EXPECT_EQ(count, 2u);
+    list_reader.read<std::string>();
+    list_reader.read<std::string>();
+    ASSERT_TRUE(list_reader.next(version, count));
+    EXPECT_EQ(count, 3u);
+    EXPECT_EQ(list_reader.read<std::string>(), "w");
+}
+
+TEST_F(SnapshotExportTest, Errors) 
+{
+    int values[] = { 1, 2, 3 };
+    PersistentArray<int> array(values, 3);
+    SnapshotExporter exporter;
+    EXPECT_THROW(exporter.exportVersions(array, { 1 }, [](const char*, size_t) {}), std::out_of_range);
+
+    auto failing = exporter.exportVersions(array, { 0 }, [](const char*, size_t) { throw std::runtime_error("disk full"); });
+    EXPECT_THROW(failing.get(), std::runtime_error);
+    EXPECT_THROW(SnapshotExporter::Reader("missing_snapshot.bin"), std::runtime_error);
+}
+
+TEST_F(SnapshotExportTest, KeepsTimesAndTags) 
+{
+    int values[] = { 1, 2, 3 };
+    PersistentArray<int> array(values, 3);
+    array.addVersion(0, 0, 10);
+    array.tagVersion("release", 1);
+    array.tagVersion("approved", 1);
+
+    SnapshotExporter exporter;
+    exporter.exportToFile(array, { 1, 0 }, path).get();
+    SnapshotExporter::Reader reader(path);
+    size_t version = 0;
+    size_t count = 0;
+    ASSERT_TRUE(reader.next(version, count));
+    EXPECT_EQ(reader.time(), array.versionTime(1));
+    EXPECT_EQ(reader.tags(), std::vector<std::string>({ "approved", "release" }));
+    for (size_t i = 0; i < count; ++i)
+    {
+        reader.read<int>();
+    }
+    ASSERT_TRUE(reader.next(version, count));
+    EXPECT_EQ(reader.time(), array.versionTime(0));
+    EXPECT_TRUE(reader.tags().empty());
+}
+
+// Test fixture for the workspace of containers versioned together
+class PersistentWorkspaceTest : public ::testing::Test 
+{
+protected:
+    using Workspace = PersistentWorkspace<PersistentArray<int>, PersistentDoublyLinkedList<int>, PersistentAssociativeArray<int, int>>;
+
+    PersistentArray<int>* array;
+    PersistentDoublyLinkedList<int>* list;
+    PersistentAssociativeArray<int, int>* map;
+
+    void SetUp() override 
+    {
+        int values[] = { 0, 0, 0 };
+        array = new PersistentArray<int>(values, 3);
+        list = new PersistentDoublyLinkedList<int>(values, 1);
+        std::vector<int> keys = { 0 };
+        map = new PersistentAssociativeArray<int, int>(keys, values, 1);
+    }
+
+    void TearDown() override 
+    {
+        delete array;
+        delete list;
+        delete map;
+    }
+
+    // Method to set array[0], push to the list and insert into the map in one composite version
+    static size_t step(Workspace& workspace, int value)
+    {
+        return workspace.commit([value](const Workspace::Composite& v, PersistentArray<int>& a, PersistentDoublyLinkedList<int>& l, PersistentAssociativeArray<int, int>& m)
+        {
+            a.addVersion(static_cast<int>(v[0]), 0, value);
+            l.push_front(value);
+            m.addVersion(static_cast<int>(v[2]), value, value);
+        });
+    }
+};
+
+TEST_F(PersistentWorkspaceTest, CommitAndGlobalUndoRedo) 
+{
+    Workspace workspace(*array, *list, *map);
+    EXPECT_EQ(step(workspace, 1), 1u);
+    array->undo(); // Member-level edits outside the workspace are not part of a composite version
+    EXPECT_EQ(step(workspace, 2), 2u);
+    EXPECT_EQ(workspace.version(2), (Workspace::Composite{ { 3, 2, 2 } }));
+
+    workspace.undo(); // Version[3] = Version[1]
+    EXPECT_EQ(workspace.version(3), workspace.version(1));
+    workspace.redo(); // Version[4] = Version[2]
+    EXPECT_EQ(workspace.version(4), workspace.version(2));
+    EXPECT_EQ(workspace.versionCount(), 5u);
+
+    int first = workspace.read(3, [](const Workspace::Composite& v, const PersistentArray<int>& a, const PersistentDoublyLinkedList<int>& l, const PersistentAssociativeArray<int, int>& m)
+    {
+        EXPECT_EQ(l.getVersion(v[1]), std::vector<int>({ 1, 0 }));
+        EXPECT_EQ(m.getKeys(v[2]), std::vector<int>({ 0, 1 }));
+        return a.at(v[0], 0);
+    });
+    EXPECT_EQ(first, 1);
+    EXPECT_THROW(workspace.version(5), std::out_of_range);
+    EXPECT_EQ(array->versionCount(), 4u); // Global undo/redo did not touch the members
+}
+
+TEST_F(PersistentWorkspaceTest, PartialCommitAfterUndoKeepsUndoneMembers) 
+{
+    Workspace workspace(*array, *list, *map);
+    step(workspace, 1); // Version[1] = { 1, 1, 1 }
+    workspace.undo(); // Version[2] = Version[0]
+    size_t committed = workspace.commit([](const Workspace::Composite& v, PersistentArray<int>& a, PersistentDoublyLinkedList<int>&, PersistentAssociativeArray<int, int>&)
+    {
+        a.addVersion(static_cast<int>(v[0]), 1, 7); // Only the array is edited
+    });
+    EXPECT_EQ(workspace.version(committed), (Workspace::Composite{ { 2, 0, 0 } }));
+    EXPECT_EQ(array->getVersion(2), std::vector<int>({ 0, 7, 0 }));
+}
+
+TEST_F(PersistentWorkspaceTest, ConcurrentReadersSeeConsistentVersions) 
+{
+    Workspace workspace(*array, *list, *map);
+    std::atomic<bool> done{ false };
+    std::atomic<int> inconsistent{ 0 };
+    std::atomic<int> reads{ 0 };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r)
+    {
+        readers.emplace_back([&]
+        {
+            while (!done.load() || reads.load() < 10)
+            {
+                workspace.readLatest([&](const Workspace::Composite& v, const PersistentArray<int>& a, const PersistentDoublyLinkedList<int>& l, const PersistentAssociativeArray<int, int>& m)
+                {
+                    int value = a.at(v[0], 0);
+                    if (l.getVersion(v[1]).front() != value || m.size(v[2]) != static_cast<size_t>(value) + 1)
+                    {
+                        inconsistent++;
+                    }
+                });
+                reads++;
+            }
+        });
+    }
+    for (int i = 1; i <= 300; ++i)
+    {
+        step(workspace, i);
+    }
+    done = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(inconsistent.load(), 0);
+    EXPECT_EQ(workspace.latestVersion(), 300u);
+}
+
+// Test fixture for workload traces
+class WorkloadTraceTest : public ::testing::Test 
+{
+protected:
+    std::string path = "workload_trace_test.trace";
+
+    void TearDown() override 
+    {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(WorkloadTraceTest, RecordSaveLoadReplay) 
+{
+    int values[] = { 5, 6, 7, 8 };
+    PersistentArray<int> array(values, 4);
+    array.addVersion(0, 0, 1); // History before the recording is not part of the trace
+
+    TraceRecorder<PersistentArray<int>> recorder(array);
+    recorder.addVersion(1, 3, 100);
+    recorder.addVersion(2, 1, 200);
+    EXPECT_EQ(recorder.getVersion(3), std::vector<int>({ 1, 200, 7, 100 }));
+    recorder.undo();
+    recorder.redo();
+    auto list = recorder.convert(3, [](const PersistentArray<int>& source, size_t idx) { return Convert<int>::convertArrayToList(source, idx); });
+    EXPECT_EQ(list.getVersion(0).size(), 4u);
+    EXPECT_THROW(recorder.addVersion(0, 9, 1), std::out_of_range);
+    recorder.save(path);
+
+    WorkloadTrace trace = WorkloadTrace::load(path);
+    EXPECT_EQ(trace.container, TraceContainer::Array);
+    EXPECT_EQ(trace.base_size, 4u);
+    ASSERT_EQ(trace.records.size(), 6u); // The failed call was not recorded
+    EXPECT_EQ(trace.records[0].op, TraceOp::AddVersion);
+    EXPECT_EQ(trace.records[0].version, 0u);
+    EXPECT_EQ(trace.records[0].argument, 3u);
+    EXPECT_EQ(trace.records[2].version, 2u);
+    EXPECT_EQ(trace.records[5].op, TraceOp::Convert);
+    EXPECT_EQ(trace.records[5].argument, static_cast<std::uint64_t>(TraceContainer::List));
+
+    LatencyRecorder latencies;
+    EXPECT_EQ(TraceReplayer::replay(trace, latencies), 6u);
+    EXPECT_EQ(latencies.histogram(LatencyOp::AddVersion).count(), 2u);
+    EXPECT_EQ(latencies.histogram(LatencyOp::Convert).count(), 1u);
+}
+
+TEST_F(WorkloadTraceTest, KeysBecomeDenseIds) 
+{
+    std::vector<std::string> keys = { "pear", "apple" };
+    int values[] = { 1, 2 };
+    PersistentAssociativeArray<std::string, int> map(keys, values, 2);
+    TraceRecorder<PersistentAssociativeArray<std::string, int>> recorder(map);
+    recorder.addVersion(0, "zebra", 3);
+    recorder.eraseVersion(1, "apple");
+    recorder.addVersion(2, "pear", 4);
+
+    const WorkloadTrace& trace = recorder.trace();
+    EXPECT_EQ(trace.records[0].argument, 2u); // New key
+    EXPECT_EQ(trace.records[1].argument, 0u); // "apple" is the smallest base key
+    EXPECT_EQ(trace.records[2].argument, 1u);
+
+    LatencyRecorder latencies;
+    EXPECT_EQ(TraceReplayer::replay(trace, latencies), 3u);
+    EXPECT_EQ(latencies.histogram(LatencyOp::EraseVersion).count(), 1u);
+
+    std::ofstream(path, std::ios::binary) << "not a trace";
+    EXPECT_THROW(WorkloadTrace::load(path), std::runtime_error);
+}
+
+// Test fixture for the cache of materialized versions
+class VersionCacheTest : public ::testing::Test 
+{
+protected:
+    PersistentArray<int>* array;
+
+    void SetUp() override 
+    {
+        std::vector<int> values(100);
+        array = new PersistentArray<int>(values, 100);
+        for (int i = 0; i < 5; ++i)
+        {
+            array->addVersion(i, i, i + 1);
+        }
+    }
+
+    void TearDown() override 
+    {
+        delete array;
+    }
+};
+
+TEST_F(VersionCacheTest, HitsReturnTheSameView) 
+{
+    VersionCache<PersistentArray<int>> cache(*array, 1 << 20);
+    auto first = cache.get(3);
+    auto second = cache.get(3);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(*first, array->getVersion(3));
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.bytes(), VersionCache<PersistentArray<int>>::bytesOf(*first));
+}
+
+TEST_F(VersionCacheTest, EvictsLeastRecentlyUsed) 
+{
+    size_t entry = VersionCache<PersistentArray<int>>::bytesOf(array->getVersion(0));
+    VersionCache<PersistentArray<int>> cache(*array, 2 * entry);
+    auto oldest = cache.get(0);
+    cache.get(1);
+    cache.get(0); // Version 1 is now the least recently used
+    cache.get(2);
+    EXPECT_EQ(cache.evictions(), 1u);
+    EXPECT_EQ(cache.size(), 2u);
+
+    cache.get(0);
+    EXPECT_EQ(cache.hits(), 2u);
+    cache.get(1);
+    EXPECT_EQ(cache.misses(), 4u);
+    EXPECT_EQ((*oldest)[0], 0); // Views outlive their entries
+
+    cache.setCapacity(entry / 2);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.bytes(), 0u);
+    EXPECT_EQ(*cache.get(5), array->getVersion(5)); // Too large to keep, still returned
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+// Test fixture for incremental materialization of versions
+class IncrementalMaterializationTest : public ::testing::Test 
+{
+protected:
+    PersistentArray<int>* array;
+
+    void SetUp() override 
+    {
+        std::vector<int> values(1000);
+        for (int i = 0; i < 1000; ++i)
+        {
+            values[i] = i;
+        }
+        array = new PersistentArray<int>(values, 1000);
+    }
+
+    void TearDown() override 
+    {
+        delete array;
+    }
+};
+
+TEST_F(IncrementalMaterializationTest, SequentialScanWritesOnlyEdits) 
+{
+    for (int i = 0; i < 50; ++i)
+    {
+        array->addVersion(i, (i * 37) % 1000, -i);
+    }
+    array->undo(); // Version[51] = Version[49]
+    array->addVersion(10, 5, 555); // Version[52], a branch from Version[10]
+
+    std::vector<int> buffer = array->getVersion(0);
+    for (size_t k = 1; k <= 52; ++k)
+    {
+        size_t written = array->updateVersion(buffer, k - 1, k);
+        EXPECT_EQ(buffer, array->getVersion(k));
+        if (k <= 50)
+        {
+            EXPECT_EQ(written, 1u);
+        }
+    }
+    EXPECT_EQ(array->updateVersion(buffer, 52, 52), 0u);
+    EXPECT_EQ(array->getVersion(3, buffer, 52), array->getVersion(3)); // Back across the branch
+}
+
+TEST_F(IncrementalMaterializationTest, RewritesAndErrors) 
+{
+    array->addVersion(0, 1, 7);
+    array->scaleVersion(1, 2); // Version[2] rewrites every element
+    array->addVersion(2, 0, 9);
+
+    std::vector<int> buffer = array->getVersion(1);
+    EXPECT_EQ(array->updateVersion(buffer, 1, 3), 1000u);
+    EXPECT_EQ(buffer, array->getVersion(3));
+    EXPECT_EQ(array->updateVersion(buffer, 3, 2), 1u);
+
+    std::vector<int> wrong_size(3);
+    EXPECT_THROW(array->updateVersion(wrong_size, 0, 1), std::invalid_argument);
+    EXPECT_THROW(array->updateVersion(buffer, 0, 9), std::out_of_range);
+}
+
+// Test fixture for the list cursor
+class ListCursorTest : public ::testing::Test 
+{
+protected:
+    PersistentDoublyLinkedList<int>* list;
+
+    void SetUp() override 
+    {
+        int values[] = { 1, 2, 3, 4 };
+        list = new PersistentDoublyLinkedList<int>(values, 4);
+    }
+
+    void TearDown() override 
+    {
+        delete list;
+    }
+};
+
+TEST_F(ListCursorTest, EditsAtTheFocus) 
+{
+    ListCursor<int> start = list->cursor(0, 1);
+    EXPECT_EQ(start.focus(), 2);
+    EXPECT_EQ(start.position(), 1u);
+
+    ListCursor<int> inserted = start.insert(10); // {1, 10, 2, 3, 4}
+    ListCursor<int> replaced = inserted.moveRight().moveRight().replace(30); // {1, 10, 2, 30, 4}
+    ListCursor<int> erased = replaced.moveLeft().moveLeft().erase(); // {1, 2, 30, 4}
+    EXPECT_EQ(inserted.toVector(), std::vector<int>({ 1, 10, 2, 3, 4 }));
+    EXPECT_EQ(replaced.toVector(), std::vector<int>({ 1, 10, 2, 30, 4 }));
+    EXPECT_EQ(erased.toVector(), std::vector<int>({ 1, 2, 30, 4 }));
+    EXPECT_EQ(erased.focus(), 2);
+    EXPECT_EQ(start.toVector(), std::vector<int>({ 1, 2, 3, 4 })); // Older cursors are unchanged
+
+    ListCursor<int> end = list->cursor(0, 4);
+    EXPECT_TRUE(end.atEnd());
+    EXPECT_THROW(end.focus(), std::out_of_range);
+    EXPECT_THROW(end.moveRight(), std::out_of_range);
+    EXPECT_EQ(end.insert(5).toVector(), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_THROW(list->cursor(0, 0).moveLeft(), std::out_of_range);
+    EXPECT_THROW(list->cursor(0, 5), std::out_of_range);
+}
+
+TEST_F(ListCursorTest, CommitAndSharedTail) 
+{
+    ListCursor<int> cursor = list->cursor(0, 0).erase().erase(); // {3, 4}, read lazily from the list
+    list->push_back(5); // Links a node after the shared tail of version 0
+    EXPECT_EQ(cursor.toVector(), std::vector<int>({ 3, 4 }));
+    EXPECT_EQ(cursor.size(), 2u);
+
+    list->commit(cursor.moveRight().insert(7)); // Version[2]
+    EXPECT_EQ(list->getVersion(2), std::vector<int>({ 3, 7, 4 }));
+    EXPECT_EQ(list->memoryStats(2).version_nodes, 2u); // 3 and 7 are new, the unvisited 4 is shared with version 0
+
+    // Editor-like workload: many edits around a moving position, each O(1)
+    ListCursor<int> editor = list->cursor(2, 1);
+    for (int i = 0; i < 1000; ++i)
+    {
+        editor = editor.insert(i).moveRight();
+    }
+    EXPECT_EQ(editor.size(), 1003u);
+    EXPECT_EQ(editor.focus(), 7);
+    EXPECT_EQ(editor.position(), 1001u);
+}
+
+TEST_F(ListCursorTest, LongCursorIsReleased) 
+{
+    std::vector<int> values(1000000, 1);
+    PersistentDoublyLinkedList<int> long_list(values, static_cast<int>(values.size()));
+    {
+        ListCursor<int> cursor = long_list.cursor(0, values.size() - 1).insert(2);
+        EXPECT_EQ(cursor.position(), values.size() - 1);
+        long_list.commit(cursor);
+    } // A million cells are released without recursion
+    EXPECT_EQ(long_list.getVersion(1).size(), values.size() + 1);
+    EXPECT_EQ(long_list.memoryStats(1).version_nodes, values.size());
+}
+
+
+// Test fixture for streaming loaders
+class StreamingLoaderTest : public ::testing::Test 
+{
+protected:
+    std::string path = "streaming_loader_test.data";
+
+    void write(const std::string& contents)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    void TearDown() override 
+    {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(StreamingLoaderTest, IteratorConstructors) 
+{
+    std::list<int> values = { 3, 1, 2 };
+    std::istringstream text("4 5 6");
+    std::istream_iterator<int> begin(text), end;
+    PersistentArray<int> array(values.begin(), values.end());
+    PersistentDoublyLinkedList<int> list(begin, end);
+    PersistentSequence<int> sequence(values.begin(), values.end());
+    EXPECT_EQ(array.getVersion(0), std::vector<int>({ 3, 1, 2 }));
+    EXPECT_EQ(list.getVersion(0), std::vector<int>({ 4, 5, 6 }));
+    EXPECT_EQ(sequence.getVersion(0), std::vector<int>({ 3, 1, 2 }));
+
+    std::vector<std::pair<int, std::string>> pairs = { { 2, "b" }, { 1, "a" }, { 2, "c" } };
+    PersistentAssociativeArray<int, std::string> map(pairs.begin(), pairs.end());
+    PersistentBTreeAssociativeArray<int, std::string> tree(pairs.begin(), pairs.end());
+    EXPECT_EQ(map.getKeys(0), std::vector<int>({ 1, 2 }));
+    EXPECT_EQ(tree.getVersion(0), std::vector<std::string>({ "a", "c" })); // Last duplicate wins
+    EXPECT_EQ(map.getVersion(0), tree.getVersion(0));
+
+    PersistentHashMap<int, std::string> hash_map(pairs.begin(), pairs.end());
+    RerootingPersistentArray<int> rerooting(values.begin(), values.end());
+    EXPECT_EQ(hash_map.size(0), 2);
+    EXPECT_EQ(hash_map.find(0, 2), "c");
+    EXPECT_EQ(rerooting.getVersion(0), std::vector<int>({ 3, 1, 2 }));
+    EXPECT_THROW((PersistentHashMap<int, std::string>(pairs.end(), pairs.end())), std::invalid_argument);
+
+    // Large enough to span several leaves of the sequence
+    std::vector<int> many;
+    std::string many_text;
+    for (int i = 0; i < 5000; ++i)
+    {
+        many.push_back(i);
+        many_text += std::to_string(i) + " ";
+    }
+    std::istringstream many_stream(many_text);
+    PersistentSequence<int> long_sequence{ std::istream_iterator<int>(many_stream), std::istream_iterator<int>() };
+    EXPECT_EQ(long_sequence.getVersion(0), many);
+}
+
+TEST_F(StreamingLoaderTest, SortedPairsAreStreamed) 
+{
+    // Every key twice in a row, the second value wins; inserting these one by one would be O(n^2)
+    const int count = 300000;
+    std::vector<std::pair<long long, long long>> pairs;
+    for (int i = 0; i < 2 * count; ++i)
+    {
+        pairs.emplace_back(i / 2, i);
+    }
+    PersistentAssociativeArray<long long, long long, SumAggregate<long long>> map(pairs.begin(), pairs.end());
+    PersistentBTreeAssociativeArray<long long, long long> tree(pairs.begin(), pairs.end());
+    ASSERT_EQ(map.size(0), static_cast<size_t>(count));
+    EXPECT_EQ(map.find(0, 1000), 2001);
+    EXPECT_EQ(map.rangeAggregate(0, 0, 10), 100); // 1 + 3 + ... + 19
+    EXPECT_EQ(map.getVersion(0), tree.getVersion(0));
+    EXPECT_EQ(tree.size(0), static_cast<size_t>(count));
+    EXPECT_EQ(tree.find(0, count - 1), 2 * count - 1);
+
+    // A key out of order ends the streaming, the rest is inserted or sorted with what was loaded
+    std::vector<std::pair<int, std::string>> mixed = { { 1, "a" }, { 3, "b" }, { 5, "c" }, { 2, "d" }, { 3, "e" }, { 0, "f" } };
+    PersistentAssociativeArray<int, std::string> mixed_map(mixed.begin(), mixed.end());
+    PersistentBTreeAssociativeArray<int, std::string> mixed_tree(mixed.begin(), mixed.end());
+    EXPECT_EQ(mixed_map.getKeys(0), std::vector<int>({ 0, 1, 2, 3, 5 }));
+    EXPECT_EQ(mixed_map.getVersion(0), std::vector<std::string>({ "f", "a", "d", "e", "c" }));
+    EXPECT_EQ(mixed_tree.getVersion(0), mixed_map.getVersion(0));
+    EXPECT_EQ(mixed_tree.size(0), 5u);
+}
+
+TEST_F(StreamingLoaderTest, BinaryRecords) 
+{
+    std::vector<double> values = { 1.5, -2.0, 3.25 };
+    write(std::string(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double)));
+
+    BinaryRecords<double> records(path);
+    EXPECT_EQ(records.size(), 3u);
+    PersistentArray<double> array(records.begin(), records.end());
+    EXPECT_EQ(array.getVersion(0), values);
+
+    write("12345");
+    EXPECT_THROW(BinaryRecords<double>{ path }, std::runtime_error);
+    EXPECT_THROW(BinaryRecords<double>{ "missing_loader_file.data" }, std::runtime_error);
+}
+
+TEST_F(StreamingLoaderTest, CsvRows) 
+{
+    write("key,value\r\n3,0.5\r\n1, 2.25,ignored\r\n\r\n2,-1\n");
+    CsvRows<std::pair<int, double>> rows(path, true);
+    PersistentAssociativeArray<int, double> map(rows.begin(), rows.end());
+    EXPECT_EQ(map.getKeys(0), std::vector<int>({ 1, 2, 3 }));
+    EXPECT_EQ(map.getVersion(0), std::vector<double>({ 2.25, -1.0, 0.5 }));
+
+    write("x,first\ny,second");
+    CsvRows<std::pair<std::string, std::string>> strings(path);
+    PersistentBTreeAssociativeArray<std::string, std::string> tree(strings.begin(), strings.end());
+    EXPECT_EQ(tree.find(0, "y"), "second");
+
+    write("1\n2\nthree\n");
+    CsvRows<int> invalid(path);
+    EXPECT_THROW(PersistentArray<int>(invalid.begin(), invalid.end()), std::runtime_error);
+    write("1\n2\n");
+    CsvRows<std::pair<int, int>> one_column(path);
+    EXPECT_THROW(one_column.begin(), std::runtime_error); // Rows need a key and a value
+}
+
+TEST_F(StreamingLoaderTest, ParallelParseMatchesSequential) 
+{
+    std::string contents;
+    for (int i = 0; i < 30000; ++i)
+    {
+        contents += std::to_string(i * 7) + (i % 1000 == 0 ? "\n\n" : "\n");
+    }
+    write(contents);
+
+    CsvRows<long> rows(path);
+    WorkStealingPool pool(4);
+    std::vector<long> parsed = rows.parseParallel(pool);
+    EXPECT_EQ(parsed, std::vector<long>(rows.begin(), rows.end()));
+    EXPECT_EQ(parsed.size(), 30000u);
+    EXPECT_EQ(parsed.back(), 29999 * 7);
+
+    write("");
+    EXPECT_TRUE(CsvRows<long>(path).parseParallel(pool).empty());
+    EXPECT_TRUE(CsvRows<long>(path).begin() == CsvRows<long>(path).end());
+}
+
+
+// Test fixture for PersistentShardedAssociativeArray tests
+class ShardedAssociativeArrayTest : public ::testing::Test 
+{
+protected:
+    PersistentShardedAssociativeArray<int, int>* map;
+
+    void SetUp() override 
+    {
+        std::vector<std::pair<int, int>> pairs = { { 1, 10 }, { 2, 20 }, { 3, 30 }, { 4, 40 } };
+        map = new PersistentShardedAssociativeArray<int, int>(3, pairs.begin(), pairs.end());
+    }
+
+    void TearDown() override 
+    {
+        delete map;
+    }
+};
+
+TEST_F(ShardedAssociativeArrayTest, GlobalVersions) 
+{
+    EXPECT_EQ(map->getKeys(0), std::vector<int>({ 1, 2, 3, 4 }));
+    map->insert(5, 50);
+    map->erase(1);
+    EXPECT_EQ(map->versionCount(), 1u); // Writes are not visible until committed
+    EXPECT_EQ(map->snapshotLatest().size(), 4u);
+    EXPECT_EQ(map->commit(), 1u);
+    EXPECT_EQ(map->getVersion(1), std::vector<int>({ 20, 30, 40, 50 }));
+    EXPECT_EQ(map->getVersion(0), std::vector<int>({ 10, 20, 30, 40 }));
+    EXPECT_EQ(map->find(1, 5), 50);
+    EXPECT_THROW(map->find(1, 1), std::runtime_error);
+    EXPECT_THROW(map->erase(1), std::runtime_error);
+    EXPECT_THROW(map->version(2), std::out_of_range);
+
+    // Undo drops the uncommitted write and continues from version 0
+    map->insert(6, 60);
+    map->undo(); // Version[2]
+    map->insert(7, 70);
+    map->commit(); // Version[3]
+    EXPECT_EQ(map->getKeys(3), std::vector<int>({ 1, 2, 3, 4, 7 }));
+    map->undo(); // Version[4], equal to version 2
+    map->redo(); // Version[5], equal to version 3
+    EXPECT_EQ(map->version(5), map->version(3));
+
+    PersistentShardedAssociativeArray<int, int> empty(2);
+    EXPECT_EQ(empty.size(0), 0u);
+    EXPECT_THROW((PersistentShardedAssociativeArray<int, int>(0)), std::invalid_argument);
+}
+
+TEST_F(ShardedAssociativeArrayTest, ParallelWritersAndAtomicSnapshots) 
+{
+    const int writers = 4, per_writer = 500;
+    std::atomic<bool> done{ false };
+    std::atomic<int> torn{ 0 };
+
+    // Every writer inserts i then i + 1000000 for its keys; a consistent cut never holds the second without the first
+    std::thread reader([&]
+    {
+        while (!done)
+        {
+            auto snapshot = map->snapshotLatest();
+            snapshot.forEach([&](int key, int) { torn += key >= 1000000 && !snapshot.contains(key - 1000000) ? 1 : 0; });
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w)
+    {
+        threads.emplace_back([&, w]
+        {
+            for (int i = 0; i < per_writer; ++i)
+            {
+                int key = 100 + w * per_writer + i;
+                map->insert(key, key);
+                map->insert(key + 1000000, key);
+                if (i % 100 == 0)
+                {
+                    map->commit();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    done = true;
+    reader.join();
+
+    size_t latest = map->commit();
+    EXPECT_EQ(map->size(latest), 4u + 2 * writers * per_writer);
+    EXPECT_EQ(map->find(latest, 100 + 3 * per_writer + 7 + 1000000), 100 + 3 * per_writer + 7);
+    EXPECT_EQ(torn.load(), 0);
+    for (size_t i = 1; i < map->versionCount(); ++i)
+    {
+        auto snapshot = map->snapshot(i);
+        snapshot.forEach([&](int key, int) { torn += key >= 1000000 && !snapshot.contains(key - 1000000) ? 1 : 0; });
+    }
+    EXPECT_EQ(torn.load(), 0);
+}
+
+
+// Test fixture for hash-consing in PersistentAssociativeArray
+class HashConsingTest : public ::testing::Test 
+{
+protected:
+    PersistentAssociativeArray<int, std::string>* map;
+
+    void SetUp() override 
+    {
+        std::vector<int> keys = { 4, 2, 6, 1, 3, 5, 7 };
+        std::vector<std::string> values = { "d", "b", "f", "a", "c", "e", "g" };
+        map = new PersistentAssociativeArray<int, std::string>(keys, values, values.size());
+    }
+
+    void TearDown() override 
+    {
+        delete map;
+    }
+};
+
+TEST_F(HashConsingTest, RevertedVersionsShareNodes) 
+{
+    map->enableHashConsing();
+    map->addVersion(0, 3, "on"); // Version[1]: copies 4, 2, 3
+    EXPECT_EQ(map->memoryStats(1).version_nodes, 3u);
+    map->addVersion(1, 3, "c"); // Version[2]: same contents as version 0
+    EXPECT_EQ(map->memoryStats(2).version_nodes, 0u);
+    EXPECT_EQ(map->getVersion(2), map->getVersion(0));
+
+    // The same edit on another branch reuses the first branch's path
+    map->addVersion(0, 3, "on"); // Version[3]
+    EXPECT_EQ(map->memoryStats(3).version_nodes, 0u);
+    map->addVersion(2, 7, "on"); // Version[4]
+    map->addVersion(4, 3, "on"); // Version[5]: only the root is new, 2 and 3 are shared with version 1
+    EXPECT_EQ(map->memoryStats(5).version_nodes, 1u);
+    EXPECT_EQ(map->getKeys(5), map->getKeys(0));
+    EXPECT_EQ(map->find(5, 7), "on");
+    EXPECT_GE(map->hashConsHits(), 5u);
+
+    map->eraseVersion(5, 6); // Version[6]
+    EXPECT_EQ(map->getKeys(6), std::vector<int>({ 1, 2, 3, 4, 5, 7 }));
+    EXPECT_EQ(map->getVersion(5), std::vector<std::string>({ "a", "b", "on", "d", "e", "f", "on" }));
+}
+
+TEST_F(HashConsingTest, DisabledByDefault) 
+{
+    map->addVersion(0, 3, "on");
+    map->addVersion(1, 3, "c");
+    EXPECT_EQ(map->memoryStats(2).version_nodes, 3u);
+    EXPECT_EQ(map->hashConsHits(), 0u);
+
+    map->enableHashConsing();
+    map->addVersion(2, 3, "on"); // Interned from version 1
+    EXPECT_EQ(map->memoryStats(3).version_nodes, 0u);
+    map->disableHashConsing();
+    map->addVersion(2, 3, "on");
+    EXPECT_EQ(map->memoryStats(4).version_nodes, 3u);
+}
+
+TEST_F(HashConsingTest, TableIsCounted) 
+{
+    MemoryStats plain = map->memoryStats(0);
+    EXPECT_EQ(plain.table_bytes, 0u);
+
+    map->enableHashConsing(); // Interns the 7 nodes of version 0
+    MemoryStats interned = map->memoryStats(0);
+    EXPECT_GE(interned.table_bytes, 7 * (sizeof(void*) + sizeof(std::weak_ptr<int>)));
+    EXPECT_EQ(interned.total_bytes, plain.total_bytes + interned.table_bytes);
+
+    // Interned nodes own a separate control block: one more allocation and its node pointer each,
+    // plus the boxed value
+    map->addVersion(0, 3, "on");
+    MemoryStats edited = map->memoryStats(1);
+    EXPECT_EQ(edited.allocation_count, plain.allocation_count + 7);
+    EXPECT_EQ(edited.version_unique_bytes, 3 * (sharedAllocationBytes<AA_node<int, std::string>>() + sizeof(void*)) +
+        sharedAllocationBytes<std::string>());
+    EXPECT_GT(edited.table_bytes, interned.table_bytes);
+}
+
+
+// Test fixture for PersistentCompactAssociativeArray tests
+class CompactAssociativeArrayTest : public ::testing::Test 
+{
+protected:
+    PersistentCompactAssociativeArray<int, int>* map;
+
+    void SetUp() override 
+    {
+        std::vector<int> keys = { 4, 2, 6, 1, 3, 5, 7 };
+        std::vector<int> values = { 40, 20, 60, 10, 30, 50, 70 };
+        map = new PersistentCompactAssociativeArray<int, int>(keys, values, values.size());
+    }
+
+    void TearDown() override 
+    {
+        delete map;
+    }
+};
+
+TEST_F(CompactAssociativeArrayTest, MatchesAssociativeArray) 
+{
+    EXPECT_LE(sizeof(AA_compact_node<int, int>), 16u);
+    std::vector<int> keys = map->getKeys(0);
+    std::vector<int> values = map->getVersion(0);
+    PersistentAssociativeArray<int, int> reference(keys, values, values.size());
+
+    for (int i = 0; i < 200; ++i)
+    {
+        int key = (i * 37) % 23;
+        if (i % 5 == 4 && reference.size(i) > 0)
+        {
+            int erased = reference.getKeys(i)[i % reference.size(i)];
+            map->eraseVersion(i, erased);
+            reference.eraseVersion(i, erased);
+        }
+        else
+        {
+            map->addVersion(i, key, i);
+            reference.addVersion(i, key, i);
+        }
+    }
+    for (size_t i = 0; i < map->versionCount(); i += 13)
+    {
+        EXPECT_EQ(map->getKeys(i), reference.getKeys(i));
+        EXPECT_EQ(map->getVersion(i), reference.getVersion(i));
+        EXPECT_EQ(map->size(i), reference.size(i));
+    }
+    EXPECT_EQ(map->find(200, 1), reference.find(200, 1));
+    EXPECT_THROW(map->find(0, 100), std::runtime_error);
+    EXPECT_THROW(map->addVersion(500, 1, 1), std::out_of_range);
+
+    map->undo(); // Version[201], equal to version 199
+    map->redo(); // Version[202], equal to version 200
+    EXPECT_EQ(map->getVersion(201), reference.getVersion(199));
+    EXPECT_EQ(map->getVersion(202), reference.getVersion(200));
+}
+
+TEST_F(CompactAssociativeArrayTest, DropAndCompact) 
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        map->addVersion(i, i % 7 + 1, i); // Three new nodes or fewer per version
+    }
+    std::vector<int> latest = map->getVersion(100);
+    size_t before = map->nodeCount();
+
+    // A sliding window keeps only the last versions
+    for (size_t i = 0; i < 95; ++i)
+    {
+        map->dropVersion(i);
+    }
+    EXPECT_TRUE(map->isDropped(0));
+    EXPECT_THROW(map->getVersion(0), std::out_of_range);
+    EXPECT_THROW(map->addVersion(3, 1, 1), std::out_of_range);
+    EXPECT_THROW(map->dropVersion(0), std::out_of_range);
+
+    size_t released = map->compact();
+    EXPECT_GT(released, 0u);
+    EXPECT_EQ(map->nodeCount(), before - released);
+    EXPECT_LE(map->nodeCount(), 7u + 6 * 3); // The newest tree plus the paths of five older versions
+    EXPECT_EQ(map->getVersion(100), latest);
+    EXPECT_EQ(map->find(97, 7), 90); // Last set by edit 90 in versions 0..96
+
+    map->addVersion(100, 8, 80); // The compacted arena keeps growing
+    EXPECT_EQ(map->getKeys(101), std::vector<int>({ 1, 2, 3, 4, 5, 6, 7, 8 }));
+    EXPECT_EQ(map->compact(), 0u);
+}
+
+TEST_F(CompactAssociativeArrayTest, SortedInputIsBalanced) 
+{
+    // Inserted one by one these would form a list: O(n^2) time and O(n) recursion depth on every edit
+    const int count = 500000;
+    std::vector<int> keys;
+    std::vector<int> values;
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < count; ++i)
+    {
+        keys.push_back(i);
+        values.push_back(2 * i);
+        pairs.emplace_back(i, 2 * i);
+    }
+    PersistentCompactAssociativeArray<int, int> sorted(keys, values, values.size());
+    PersistentCompactAssociativeArray<int, int> streamed(pairs.begin(), pairs.end());
+    EXPECT_EQ(sorted.size(0), count);
+    EXPECT_EQ(sorted.nodeCount(), count);
+    EXPECT_EQ(streamed.getVersion(0), values);
+
+    sorted.addVersion(0, count, 1); // Path copy of O(log n) nodes
+    streamed.eraseVersion(0, count / 2);
+    EXPECT_LE(sorted.nodeCount(), count + 21u);
+    EXPECT_EQ(sorted.find(1, count - 1), 2 * (count - 1));
+    EXPECT_EQ(streamed.size(1), count - 1);
+
+    // A repeated key replaces the value, keys out of order are inserted one by one
+    std::vector<std::pair<int, int>> mixed = { { 1, 1 }, { 3, 3 }, { 3, 30 }, { 5, 5 }, { 2, 2 }, { 5, 50 }, { 4, 4 } };
+    PersistentCompactAssociativeArray<int, int> fallback(mixed.begin(), mixed.end());
+    EXPECT_EQ(fallback.getKeys(0), std::vector<int>({ 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(fallback.getVersion(0), std::vector<int>({ 1, 2, 30, 4, 50 }));
+}
+
+
+// Test fixture for PersistentStack and PersistentQueue tests
+class StackQueueTest : public ::testing::Test 
+{
+protected:
+    PersistentStack<int>* stack;
+    PersistentQueue<int>* queue;
+
+    void SetUp() override 
+    {
+        int init_arr[] = { 1, 2, 3 };
+        stack = new PersistentStack<int>(init_arr, 3);
+        queue = new PersistentQueue<int>(init_arr, 3);
+    }
+
+    void TearDown() override 
+    {
+        delete stack;
+        delete queue;
+    }
+};
+
+TEST_F(StackQueueTest, StackVersions) 
+{
+    EXPECT_EQ(stack->top(0), 1);
+    stack->push(0); // Version[1]
+    stack->pop(); // Version[2]
+    stack->pop(); // Version[3]
+    stack->pushVersion(1, 9); // Version[4], branches from version 1
+    EXPECT_EQ(stack->getVersion(1), std::vector<int>({ 0, 1, 2, 3 }));
+    EXPECT_EQ(stack->getVersion(3), std::vector<int>({ 2, 3 }));
+    EXPECT_EQ(stack->getVersion(4), std::vector<int>({ 9, 0, 1, 2, 3 }));
+    EXPECT_EQ(stack->size(4), 5u);
+
+    stack->undo(); // Version[5], equal to version 3
+    EXPECT_EQ(stack->getVersion(5), std::vector<int>({ 2, 3 }));
+    stack->redo(); // Version[6], equal to version 4
+    EXPECT_EQ(stack->top(6), 9);
+
+    PersistentStack<int> empty;
+    EXPECT_TRUE(empty.empty(0));
+    EXPECT_THROW(empty.pop(), std::out_of_range);
+    EXPECT_THROW(empty.top(0), std::out_of_range);
+    EXPECT_THROW(stack->pushVersion(100, 1), std::out_of_range);
+}
+
+TEST_F(StackQueueTest, QueueMatchesDequeOnEveryVersion) 
+{
+    // Reference contents of every version, with pushes and pops on random older versions
+    std::vector<std::deque<int>> expected = { { 1, 2, 3 } };
+    unsigned seed = 12345;
+    for (int i = 0; i < 3000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        int root = i % 4 == 0 ? static_cast<int>((seed >> 8) % expected.size()) : static_cast<int>(expected.size()) - 1;
+        std::deque<int> next = expected[root];
+        if ((seed >> 16) % 3 == 0 && !next.empty())
+        {
+            queue->popVersion(root);
+            next.pop_front();
+        }
+        else
+        {
+            queue->pushVersion(root, i);
+            next.push_back(i);
+        }
+        expected.push_back(next);
+    }
+
+    // Reading in reverse order forces the shared streams in a different order than they were built
+    for (size_t i = expected.size(); i-- > 0;)
+    {
+        EXPECT_EQ(queue->getVersion(i), std::vector<int>(expected[i].begin(), expected[i].end())) << "version " << i;
+        EXPECT_EQ(queue->size(i), expected[i].size());
+        if (!expected[i].empty())
+        {
+            EXPECT_EQ(queue->front(i), expected[i].front());
+        }
+    }
+}
+
+TEST_F(StackQueueTest, QueueOperationsAndConvert) 
+{
+    queue->pop(); // Version[1]
+    queue->push(4); // Version[2]
+    queue->pop(); // Version[3]
+    queue->pop(); // Version[4]
+    queue->pop(); // Version[5]
+    EXPECT_TRUE(queue->empty(5));
+    EXPECT_THROW(queue->pop(), std::out_of_range);
+    EXPECT_THROW(queue->front(5), std::out_of_range);
+    queue->undo(); // Version[6], equal to version 4
+    EXPECT_EQ(queue->getVersion(6), std::vector<int>({ 4 }));
+    EXPECT_EQ(queue->getVersion(2), std::vector<int>({ 2, 3, 4 }));
+
+    PersistentArray<int> array = Convert<int>::convertQueueToArray(*queue, 2);
+    EXPECT_EQ(array.getVersion(0), std::vector<int>({ 2, 3, 4 }));
+    PersistentQueue<int> from_array = Convert<int>::convertArrayToQueue(array);
+    from_array.push(5);
+    EXPECT_EQ(from_array.getVersion(1), std::vector<int>({ 2, 3, 4, 5 }));
+    PersistentDoublyLinkedList<int> list = Convert<int>::convertQueueToList(from_array, 1);
+    EXPECT_EQ(Convert<int>::convertListToQueue(list).getVersion(0), list.getVersion(0));
+    PersistentSequence<int> sequence = Convert<int>::convertQueueToSequence(from_array, 1);
+    EXPECT_EQ(Convert<int>::convertSequenceToQueue(sequence).front(0), 2);
+
+    PersistentStack<int> from_list = Convert<int>::convertListToStack(list);
+    EXPECT_EQ(from_list.top(0), 2); // The head becomes the top
+    EXPECT_EQ(Convert<int>::convertStackToArray(from_list).getVersion(0), list.getVersion(0));
+    EXPECT_EQ(Convert<int>::convertStackToList(Convert<int>::convertArrayToStack(array)).getVersion(0), array.getVersion(0));
+}
+
+TEST_F(StackQueueTest, ConstructorSizes) 
+{
+    std::vector<int> values = { 1, 2, 3 };
+    EXPECT_EQ(PersistentStack<int>(values, 2).getVersion(0), std::vector<int>({ 1, 2 }));
+    EXPECT_EQ(PersistentQueue<int>(values, 2).getVersion(0), std::vector<int>({ 1, 2 }));
+    EXPECT_THROW(PersistentStack<int>(values, 4), std::invalid_argument);
+    EXPECT_THROW(PersistentQueue<int>(values, 4), std::invalid_argument);
+    EXPECT_THROW(PersistentStack<int>(values, -1), std::invalid_argument);
+    EXPECT_THROW(PersistentQueue<int>(values.data(), -1), std::invalid_argument);
+}
+
+TEST_F(StackQueueTest, LongChainsAreReleased) 
+{
+    // A million nodes per chain; releasing them recursively would overflow the call stack
+    const int count = 1000000;
+    std::vector<int> values(count, 1);
+    {
+        PersistentStack<int> long_stack(values, count);
+        long_stack.push(2);
+        EXPECT_EQ(long_stack.size(1), static_cast<size_t>(count) + 1);
+    }
+    {
+        PersistentQueue<int> built(values, count); // Evaluated front stream
+        built.pop();
+        EXPECT_EQ(built.size(1), static_cast<size_t>(count) - 1);
+
+        PersistentQueue<int> pushed; // Rear lists, rotations and their schedules
+        for (int i = 0; i < count; ++i)
+        {
+            pushed.push(i);
+        }
+        EXPECT_EQ(pushed.front(count), 0);
+    }
+}